@@ -10,7 +10,7 @@
 enum { SUCCESS,
        INITIALIZATION_ERROR, PARENT_CHILD_ERROR , ALREADY_IN_TREE,
        NO_SUCH_PATH, CONFLICTING_PATH, NOT_A_DIRECTORY, NOT_A_FILE,
-       MEMORY_ERROR
+       MEMORY_ERROR, IO_ERROR
 };
 
 /* In lieu of a proper boolean datatype */
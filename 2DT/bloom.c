@@ -0,0 +1,190 @@
+/*--------------------------------------------------------------------*/
+/* bloom.c                                                            */
+/*--------------------------------------------------------------------*/
+
+#include "bloom.h"
+#include <assert.h>
+#include <stdlib.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The minimum number of counters of a Bloom. */
+
+static const size_t MIN_COUNTERS = 64;
+
+/* The number of counters that each key sets.  Four is optimal for
+   about six counters per key, and near enough for more. */
+
+enum { HASH_COUNT = 4 };
+
+/* The largest value of a counter.  A counter that reaches it has lost
+   count, so it stays there rather than ever dropping to zero
+   wrongly. */
+
+enum { COUNTER_MAX = 255 };
+
+/*--------------------------------------------------------------------*/
+
+/* A Bloom is an array of counters. */
+
+struct Bloom
+{
+   /* The number of counters, always a power of 2. */
+   size_t uCounters;
+
+   /* The counters themselves. */
+   unsigned char *pucCounters;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Assign to auIndex the indices of the HASH_COUNT counters of oBloom
+   for the key whose hash is uHash. */
+
+static void Bloom_indices(Bloom_T oBloom, size_t uHash,
+                          size_t auIndex[])
+{
+   size_t uStep;
+   size_t u;
+
+   assert(oBloom != NULL);
+
+   /* double hashing with a second hash mixed from the first.
+      The step is odd, so the indices are distinct. */
+   uStep = (uHash ^ (uHash >> 15)) * 2654435761U;
+   uStep = (uStep ^ (uStep >> 13)) | 1;
+
+   for (u = 0; u < HASH_COUNT; u++)
+      auIndex[u] = (uHash + u * uStep) & (oBloom->uCounters - 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Bloom_hash(const char *pcKey, size_t uKeyLength)
+{
+   return Bloom_hashMore(2166136261U, pcKey, uKeyLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Bloom_hashMore(size_t uHash, const char *pcKey, size_t uKeyLength)
+{
+   size_t u;
+
+   assert(pcKey != NULL || uKeyLength == 0);
+
+   /* FNV-1a, which takes the bytes one at a time */
+   for (u = 0; u < uKeyLength; u++)
+   {
+      uHash ^= (unsigned char)pcKey[u];
+      uHash *= 16777619U;
+   }
+   return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+Bloom_T Bloom_new(size_t uCounters)
+{
+   Bloom_T oBloom;
+   size_t uActual = MIN_COUNTERS;
+
+   while (uActual < uCounters && uActual * 2 > uActual)
+      uActual *= 2;
+
+   oBloom = (struct Bloom*)malloc(sizeof(struct Bloom));
+   if (oBloom == NULL)
+      return NULL;
+
+   oBloom->pucCounters = (unsigned char*)calloc(uActual, 1);
+   if (oBloom->pucCounters == NULL)
+   {
+      free(oBloom);
+      return NULL;
+   }
+   oBloom->uCounters = uActual;
+   return oBloom;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Bloom_free(Bloom_T oBloom)
+{
+   assert(oBloom != NULL);
+
+   free(oBloom->pucCounters);
+   free(oBloom);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Bloom_getCounters(Bloom_T oBloom)
+{
+   assert(oBloom != NULL);
+
+   return oBloom->uCounters;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Bloom_add(Bloom_T oBloom, const char *pcKey, size_t uKeyLength)
+{
+   Bloom_addHash(oBloom, Bloom_hash(pcKey, uKeyLength));
+}
+
+/*--------------------------------------------------------------------*/
+
+void Bloom_addHash(Bloom_T oBloom, size_t uHash)
+{
+   size_t auIndex[HASH_COUNT];
+   size_t u;
+
+   assert(oBloom != NULL);
+
+   Bloom_indices(oBloom, uHash, auIndex);
+   for (u = 0; u < HASH_COUNT; u++)
+      if (oBloom->pucCounters[auIndex[u]] < COUNTER_MAX)
+         oBloom->pucCounters[auIndex[u]]++;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Bloom_remove(Bloom_T oBloom, const char *pcKey, size_t uKeyLength)
+{
+   Bloom_removeHash(oBloom, Bloom_hash(pcKey, uKeyLength));
+}
+
+/*--------------------------------------------------------------------*/
+
+void Bloom_removeHash(Bloom_T oBloom, size_t uHash)
+{
+   size_t auIndex[HASH_COUNT];
+   size_t u;
+
+   assert(oBloom != NULL);
+
+   Bloom_indices(oBloom, uHash, auIndex);
+   for (u = 0; u < HASH_COUNT; u++)
+   {
+      assert(oBloom->pucCounters[auIndex[u]] > 0);
+      if (oBloom->pucCounters[auIndex[u]] < COUNTER_MAX)
+         oBloom->pucCounters[auIndex[u]]--;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+int Bloom_mayContain(Bloom_T oBloom, const char *pcKey,
+                     size_t uKeyLength)
+{
+   size_t auIndex[HASH_COUNT];
+   size_t u;
+
+   assert(oBloom != NULL);
+
+   Bloom_indices(oBloom, Bloom_hash(pcKey, uKeyLength), auIndex);
+   for (u = 0; u < HASH_COUNT; u++)
+      if (oBloom->pucCounters[auIndex[u]] == 0)
+         return 0;
+   return 1;
+}
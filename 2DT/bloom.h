@@ -0,0 +1,89 @@
+/*--------------------------------------------------------------------*/
+/* bloom.h                                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef BLOOM_INCLUDED
+#define BLOOM_INCLUDED
+
+#include <stddef.h>
+
+/* A Bloom_T object is a counting Bloom filter: a set of keys that can
+   answer for certain that a key is absent, but that may mistake an
+   absent key for a present one.  Keys need not be NUL-terminated, and
+   are not stored.  Each key sets a few small counters rather than
+   bits, so that keys can be removed again as well as added. */
+
+typedef struct Bloom *Bloom_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash that a Bloom_T object keeps the key that is the
+   uKeyLength bytes at pcKey under. */
+
+size_t Bloom_hash(const char *pcKey, size_t uKeyLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash of the key that is the key whose hash is uHash
+   followed by the uKeyLength bytes at pcKey, so that keys that share
+   a prefix can be hashed without being put together. */
+
+size_t Bloom_hashMore(size_t uHash, const char *pcKey, size_t uKeyLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new, empty Bloom_T object with at least uCounters
+   counters, or NULL if insufficient memory is available.  With k
+   counters per key that it will hold, the chance that it mistakes an
+   absent key for a present one is about 2.4% for k = 8 and 0.24% for
+   k = 16. */
+
+Bloom_T Bloom_new(size_t uCounters);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oBloom. */
+
+void Bloom_free(Bloom_T oBloom);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of counters of oBloom. */
+
+size_t Bloom_getCounters(Bloom_T oBloom);
+
+/*--------------------------------------------------------------------*/
+
+/* Add the key that is the uKeyLength bytes at pcKey to oBloom. */
+
+void Bloom_add(Bloom_T oBloom, const char *pcKey, size_t uKeyLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Add the key whose hash is uHash to oBloom. */
+
+void Bloom_addHash(Bloom_T oBloom, size_t uHash);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the key that is the uKeyLength bytes at pcKey from oBloom.
+   It must have been added more times than it has been removed. */
+
+void Bloom_remove(Bloom_T oBloom, const char *pcKey, size_t uKeyLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the key whose hash is uHash from oBloom, as Bloom_remove
+   does. */
+
+void Bloom_removeHash(Bloom_T oBloom, size_t uHash);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 0 (FALSE) if the key that is the uKeyLength bytes at pcKey
+   is certainly not in oBloom, or 1 (TRUE) if it may be. */
+
+int Bloom_mayContain(Bloom_T oBloom, const char *pcKey,
+                     size_t uKeyLength);
+
+#endif
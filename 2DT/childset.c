@@ -0,0 +1,1523 @@
+/*--------------------------------------------------------------------*/
+/* childset.c                                                         */
+/*--------------------------------------------------------------------*/
+
+#include "childset.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The minimum physical length of a ChildSet's entry array. */
+
+static const size_t MIN_PHYS_LENGTH = 2;
+
+/* The length beyond which a ChildSet is promoted. */
+
+static const size_t PROMOTE_LENGTH = 64;
+
+/* The maximum number of entries in a B+-tree leaf and of children of
+   a B+-tree inner node.  At 16, binary search within a node touches
+   only a handful of cache lines. */
+
+enum { BTREE_ORDER = 16 };
+
+/* An upper bound on the height of a B+-tree.  Every node but the root
+   is at least half full, so this is far beyond any addressable
+   length. */
+
+enum { BTREE_MAX_HEIGHT = 32 };
+
+/*--------------------------------------------------------------------*/
+
+/* A key is a string that is not NUL-terminated in general. */
+
+struct ChildSetKey
+{
+   /* The bytes of the key. */
+   const char *pcKey;
+
+   /* The number of bytes in the key. */
+   size_t uKeyLength;
+};
+
+/* An entry pairs an element with its key. */
+
+struct ChildSetEntry
+{
+   /* The key, which is not NUL-terminated in general. */
+   const char *pcKey;
+
+   /* The number of bytes in the key. */
+   size_t uKeyLength;
+
+   /* The element itself. */
+   const void *pvElement;
+
+   /* The weight of the element. */
+   size_t uWeight;
+};
+
+/* A slot of the hash table caches its entry's hash code.  A slot
+   whose element is NULL is empty. */
+
+struct ChildSetSlot
+{
+   /* The entry stored in this slot. */
+   struct ChildSetEntry oEntry;
+
+   /* The hash code of the entry's key. */
+   size_t uHash;
+};
+
+/* A leaf of the B+-tree holds entries in sorted order, and is linked
+   to its neighbors so that iteration never has to climb the tree. */
+
+struct ChildSetLeaf
+{
+   /* The number of entries in the leaf. */
+   size_t uCount;
+
+   /* The leaves before and after this one, or NULL. */
+   struct ChildSetLeaf *pPrev;
+   struct ChildSetLeaf *pNext;
+
+   /* The entries themselves. */
+   struct ChildSetEntry aEntries[BTREE_ORDER];
+};
+
+/* An inner node of the B+-tree records, for each child, the number
+   of entries beneath it, their total weight, and the smallest key
+   beneath it, so that it can be searched by key, by rank, and by
+   weight. */
+
+struct ChildSetInner
+{
+   /* The number of children of the node. */
+   size_t uCount;
+
+   /* aMins[i] is the smallest key beneath apvChildren[i].
+      aMins[0] is not maintained. */
+   struct ChildSetKey aMins[BTREE_ORDER];
+
+   /* auSizes[i] is the number of entries beneath apvChildren[i]. */
+   size_t auSizes[BTREE_ORDER];
+
+   /* auWeights[i] is the total weight of the entries beneath
+      apvChildren[i]. */
+   size_t auWeights[BTREE_ORDER];
+
+   /* The children: leaves at height 1, inner nodes above. */
+   void *apvChildren[BTREE_ORDER];
+};
+
+/* A ChildSet is in one of three representations.  Before promotion,
+   its array of entries is the set.  After promotion to a hash table,
+   the table is the set and the array is a sorted view of it that is
+   valid only when iSorted.  After promotion to a B+-tree, the tree is
+   the set and there is no array. */
+
+struct ChildSet
+{
+   /* The number of elements in the ChildSet. */
+   size_t uLength;
+
+   /* The total weight of the elements in the ChildSet. */
+   size_t uWeight;
+
+   /* The representation to promote to. */
+   enum ChildSet_Kind eKind;
+
+   /* The entries, in sorted order if iSorted. */
+   struct ChildSetEntry *pEntries;
+
+   /* The number of entries that pEntries has room for.  Kept at
+      least uLength so that sorting never has to allocate. */
+   size_t uPhysLength;
+
+   /* 1 (TRUE) iff pEntries holds every element in sorted order. */
+   int iSorted;
+
+   /* The hash table, or NULL if the ChildSet is not hashed. */
+   struct ChildSetSlot *pSlots;
+
+   /* The number of slots in pSlots, always a power of 2. */
+   size_t uSlotCount;
+
+   /* The root of the B+-tree, or NULL if the ChildSet is not one. */
+   void *pvRoot;
+
+   /* The height of the B+-tree: 0 if the root is a leaf. */
+   size_t uHeight;
+};
+
+/*--------------------------------------------------------------------*/
+
+#ifndef NDEBUG
+
+/* Check the invariants of oChildSet.  Return 1 (TRUE) iff oChildSet
+   is in a valid state. */
+
+static int ChildSet_isValid(ChildSet_T oChildSet)
+{
+   if (oChildSet->pvRoot != NULL)
+   {
+      if (oChildSet->pEntries != NULL) return 0;
+      if (oChildSet->pSlots != NULL) return 0;
+      if (oChildSet->uHeight >= BTREE_MAX_HEIGHT) return 0;
+      return 1;
+   }
+   if (oChildSet->uPhysLength < MIN_PHYS_LENGTH) return 0;
+   if (oChildSet->uLength > oChildSet->uPhysLength) return 0;
+   if (oChildSet->pEntries == NULL) return 0;
+   if (oChildSet->pSlots == NULL && ! oChildSet->iSorted) return 0;
+   if (oChildSet->pSlots != NULL &&
+       2 * oChildSet->uLength > oChildSet->uSlotCount) return 0;
+   return 1;
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Compare the uKeyLength1 bytes at pcKey1 with the uKeyLength2 bytes
+   at pcKey2.  Return <0, 0, or >0 as strcmp would. */
+
+static int ChildSet_compareKeys(const char *pcKey1, size_t uKeyLength1,
+                                const char *pcKey2, size_t uKeyLength2)
+{
+   int iCompare;
+
+   iCompare = memcmp(pcKey1, pcKey2,
+                     uKeyLength1 < uKeyLength2 ? uKeyLength1
+                                               : uKeyLength2);
+   if (iCompare != 0)
+      return iCompare;
+   if (uKeyLength1 < uKeyLength2)
+      return -1;
+   return uKeyLength1 > uKeyLength2;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Compare the entries at pvEntry1 and pvEntry2 by key, for qsort. */
+
+static int ChildSet_compareEntries(const void *pvEntry1,
+                                   const void *pvEntry2)
+{
+   const struct ChildSetEntry *pEntry1 = pvEntry1;
+   const struct ChildSetEntry *pEntry2 = pvEntry2;
+
+   return ChildSet_compareKeys(pEntry1->pcKey, pEntry1->uKeyLength,
+                               pEntry2->pcKey, pEntry2->uKeyLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Binary search the uLength sorted entries at pEntries for the key
+   that is the uKeyLength bytes at pcKey.  Assign its index, or the
+   index it would have, to *puIndex; return 1 if it is found and 0 if
+   not. */
+
+static int ChildSet_bsearchEntries(const struct ChildSetEntry *pEntries,
+                                   size_t uLength, const char *pcKey,
+                                   size_t uKeyLength, size_t *puIndex)
+{
+   size_t uLo = 0;
+   size_t uHi = uLength;
+   size_t uMid;
+   int iCompare;
+
+   assert(pEntries != NULL || uLength == 0);
+   assert(puIndex != NULL);
+
+   while (uLo < uHi)
+   {
+      uMid = uLo + (uHi - uLo) / 2;
+      iCompare = ChildSet_compareKeys(pcKey, uKeyLength,
+                                      pEntries[uMid].pcKey,
+                                      pEntries[uMid].uKeyLength);
+      if (iCompare < 0)
+         uHi = uMid;
+      else if (iCompare > 0)
+         uLo = uMid + 1;
+      else
+      {
+         *puIndex = uMid;
+         return 1;
+      }
+   }
+   *puIndex = uLo;
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+/* The hash table                                                     */
+/*--------------------------------------------------------------------*/
+
+/* Return the FNV-1a hash code of the uKeyLength bytes at pcKey. */
+
+static size_t ChildSet_hash(const char *pcKey, size_t uKeyLength)
+{
+   size_t uHash = 2166136261U;
+   size_t u;
+
+   for (u = 0; u < uKeyLength; u++)
+   {
+      uHash ^= (unsigned char)pcKey[u];
+      uHash *= 16777619U;
+   }
+   return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the slot of oChildSet's hash table that holds
+   the key that is the uKeyLength bytes at pcKey with hash code uHash,
+   or the index of the empty slot where it would be put. */
+
+static size_t ChildSet_probe(ChildSet_T oChildSet, const char *pcKey,
+                             size_t uKeyLength, size_t uHash)
+{
+   size_t uMask;
+   size_t u;
+   struct ChildSetSlot *pSlot;
+
+   assert(oChildSet != NULL);
+   assert(oChildSet->pSlots != NULL);
+
+   uMask = oChildSet->uSlotCount - 1;
+   for (u = uHash & uMask; ; u = (u + 1) & uMask)
+   {
+      pSlot = &oChildSet->pSlots[u];
+      if (pSlot->oEntry.pvElement == NULL)
+         return u;
+      if (pSlot->uHash == uHash &&
+          pSlot->oEntry.uKeyLength == uKeyLength &&
+          memcmp(pSlot->oEntry.pcKey, pcKey, uKeyLength) == 0)
+         return u;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Replace oChildSet's hash table with one of uSlotCount slots that
+   holds every entry of the old table, or of the sorted array if
+   oChildSet has not been promoted yet.  Return 1 (TRUE) if
+   successful and 0 (FALSE) if insufficient memory is available. */
+
+static int ChildSet_rehash(ChildSet_T oChildSet, size_t uSlotCount)
+{
+   struct ChildSetSlot *pOldSlots;
+   size_t uOldSlotCount;
+   struct ChildSetSlot *pNewSlots;
+   struct ChildSetSlot *pSlot;
+   struct ChildSetEntry *pEntry;
+   size_t uHash;
+   size_t u;
+
+   assert(oChildSet != NULL);
+
+   pNewSlots = (struct ChildSetSlot*)
+      calloc(uSlotCount, sizeof(struct ChildSetSlot));
+   if (pNewSlots == NULL)
+      return 0;
+
+   pOldSlots = oChildSet->pSlots;
+   uOldSlotCount = oChildSet->uSlotCount;
+   oChildSet->pSlots = pNewSlots;
+   oChildSet->uSlotCount = uSlotCount;
+
+   if (pOldSlots == NULL)
+   {
+      for (u = 0; u < oChildSet->uLength; u++)
+      {
+         pEntry = &oChildSet->pEntries[u];
+         uHash = ChildSet_hash(pEntry->pcKey, pEntry->uKeyLength);
+         pSlot = &pNewSlots[ChildSet_probe(oChildSet, pEntry->pcKey,
+                                           pEntry->uKeyLength, uHash)];
+         pSlot->oEntry = *pEntry;
+         pSlot->uHash = uHash;
+      }
+   }
+   else
+   {
+      for (u = 0; u < uOldSlotCount; u++)
+      {
+         pEntry = &pOldSlots[u].oEntry;
+         if (pEntry->pvElement != NULL)
+            pNewSlots[ChildSet_probe(oChildSet, pEntry->pcKey,
+                                     pEntry->uKeyLength,
+                                     pOldSlots[u].uHash)] =
+               pOldSlots[u];
+      }
+      free(pOldSlots);
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Rebuild the sorted view of oChildSet's hash table, if it is not
+   already valid. */
+
+static void ChildSet_sort(ChildSet_T oChildSet)
+{
+   size_t u;
+   size_t uEntry = 0;
+
+   assert(oChildSet != NULL);
+
+   if (oChildSet->iSorted)
+      return;
+
+   assert(oChildSet->pSlots != NULL);
+   for (u = 0; u < oChildSet->uSlotCount; u++)
+      if (oChildSet->pSlots[u].oEntry.pvElement != NULL)
+         oChildSet->pEntries[uEntry++] = oChildSet->pSlots[u].oEntry;
+   assert(uEntry == oChildSet->uLength);
+
+   qsort(oChildSet->pEntries, oChildSet->uLength,
+         sizeof(struct ChildSetEntry), ChildSet_compareEntries);
+   oChildSet->iSorted = 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add a copy of *pNew to oChildSet's hash table, growing the table
+   first if needed.  Return 1 (TRUE) if successful and 0 (FALSE) if
+   insufficient memory is available. */
+
+static int ChildSet_addHashed(ChildSet_T oChildSet,
+                              const struct ChildSetEntry *pNew)
+{
+   const size_t GROWTH_FACTOR = 2;
+
+   size_t uHash;
+   struct ChildSetSlot *pSlot;
+   struct ChildSetEntry *pLast;
+
+   assert(oChildSet != NULL);
+   assert(pNew != NULL);
+   assert(oChildSet->pSlots != NULL);
+
+   if (2 * (oChildSet->uLength + 1) > oChildSet->uSlotCount)
+      if (! ChildSet_rehash(oChildSet,
+                            GROWTH_FACTOR * oChildSet->uSlotCount))
+         return 0;
+
+   uHash = ChildSet_hash(pNew->pcKey, pNew->uKeyLength);
+   pSlot = &oChildSet->pSlots[
+      ChildSet_probe(oChildSet, pNew->pcKey, pNew->uKeyLength, uHash)];
+   assert(pSlot->oEntry.pvElement == NULL);
+   pSlot->oEntry = *pNew;
+   pSlot->uHash = uHash;
+
+   /* Adding in key order, as a bulk load does, keeps the view valid. */
+   if (oChildSet->iSorted && oChildSet->uLength > 0)
+   {
+      pLast = &oChildSet->pEntries[oChildSet->uLength - 1];
+      if (ChildSet_compareEntries(pLast, pNew) < 0)
+         oChildSet->pEntries[oChildSet->uLength] = pSlot->oEntry;
+      else
+         oChildSet->iSorted = 0;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Empty slot uIndex of oChildSet's hash table, shifting back any
+   entries later in its probe sequence so that they remain
+   reachable. */
+
+static void ChildSet_emptySlot(ChildSet_T oChildSet, size_t uIndex)
+{
+   size_t uMask;
+   size_t uNext;
+   size_t uHome;
+   struct ChildSetSlot *pSlots;
+
+   assert(oChildSet != NULL);
+   assert(oChildSet->pSlots != NULL);
+
+   pSlots = oChildSet->pSlots;
+   uMask = oChildSet->uSlotCount - 1;
+   for (uNext = (uIndex + 1) & uMask;
+        pSlots[uNext].oEntry.pvElement != NULL;
+        uNext = (uNext + 1) & uMask)
+   {
+      uHome = pSlots[uNext].uHash & uMask;
+      /* Move the entry back unless its home lies cyclically in
+         (uIndex, uNext]. */
+      if ((uIndex < uNext) ? (uHome <= uIndex || uHome > uNext)
+                           : (uHome <= uIndex && uHome > uNext))
+      {
+         pSlots[uIndex] = pSlots[uNext];
+         uIndex = uNext;
+      }
+   }
+   pSlots[uIndex].oEntry.pvElement = NULL;
+}
+
+/*--------------------------------------------------------------------*/
+/* The B+-tree                                                        */
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) iff pvNode, a B+-tree node at height uHeight, has
+   no room for another entry or child. */
+
+static int ChildSet_btreeIsFull(void *pvNode, size_t uHeight)
+{
+   assert(pvNode != NULL);
+
+   if (uHeight == 0)
+      return ((struct ChildSetLeaf*)pvNode)->uCount == BTREE_ORDER;
+   return ((struct ChildSetInner*)pvNode)->uCount == BTREE_ORDER;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the leftmost leaf beneath pvNode, a B+-tree node at height
+   uHeight. */
+
+static struct ChildSetLeaf *ChildSet_btreeFirstLeaf(void *pvNode,
+                                                     size_t uHeight)
+{
+   assert(pvNode != NULL);
+
+   for ( ; uHeight > 0; uHeight--)
+      pvNode = ((struct ChildSetInner*)pvNode)->apvChildren[0];
+   return (struct ChildSetLeaf*)pvNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the smallest key beneath pvNode, a nonempty B+-tree node at
+   height uHeight. */
+
+static struct ChildSetKey ChildSet_btreeMin(void *pvNode, size_t uHeight)
+{
+   struct ChildSetLeaf *pLeaf;
+   struct ChildSetKey oKey;
+
+   pLeaf = ChildSet_btreeFirstLeaf(pvNode, uHeight);
+   assert(pLeaf->uCount > 0);
+   oKey.pcKey = pLeaf->aEntries[0].pcKey;
+   oKey.uKeyLength = pLeaf->aEntries[0].uKeyLength;
+   return oKey;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the child of pInner beneath which the key that
+   is the uKeyLength bytes at pcKey belongs. */
+
+static size_t ChildSet_innerIndex(struct ChildSetInner *pInner,
+                                  const char *pcKey, size_t uKeyLength)
+{
+   size_t uLo = 1;
+   size_t uHi;
+   size_t uMid;
+
+   assert(pInner != NULL);
+   assert(pInner->uCount > 0);
+
+   /* Find the first separator greater than the key. */
+   uHi = pInner->uCount;
+   while (uLo < uHi)
+   {
+      uMid = uLo + (uHi - uLo) / 2;
+      if (ChildSet_compareKeys(pcKey, uKeyLength,
+                               pInner->aMins[uMid].pcKey,
+                               pInner->aMins[uMid].uKeyLength) < 0)
+         uHi = uMid;
+      else
+         uLo = uMid + 1;
+   }
+   return uLo - 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the leaf of oChildSet's B+-tree where the key that is the
+   uKeyLength bytes at pcKey belongs.  If puRank is not NULL, assign
+   to *puRank the number of entries in the leaves before it. */
+
+static struct ChildSetLeaf *ChildSet_btreeLeaf(ChildSet_T oChildSet,
+                                               const char *pcKey,
+                                               size_t uKeyLength,
+                                               size_t *puRank)
+{
+   void *pvNode;
+   struct ChildSetInner *pInner;
+   size_t uHeight;
+   size_t uRank = 0;
+   size_t u;
+   size_t uChild;
+
+   assert(oChildSet != NULL);
+   assert(oChildSet->pvRoot != NULL);
+
+   pvNode = oChildSet->pvRoot;
+   for (uHeight = oChildSet->uHeight; uHeight > 0; uHeight--)
+   {
+      pInner = (struct ChildSetInner*)pvNode;
+      uChild = ChildSet_innerIndex(pInner, pcKey, uKeyLength);
+      for (u = 0; u < uChild; u++)
+         uRank += pInner->auSizes[u];
+      pvNode = pInner->apvChildren[uChild];
+   }
+   if (puRank != NULL)
+      *puRank = uRank;
+   return (struct ChildSetLeaf*)pvNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Split the full child uIndex of pParent, a B+-tree node that is not
+   full, into two halves.  uChildHeight is the height of the child.
+   Return 1 (TRUE) if successful and 0 (FALSE) if insufficient memory
+   is available, in which case the tree is unchanged. */
+
+static int ChildSet_btreeSplit(struct ChildSetInner *pParent,
+                               size_t uIndex, size_t uChildHeight)
+{
+   const size_t HALF = BTREE_ORDER / 2;
+
+   struct ChildSetLeaf *pLeaf;
+   struct ChildSetLeaf *pNewLeaf;
+   struct ChildSetInner *pInner;
+   struct ChildSetInner *pNewInner;
+   void *pvNew;
+   size_t uMoved = 0;
+   size_t uMovedWeight = 0;
+   size_t u;
+
+   assert(pParent != NULL);
+   assert(pParent->uCount < BTREE_ORDER);
+   assert(uIndex < pParent->uCount);
+
+   if (uChildHeight == 0)
+   {
+      pLeaf = (struct ChildSetLeaf*)pParent->apvChildren[uIndex];
+      pNewLeaf = (struct ChildSetLeaf*)
+         malloc(sizeof(struct ChildSetLeaf));
+      if (pNewLeaf == NULL)
+         return 0;
+      memcpy(pNewLeaf->aEntries, &pLeaf->aEntries[HALF],
+             sizeof(struct ChildSetEntry) * HALF);
+      pNewLeaf->uCount = HALF;
+      pLeaf->uCount = HALF;
+      pNewLeaf->pPrev = pLeaf;
+      pNewLeaf->pNext = pLeaf->pNext;
+      if (pLeaf->pNext != NULL)
+         pLeaf->pNext->pPrev = pNewLeaf;
+      pLeaf->pNext = pNewLeaf;
+      uMoved = HALF;
+      for (u = 0; u < HALF; u++)
+         uMovedWeight += pNewLeaf->aEntries[u].uWeight;
+      pvNew = pNewLeaf;
+   }
+   else
+   {
+      pInner = (struct ChildSetInner*)pParent->apvChildren[uIndex];
+      pNewInner = (struct ChildSetInner*)
+         malloc(sizeof(struct ChildSetInner));
+      if (pNewInner == NULL)
+         return 0;
+      memcpy(pNewInner->aMins, &pInner->aMins[HALF],
+             sizeof(struct ChildSetKey) * HALF);
+      memcpy(pNewInner->auSizes, &pInner->auSizes[HALF],
+             sizeof(size_t) * HALF);
+      memcpy(pNewInner->auWeights, &pInner->auWeights[HALF],
+             sizeof(size_t) * HALF);
+      memcpy(pNewInner->apvChildren, &pInner->apvChildren[HALF],
+             sizeof(void*) * HALF);
+      pNewInner->uCount = HALF;
+      pInner->uCount = HALF;
+      for (u = 0; u < HALF; u++)
+      {
+         uMoved += pNewInner->auSizes[u];
+         uMovedWeight += pNewInner->auWeights[u];
+      }
+      pvNew = pNewInner;
+   }
+
+   u = pParent->uCount - (uIndex + 1);
+   memmove(&pParent->aMins[uIndex + 2], &pParent->aMins[uIndex + 1],
+           sizeof(struct ChildSetKey) * u);
+   memmove(&pParent->auSizes[uIndex + 2], &pParent->auSizes[uIndex + 1],
+           sizeof(size_t) * u);
+   memmove(&pParent->auWeights[uIndex + 2],
+           &pParent->auWeights[uIndex + 1], sizeof(size_t) * u);
+   memmove(&pParent->apvChildren[uIndex + 2],
+           &pParent->apvChildren[uIndex + 1], sizeof(void*) * u);
+   pParent->uCount++;
+
+   pParent->apvChildren[uIndex + 1] = pvNew;
+   pParent->aMins[uIndex + 1] = ChildSet_btreeMin(pvNew, uChildHeight);
+   pParent->auSizes[uIndex + 1] = uMoved;
+   pParent->auSizes[uIndex] -= uMoved;
+   pParent->auWeights[uIndex + 1] = uMovedWeight;
+   pParent->auWeights[uIndex] -= uMovedWeight;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add a copy of *pNew to oChildSet's B+-tree, splitting full nodes
+   on the way down.  Return 1 (TRUE) if successful and 0 (FALSE) if
+   insufficient memory is available, in which case oChildSet's
+   contents are unchanged. */
+
+static int ChildSet_btreeAdd(ChildSet_T oChildSet,
+                             const struct ChildSetEntry *pNew)
+{
+   struct ChildSetInner *apPath[BTREE_MAX_HEIGHT];
+   size_t auPath[BTREE_MAX_HEIGHT];
+   size_t uDepth = 0;
+   struct ChildSetInner *pInner;
+   struct ChildSetLeaf *pLeaf;
+   void *pvNode;
+   size_t uHeight;
+   size_t uIndex;
+   size_t u;
+
+   assert(oChildSet != NULL);
+   assert(pNew != NULL);
+   assert(oChildSet->pvRoot != NULL);
+
+   if (ChildSet_btreeIsFull(oChildSet->pvRoot, oChildSet->uHeight))
+   {
+      pInner = (struct ChildSetInner*)
+         malloc(sizeof(struct ChildSetInner));
+      if (pInner == NULL)
+         return 0;
+      pInner->uCount = 1;
+      pInner->apvChildren[0] = oChildSet->pvRoot;
+      pInner->auSizes[0] = oChildSet->uLength;
+      pInner->auWeights[0] = oChildSet->uWeight;
+      if (! ChildSet_btreeSplit(pInner, 0, oChildSet->uHeight))
+      {
+         free(pInner);
+         return 0;
+      }
+      oChildSet->pvRoot = pInner;
+      oChildSet->uHeight++;
+   }
+
+   pvNode = oChildSet->pvRoot;
+   for (uHeight = oChildSet->uHeight; uHeight > 0; uHeight--)
+   {
+      pInner = (struct ChildSetInner*)pvNode;
+      uIndex = ChildSet_innerIndex(pInner, pNew->pcKey,
+                                   pNew->uKeyLength);
+      if (ChildSet_btreeIsFull(pInner->apvChildren[uIndex],
+                               uHeight - 1))
+      {
+         if (! ChildSet_btreeSplit(pInner, uIndex, uHeight - 1))
+            return 0;
+         if (ChildSet_compareKeys(pNew->pcKey, pNew->uKeyLength,
+                                  pInner->aMins[uIndex + 1].pcKey,
+                                  pInner->aMins[uIndex + 1].uKeyLength)
+             > 0)
+            uIndex++;
+      }
+      apPath[uDepth] = pInner;
+      auPath[uDepth] = uIndex;
+      uDepth++;
+      pvNode = pInner->apvChildren[uIndex];
+   }
+
+   pLeaf = (struct ChildSetLeaf*)pvNode;
+   (void)ChildSet_bsearchEntries(pLeaf->aEntries, pLeaf->uCount,
+                                 pNew->pcKey, pNew->uKeyLength, &uIndex);
+   memmove(&pLeaf->aEntries[uIndex + 1], &pLeaf->aEntries[uIndex],
+           sizeof(struct ChildSetEntry) * (pLeaf->uCount - uIndex));
+   pLeaf->aEntries[uIndex] = *pNew;
+   pLeaf->uCount++;
+
+   for (u = 0; u < uDepth; u++)
+   {
+      apPath[u]->auSizes[auPath[u]]++;
+      apPath[u]->auWeights[auPath[u]] += pNew->uWeight;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove child uIndex from pInner, a B+-tree inner node. */
+
+static void ChildSet_innerRemoveAt(struct ChildSetInner *pInner,
+                                   size_t uIndex)
+{
+   size_t uMoved;
+
+   assert(pInner != NULL);
+   assert(uIndex < pInner->uCount);
+
+   pInner->uCount--;
+   uMoved = pInner->uCount - uIndex;
+   memmove(&pInner->aMins[uIndex], &pInner->aMins[uIndex + 1],
+           sizeof(struct ChildSetKey) * uMoved);
+   memmove(&pInner->auSizes[uIndex], &pInner->auSizes[uIndex + 1],
+           sizeof(size_t) * uMoved);
+   memmove(&pInner->auWeights[uIndex], &pInner->auWeights[uIndex + 1],
+           sizeof(size_t) * uMoved);
+   memmove(&pInner->apvChildren[uIndex], &pInner->apvChildren[uIndex + 1],
+           sizeof(void*) * uMoved);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove and return the element of oChildSet's B+-tree whose key is
+   the uKeyLength bytes at pcKey, assigning its weight to *puWeight,
+   or return NULL if there is no such element.  Nodes are freed when
+   they become empty rather than merged when they become sparse, so
+   the tree is never taller than it was at its largest. */
+
+static void *ChildSet_btreeRemove(ChildSet_T oChildSet,
+                                  const char *pcKey, size_t uKeyLength,
+                                  size_t *puWeight)
+{
+   struct ChildSetInner *apPath[BTREE_MAX_HEIGHT];
+   size_t auPath[BTREE_MAX_HEIGHT];
+   size_t uDepth = 0;
+   struct ChildSetInner *pInner;
+   struct ChildSetLeaf *pLeaf;
+   const void *pvOldElement;
+   void *pvNode;
+   size_t uHeight;
+   size_t uIndex;
+   size_t u;
+
+   assert(oChildSet != NULL);
+   assert(oChildSet->pvRoot != NULL);
+
+   pvNode = oChildSet->pvRoot;
+   for (uHeight = oChildSet->uHeight; uHeight > 0; uHeight--)
+   {
+      pInner = (struct ChildSetInner*)pvNode;
+      apPath[uDepth] = pInner;
+      auPath[uDepth] = ChildSet_innerIndex(pInner, pcKey, uKeyLength);
+      pvNode = pInner->apvChildren[auPath[uDepth]];
+      uDepth++;
+   }
+
+   pLeaf = (struct ChildSetLeaf*)pvNode;
+   if (! ChildSet_bsearchEntries(pLeaf->aEntries, pLeaf->uCount,
+                                 pcKey, uKeyLength, &uIndex))
+      return NULL;
+   pvOldElement = pLeaf->aEntries[uIndex].pvElement;
+   *puWeight = pLeaf->aEntries[uIndex].uWeight;
+   pLeaf->uCount--;
+   memmove(&pLeaf->aEntries[uIndex], &pLeaf->aEntries[uIndex + 1],
+           sizeof(struct ChildSetEntry) * (pLeaf->uCount - uIndex));
+   for (u = 0; u < uDepth; u++)
+   {
+      apPath[u]->auSizes[auPath[u]]--;
+      apPath[u]->auWeights[auPath[u]] -= *puWeight;
+   }
+
+   /* Free the leaf, and then any inner nodes, that became empty. */
+   if (pLeaf->uCount == 0 && uDepth > 0)
+   {
+      if (pLeaf->pPrev != NULL)
+         pLeaf->pPrev->pNext = pLeaf->pNext;
+      if (pLeaf->pNext != NULL)
+         pLeaf->pNext->pPrev = pLeaf->pPrev;
+      free(pLeaf);
+      for (;;)
+      {
+         uDepth--;
+         ChildSet_innerRemoveAt(apPath[uDepth], auPath[uDepth]);
+         if (apPath[uDepth]->uCount > 0 || uDepth == 0)
+            break;
+         free(apPath[uDepth]);
+      }
+      uDepth++;
+   }
+
+   /* Refresh the separators above the removed key, which may have
+      been the smallest beneath some of them. */
+   if (uIndex == 0)
+      for (u = 0; u < uDepth; u++)
+         if (auPath[u] > 0 && auPath[u] < apPath[u]->uCount)
+            apPath[u]->aMins[auPath[u]] =
+               ChildSet_btreeMin(apPath[u]->apvChildren[auPath[u]],
+                                 oChildSet->uHeight - u - 1);
+
+   /* Shorten the tree while its root has only one child. */
+   while (oChildSet->uHeight > 0 &&
+          ((struct ChildSetInner*)oChildSet->pvRoot)->uCount == 1)
+   {
+      pInner = (struct ChildSetInner*)oChildSet->pvRoot;
+      oChildSet->pvRoot = pInner->apvChildren[0];
+      oChildSet->uHeight--;
+      free(pInner);
+   }
+   return (void*)pvOldElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvNode, a B+-tree node at height uHeight, and every node
+   beneath it. */
+
+static void ChildSet_btreeFree(void *pvNode, size_t uHeight)
+{
+   struct ChildSetInner *pInner;
+   size_t u;
+
+   assert(pvNode != NULL);
+
+   if (uHeight > 0)
+   {
+      pInner = (struct ChildSetInner*)pvNode;
+      for (u = 0; u < pInner->uCount; u++)
+         ChildSet_btreeFree(pInner->apvChildren[u], uHeight - 1);
+   }
+   free(pvNode);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move the elements of oChildSet's sorted array into a new B+-tree.
+   Return 1 (TRUE) if successful and 0 (FALSE) if insufficient memory
+   is available, in which case oChildSet is unchanged. */
+
+static int ChildSet_promoteToBtree(ChildSet_T oChildSet)
+{
+   struct ChildSetLeaf *pLeaf;
+   struct ChildSetEntry *pEntry;
+   size_t uLength;
+   size_t uWeight;
+
+   assert(oChildSet != NULL);
+   assert(oChildSet->pvRoot == NULL);
+
+   pLeaf = (struct ChildSetLeaf*)malloc(sizeof(struct ChildSetLeaf));
+   if (pLeaf == NULL)
+      return 0;
+   pLeaf->uCount = 0;
+   pLeaf->pPrev = NULL;
+   pLeaf->pNext = NULL;
+   oChildSet->pvRoot = pLeaf;
+   oChildSet->uHeight = 0;
+
+   /* Count the elements afresh as they are added, since a split of
+      the root records the length and weight so far. */
+   uLength = oChildSet->uLength;
+   uWeight = oChildSet->uWeight;
+   oChildSet->uWeight = 0;
+   for (oChildSet->uLength = 0; oChildSet->uLength < uLength;
+        oChildSet->uLength++)
+   {
+      pEntry = &oChildSet->pEntries[oChildSet->uLength];
+      if (! ChildSet_btreeAdd(oChildSet, pEntry))
+      {
+         ChildSet_btreeFree(oChildSet->pvRoot, oChildSet->uHeight);
+         oChildSet->pvRoot = NULL;
+         oChildSet->uLength = uLength;
+         oChildSet->uWeight = uWeight;
+         return 0;
+      }
+      oChildSet->uWeight += pEntry->uWeight;
+   }
+
+   free(oChildSet->pEntries);
+   oChildSet->pEntries = NULL;
+   oChildSet->uPhysLength = 0;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* The sorted array                                                   */
+/*--------------------------------------------------------------------*/
+
+/* Make oChildSet's entry array large enough to hold one more entry.
+   Return 1 (TRUE) if successful and 0 (FALSE) if insufficient memory
+   is available. */
+
+static int ChildSet_reserve(ChildSet_T oChildSet)
+{
+   const size_t GROWTH_FACTOR = 2;
+
+   size_t uNewLength;
+   struct ChildSetEntry *pNewEntries;
+
+   assert(oChildSet != NULL);
+
+   if (oChildSet->uLength < oChildSet->uPhysLength)
+      return 1;
+
+   uNewLength = GROWTH_FACTOR * oChildSet->uPhysLength;
+   pNewEntries = (struct ChildSetEntry*)
+      realloc(oChildSet->pEntries,
+              sizeof(struct ChildSetEntry) * uNewLength);
+   if (pNewEntries == NULL)
+      return 0;
+
+   oChildSet->uPhysLength = uNewLength;
+   oChildSet->pEntries = pNewEntries;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Promote oChildSet to the representation of its kind.  If that is
+   not possible because insufficient memory is available, oChildSet
+   simply remains a sorted array. */
+
+static void ChildSet_promote(ChildSet_T oChildSet)
+{
+   const size_t INITIAL_SLOT_FACTOR = 4;
+
+   assert(oChildSet != NULL);
+
+   if (oChildSet->eKind == CHILDSET_BTREE)
+      (void)ChildSet_promoteToBtree(oChildSet);
+   else
+      (void)ChildSet_rehash(oChildSet,
+                            INITIAL_SLOT_FACTOR * PROMOTE_LENGTH);
+}
+
+/*--------------------------------------------------------------------*/
+/* The interface                                                      */
+/*--------------------------------------------------------------------*/
+
+ChildSet_T ChildSet_new(enum ChildSet_Kind eKind)
+{
+   ChildSet_T oChildSet;
+
+   oChildSet = (struct ChildSet*)malloc(sizeof(struct ChildSet));
+   if (oChildSet == NULL)
+      return NULL;
+
+   oChildSet->uLength = 0;
+   oChildSet->uWeight = 0;
+   oChildSet->eKind = eKind;
+   oChildSet->uPhysLength = MIN_PHYS_LENGTH;
+   oChildSet->pEntries = (struct ChildSetEntry*)
+      malloc(sizeof(struct ChildSetEntry) * MIN_PHYS_LENGTH);
+   if (oChildSet->pEntries == NULL)
+   {
+      free(oChildSet);
+      return NULL;
+   }
+   oChildSet->iSorted = 1;
+   oChildSet->pSlots = NULL;
+   oChildSet->uSlotCount = 0;
+   oChildSet->pvRoot = NULL;
+   oChildSet->uHeight = 0;
+
+   return oChildSet;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ChildSet_free(ChildSet_T oChildSet)
+{
+   assert(oChildSet != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   if (oChildSet->pvRoot != NULL)
+      ChildSet_btreeFree(oChildSet->pvRoot, oChildSet->uHeight);
+   free(oChildSet->pSlots);
+   free(oChildSet->pEntries);
+   free(oChildSet);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t ChildSet_getLength(ChildSet_T oChildSet)
+{
+   assert(oChildSet != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   return oChildSet->uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t ChildSet_getWeight(ChildSet_T oChildSet)
+{
+   assert(oChildSet != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   return oChildSet->uWeight;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ChildSet_get(ChildSet_T oChildSet, size_t uIndex)
+{
+   void *pvNode;
+   struct ChildSetInner *pInner;
+   size_t uHeight;
+   size_t uChild;
+
+   assert(oChildSet != NULL);
+   assert(uIndex < oChildSet->uLength);
+   assert(ChildSet_isValid(oChildSet));
+
+   if (oChildSet->pvRoot == NULL)
+   {
+      ChildSet_sort(oChildSet);
+      return (void*)oChildSet->pEntries[uIndex].pvElement;
+   }
+
+   pvNode = oChildSet->pvRoot;
+   for (uHeight = oChildSet->uHeight; uHeight > 0; uHeight--)
+   {
+      pInner = (struct ChildSetInner*)pvNode;
+      for (uChild = 0; uIndex >= pInner->auSizes[uChild]; uChild++)
+         uIndex -= pInner->auSizes[uChild];
+      pvNode = pInner->apvChildren[uChild];
+   }
+   return (void*)((struct ChildSetLeaf*)pvNode)->
+      aEntries[uIndex].pvElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ChildSet_find(ChildSet_T oChildSet, const char *pcKey,
+                    size_t uKeyLength)
+{
+   struct ChildSetLeaf *pLeaf;
+   size_t uIndex;
+
+   assert(oChildSet != NULL);
+   assert(pcKey != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   if (oChildSet->pSlots != NULL)
+      return (void*)oChildSet->pSlots[
+         ChildSet_probe(oChildSet, pcKey, uKeyLength,
+                        ChildSet_hash(pcKey, uKeyLength))
+         ].oEntry.pvElement;
+
+   if (oChildSet->pvRoot != NULL)
+   {
+      pLeaf = ChildSet_btreeLeaf(oChildSet, pcKey, uKeyLength, NULL);
+      if (ChildSet_bsearchEntries(pLeaf->aEntries, pLeaf->uCount,
+                                  pcKey, uKeyLength, &uIndex))
+         return (void*)pLeaf->aEntries[uIndex].pvElement;
+      return NULL;
+   }
+
+   if (ChildSet_bsearchEntries(oChildSet->pEntries, oChildSet->uLength,
+                               pcKey, uKeyLength, &uIndex))
+      return (void*)oChildSet->pEntries[uIndex].pvElement;
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ChildSet_bsearch(ChildSet_T oChildSet, const char *pcKey,
+                     size_t uKeyLength, size_t *puIndex)
+{
+   struct ChildSetLeaf *pLeaf;
+   size_t uRank;
+   int iFound;
+
+   assert(oChildSet != NULL);
+   assert(pcKey != NULL);
+   assert(puIndex != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   if (oChildSet->pvRoot != NULL)
+   {
+      pLeaf = ChildSet_btreeLeaf(oChildSet, pcKey, uKeyLength, &uRank);
+      iFound = ChildSet_bsearchEntries(pLeaf->aEntries, pLeaf->uCount,
+                                       pcKey, uKeyLength, puIndex);
+      *puIndex += uRank;
+      return iFound;
+   }
+
+   ChildSet_sort(oChildSet);
+   return ChildSet_bsearchEntries(oChildSet->pEntries,
+                                  oChildSet->uLength, pcKey,
+                                  uKeyLength, puIndex);
+}
+
+/*--------------------------------------------------------------------*/
+
+int ChildSet_add(ChildSet_T oChildSet, const char *pcKey,
+                 size_t uKeyLength, const void *pvElement,
+                 size_t uWeight)
+{
+   size_t uIndex;
+   struct ChildSetEntry *pEntry;
+   struct ChildSetEntry oNew;
+
+   assert(oChildSet != NULL);
+   assert(pcKey != NULL);
+   assert(pvElement != NULL);
+   assert(ChildSet_find(oChildSet, pcKey, uKeyLength) == NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   oNew.pcKey = pcKey;
+   oNew.uKeyLength = uKeyLength;
+   oNew.pvElement = pvElement;
+   oNew.uWeight = uWeight;
+
+   if (oChildSet->pvRoot == NULL)
+   {
+      if (! ChildSet_reserve(oChildSet))
+         return 0;
+      if (oChildSet->pSlots == NULL &&
+          oChildSet->uLength == PROMOTE_LENGTH)
+         ChildSet_promote(oChildSet);
+   }
+
+   if (oChildSet->pvRoot != NULL)
+   {
+      if (! ChildSet_btreeAdd(oChildSet, &oNew))
+         return 0;
+   }
+   else if (oChildSet->pSlots != NULL)
+   {
+      if (! ChildSet_addHashed(oChildSet, &oNew))
+         return 0;
+   }
+   else
+   {
+      (void)ChildSet_bsearchEntries(oChildSet->pEntries,
+                                    oChildSet->uLength, pcKey,
+                                    uKeyLength, &uIndex);
+      pEntry = &oChildSet->pEntries[uIndex];
+      memmove(pEntry + 1, pEntry, sizeof(struct ChildSetEntry) *
+                                  (oChildSet->uLength - uIndex));
+      *pEntry = oNew;
+   }
+   oChildSet->uLength++;
+   oChildSet->uWeight += uWeight;
+
+   assert(ChildSet_isValid(oChildSet));
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ChildSet_remove(ChildSet_T oChildSet, const char *pcKey,
+                      size_t uKeyLength)
+{
+   const void *pvOldElement;
+   size_t uIndex;
+   size_t uWeight;
+   struct ChildSetEntry *pEntry;
+
+   assert(oChildSet != NULL);
+   assert(pcKey != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   if (oChildSet->pvRoot != NULL)
+   {
+      pvOldElement = ChildSet_btreeRemove(oChildSet, pcKey, uKeyLength,
+                                          &uWeight);
+      if (pvOldElement != NULL)
+      {
+         oChildSet->uLength--;
+         oChildSet->uWeight -= uWeight;
+      }
+      return (void*)pvOldElement;
+   }
+
+   if (oChildSet->pSlots != NULL)
+   {
+      uIndex = ChildSet_probe(oChildSet, pcKey, uKeyLength,
+                              ChildSet_hash(pcKey, uKeyLength));
+      pvOldElement = oChildSet->pSlots[uIndex].oEntry.pvElement;
+      if (pvOldElement == NULL)
+         return NULL;
+      oChildSet->uWeight -= oChildSet->pSlots[uIndex].oEntry.uWeight;
+      ChildSet_emptySlot(oChildSet, uIndex);
+      oChildSet->iSorted = 0;
+      oChildSet->uLength--;
+      assert(ChildSet_isValid(oChildSet));
+      return (void*)pvOldElement;
+   }
+
+   if (! ChildSet_bsearchEntries(oChildSet->pEntries, oChildSet->uLength,
+                                 pcKey, uKeyLength, &uIndex))
+      return NULL;
+   pEntry = &oChildSet->pEntries[uIndex];
+   pvOldElement = pEntry->pvElement;
+   oChildSet->uWeight -= pEntry->uWeight;
+   oChildSet->uLength--;
+   memmove(pEntry, pEntry + 1, sizeof(struct ChildSetEntry) *
+                               (oChildSet->uLength - uIndex));
+
+   assert(ChildSet_isValid(oChildSet));
+   return (void*)pvOldElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ChildSet_setWeight(ChildSet_T oChildSet, const char *pcKey,
+                       size_t uKeyLength, size_t uWeight)
+{
+   struct ChildSetInner *apPath[BTREE_MAX_HEIGHT];
+   size_t auPath[BTREE_MAX_HEIGHT];
+   size_t uDepth = 0;
+   struct ChildSetInner *pInner;
+   struct ChildSetEntry *pEntry;
+   void *pvNode;
+   size_t uHeight;
+   size_t uIndex;
+   size_t uOldWeight;
+   size_t u;
+
+   assert(oChildSet != NULL);
+   assert(pcKey != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   if (oChildSet->pvRoot != NULL)
+   {
+      pvNode = oChildSet->pvRoot;
+      for (uHeight = oChildSet->uHeight; uHeight > 0; uHeight--)
+      {
+         pInner = (struct ChildSetInner*)pvNode;
+         apPath[uDepth] = pInner;
+         auPath[uDepth] = ChildSet_innerIndex(pInner, pcKey,
+                                              uKeyLength);
+         pvNode = pInner->apvChildren[auPath[uDepth]];
+         uDepth++;
+      }
+      if (! ChildSet_bsearchEntries(
+             ((struct ChildSetLeaf*)pvNode)->aEntries,
+             ((struct ChildSetLeaf*)pvNode)->uCount,
+             pcKey, uKeyLength, &uIndex))
+         return 0;
+      pEntry = &((struct ChildSetLeaf*)pvNode)->aEntries[uIndex];
+      uOldWeight = pEntry->uWeight;
+      for (u = 0; u < uDepth; u++)
+         apPath[u]->auWeights[auPath[u]] =
+            apPath[u]->auWeights[auPath[u]] - uOldWeight + uWeight;
+   }
+   else if (oChildSet->pSlots != NULL)
+   {
+      pEntry = &oChildSet->pSlots[
+         ChildSet_probe(oChildSet, pcKey, uKeyLength,
+                        ChildSet_hash(pcKey, uKeyLength))].oEntry;
+      if (pEntry->pvElement == NULL)
+         return 0;
+      uOldWeight = pEntry->uWeight;
+      /* Keep the sorted view valid too, rather than discard it. */
+      if (oChildSet->iSorted)
+      {
+         (void)ChildSet_bsearchEntries(oChildSet->pEntries,
+                                       oChildSet->uLength, pcKey,
+                                       uKeyLength, &uIndex);
+         oChildSet->pEntries[uIndex].uWeight = uWeight;
+      }
+   }
+   else
+   {
+      if (! ChildSet_bsearchEntries(oChildSet->pEntries,
+                                    oChildSet->uLength, pcKey,
+                                    uKeyLength, &uIndex))
+         return 0;
+      pEntry = &oChildSet->pEntries[uIndex];
+      uOldWeight = pEntry->uWeight;
+   }
+
+   pEntry->uWeight = uWeight;
+   oChildSet->uWeight = oChildSet->uWeight - uOldWeight + uWeight;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ChildSet_seek(ChildSet_T oChildSet, const char *pcKey,
+                    size_t uKeyLength, ChildSet_Cursor *pCursor)
+{
+   struct ChildSetLeaf *pLeaf;
+   size_t uIndex;
+
+   assert(oChildSet != NULL);
+   assert(pcKey != NULL);
+   assert(pCursor != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   if (oChildSet->pvRoot == NULL)
+   {
+      ChildSet_sort(oChildSet);
+      (void)ChildSet_bsearchEntries(oChildSet->pEntries,
+                                    oChildSet->uLength, pcKey,
+                                    uKeyLength, &uIndex);
+      pCursor->pvBlock = NULL;
+      pCursor->uOffset = uIndex;
+      if (uIndex == oChildSet->uLength)
+         return NULL;
+      return (void*)oChildSet->pEntries[uIndex].pvElement;
+   }
+
+   pLeaf = ChildSet_btreeLeaf(oChildSet, pcKey, uKeyLength, NULL);
+   (void)ChildSet_bsearchEntries(pLeaf->aEntries, pLeaf->uCount,
+                                 pcKey, uKeyLength, &uIndex);
+   /* The key is past the end of its leaf, so the next one starts
+      with the first larger key. */
+   if (uIndex == pLeaf->uCount)
+   {
+      if (pLeaf->pNext == NULL)
+         return NULL;
+      pLeaf = pLeaf->pNext;
+      uIndex = 0;
+   }
+   pCursor->pvBlock = pLeaf;
+   pCursor->uOffset = uIndex;
+   return (void*)pLeaf->aEntries[uIndex].pvElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ChildSet_seekWeight(ChildSet_T oChildSet, size_t *puOffset,
+                          ChildSet_Cursor *pCursor)
+{
+   void *pvNode;
+   struct ChildSetInner *pInner;
+   struct ChildSetLeaf *pLeaf;
+   size_t uHeight;
+   size_t uChild;
+   size_t u;
+
+   assert(oChildSet != NULL);
+   assert(puOffset != NULL);
+   assert(pCursor != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   if (*puOffset >= oChildSet->uWeight)
+      return NULL;
+
+   if (oChildSet->pvRoot == NULL)
+   {
+      ChildSet_sort(oChildSet);
+      for (u = 0; *puOffset >= oChildSet->pEntries[u].uWeight; u++)
+         *puOffset -= oChildSet->pEntries[u].uWeight;
+      pCursor->pvBlock = NULL;
+      pCursor->uOffset = u;
+      return (void*)oChildSet->pEntries[u].pvElement;
+   }
+
+   pvNode = oChildSet->pvRoot;
+   for (uHeight = oChildSet->uHeight; uHeight > 0; uHeight--)
+   {
+      pInner = (struct ChildSetInner*)pvNode;
+      for (uChild = 0; *puOffset >= pInner->auWeights[uChild]; uChild++)
+         *puOffset -= pInner->auWeights[uChild];
+      pvNode = pInner->apvChildren[uChild];
+   }
+   pLeaf = (struct ChildSetLeaf*)pvNode;
+   for (u = 0; *puOffset >= pLeaf->aEntries[u].uWeight; u++)
+      *puOffset -= pLeaf->aEntries[u].uWeight;
+   pCursor->pvBlock = pLeaf;
+   pCursor->uOffset = u;
+   return (void*)pLeaf->aEntries[u].pvElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ChildSet_first(ChildSet_T oChildSet, ChildSet_Cursor *pCursor)
+{
+   struct ChildSetLeaf *pLeaf;
+
+   assert(oChildSet != NULL);
+   assert(pCursor != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   pCursor->uOffset = 0;
+   if (oChildSet->pvRoot == NULL)
+   {
+      pCursor->pvBlock = NULL;
+      if (oChildSet->uLength == 0)
+         return NULL;
+      ChildSet_sort(oChildSet);
+      return (void*)oChildSet->pEntries[0].pvElement;
+   }
+
+   pLeaf = ChildSet_btreeFirstLeaf(oChildSet->pvRoot,
+                                   oChildSet->uHeight);
+   pCursor->pvBlock = pLeaf;
+   if (pLeaf->uCount == 0)
+      return NULL;
+   return (void*)pLeaf->aEntries[0].pvElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ChildSet_next(ChildSet_T oChildSet, ChildSet_Cursor *pCursor)
+{
+   struct ChildSetLeaf *pLeaf;
+
+   assert(oChildSet != NULL);
+   assert(pCursor != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   pCursor->uOffset++;
+   if (pCursor->pvBlock == NULL)
+   {
+      if (pCursor->uOffset >= oChildSet->uLength)
+         return NULL;
+      assert(oChildSet->iSorted);
+      return (void*)oChildSet->pEntries[pCursor->uOffset].pvElement;
+   }
+
+   pLeaf = (struct ChildSetLeaf*)pCursor->pvBlock;
+   if (pCursor->uOffset == pLeaf->uCount)
+   {
+      pLeaf = pLeaf->pNext;
+      if (pLeaf == NULL)
+         return NULL;
+      pCursor->pvBlock = pLeaf;
+      pCursor->uOffset = 0;
+   }
+   return (void*)pLeaf->aEntries[pCursor->uOffset].pvElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ChildSet_map(ChildSet_T oChildSet,
+                  void (*pfApply)(void *pvElement, void *pvExtra),
+                  const void *pvExtra)
+{
+   struct ChildSetLeaf *pLeaf;
+   struct ChildSetLeaf *pNext;
+   size_t u;
+
+   assert(oChildSet != NULL);
+   assert(pfApply != NULL);
+   assert(ChildSet_isValid(oChildSet));
+
+   if (oChildSet->pvRoot != NULL)
+   {
+      /* Fetch each next leaf first, in case pfApply frees keys. */
+      for (pLeaf = ChildSet_btreeFirstLeaf(oChildSet->pvRoot,
+                                           oChildSet->uHeight);
+           pLeaf != NULL; pLeaf = pNext)
+      {
+         pNext = pLeaf->pNext;
+         for (u = 0; u < pLeaf->uCount; u++)
+            (*pfApply)((void*)pLeaf->aEntries[u].pvElement,
+                       (void*)pvExtra);
+      }
+      return;
+   }
+
+   if (oChildSet->pSlots == NULL)
+   {
+      for (u = 0; u < oChildSet->uLength; u++)
+         (*pfApply)((void*)oChildSet->pEntries[u].pvElement,
+                    (void*)pvExtra);
+      return;
+   }
+
+   for (u = 0; u < oChildSet->uSlotCount; u++)
+      if (oChildSet->pSlots[u].oEntry.pvElement != NULL)
+         (*pfApply)((void*)oChildSet->pSlots[u].oEntry.pvElement,
+                    (void*)pvExtra);
+}
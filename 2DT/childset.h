@@ -0,0 +1,172 @@
+/*--------------------------------------------------------------------*/
+/* childset.h                                                         */
+/*--------------------------------------------------------------------*/
+
+#ifndef CHILDSET_INCLUDED
+#define CHILDSET_INCLUDED
+
+#include <stddef.h>
+
+/* A ChildSet_T object is a set of elements, each identified by a
+   string key, that can be accessed both by key and by rank in the
+   lexicographic order of the keys.  While a set is small its elements
+   are kept in a sorted array; once it grows past a threshold it is
+   promoted to the representation of its kind:
+
+   CHILDSET_HASH  : a hash table, whose sorted order is rebuilt lazily
+                    the next time an element is accessed by rank.
+   CHILDSET_BTREE : a B+-tree, which keeps its sorted order at all
+                    times, at the cost of O(log n) lookups by key.
+
+   Keys are not copied: the memory for each key must remain valid and
+   unchanged for as long as its element is in the set.  Keys need not
+   be NUL-terminated; they are compared byte by byte, as strcmp would
+   compare them.
+
+   Each element also carries a weight, and the set can be searched for
+   the element at a given offset into the concatenation of the
+   elements' weights, in O(log n) time once it is a B+-tree. */
+
+typedef struct ChildSet *ChildSet_T;
+
+/* The representations that a large ChildSet_T can be promoted to. */
+
+enum ChildSet_Kind { CHILDSET_HASH, CHILDSET_BTREE };
+
+/* A ChildSet_Cursor is a position in a ChildSet_T, for iterating over
+   its elements in order without the cost of a lookup by rank.  A
+   cursor is invalidated by any addition or removal.  Its fields are
+   private to the ChildSet module. */
+
+typedef struct ChildSet_Cursor
+{
+   void *pvBlock;
+   size_t uOffset;
+} ChildSet_Cursor;
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new, empty ChildSet_T object that is promoted to eKind
+   once it grows large, or NULL if insufficient memory is
+   available. */
+
+ChildSet_T ChildSet_new(enum ChildSet_Kind eKind);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oChildSet.  The elements themselves are not freed. */
+
+void ChildSet_free(ChildSet_T oChildSet);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of elements in oChildSet. */
+
+size_t ChildSet_getLength(ChildSet_T oChildSet);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the total weight of the elements of oChildSet. */
+
+size_t ChildSet_getWeight(ChildSet_T oChildSet);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the element of oChildSet whose key has rank uIndex in
+   lexicographic order. */
+
+void *ChildSet_get(ChildSet_T oChildSet, size_t uIndex);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the element of oChildSet whose key is the uKeyLength bytes
+   at pcKey, or NULL if there is no such element.  Never reorders
+   oChildSet, so this is O(1) expected once the set is hashed. */
+
+void *ChildSet_find(ChildSet_T oChildSet, const char *pcKey,
+                    size_t uKeyLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Binary search oChildSet for the key that is the uKeyLength bytes at
+   pcKey.  If the key is found, then assign its rank to *puIndex and
+   return 1.  If it is not found, then assign the rank it would have
+   to *puIndex and return 0. */
+
+int ChildSet_bsearch(ChildSet_T oChildSet, const char *pcKey,
+                     size_t uKeyLength, size_t *puIndex);
+
+/*--------------------------------------------------------------------*/
+
+/* Add pvElement to oChildSet with the key that is the uKeyLength
+   bytes at pcKey and with weight uWeight.  The key must not already
+   be in oChildSet.  Return 1 (TRUE) if successful, or 0 (FALSE) if
+   insufficient memory is available. */
+
+int ChildSet_add(ChildSet_T oChildSet, const char *pcKey,
+                 size_t uKeyLength, const void *pvElement,
+                 size_t uWeight);
+
+/*--------------------------------------------------------------------*/
+
+/* Change the weight of the element of oChildSet whose key is the
+   uKeyLength bytes at pcKey to uWeight.  Return 1 (TRUE) if
+   successful, or 0 (FALSE) if there is no such element. */
+
+int ChildSet_setWeight(ChildSet_T oChildSet, const char *pcKey,
+                       size_t uKeyLength, size_t uWeight);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove and return the element of oChildSet whose key is the
+   uKeyLength bytes at pcKey, or return NULL if there is no such
+   element. */
+
+void *ChildSet_remove(ChildSet_T oChildSet, const char *pcKey,
+                      size_t uKeyLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the first element of oChildSet in key order and set
+   *pCursor to its position, or return NULL if oChildSet is empty. */
+
+void *ChildSet_first(ChildSet_T oChildSet, ChildSet_Cursor *pCursor);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the first element of oChildSet, in key order, whose key is
+   not less than the uKeyLength bytes at pcKey, and set *pCursor to
+   its position, or return NULL if there is none.  This costs
+   O(log n). */
+
+void *ChildSet_seek(ChildSet_T oChildSet, const char *pcKey,
+                    size_t uKeyLength, ChildSet_Cursor *pCursor);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the element of oChildSet, in key order, whose share of the
+   concatenated weights of the elements contains offset *puOffset, and
+   set *pCursor to its position; assign to *puOffset the offset within
+   that element's share.  Return NULL if *puOffset is not less than
+   the total weight of oChildSet. */
+
+void *ChildSet_seekWeight(ChildSet_T oChildSet, size_t *puOffset,
+                          ChildSet_Cursor *pCursor);
+
+/*--------------------------------------------------------------------*/
+
+/* Advance *pCursor to the next element of oChildSet in key order and
+   return that element, or return NULL if there is none. */
+
+void *ChildSet_next(ChildSet_T oChildSet, ChildSet_Cursor *pCursor);
+
+/*--------------------------------------------------------------------*/
+
+/* Apply function *pfApply to each element of oChildSet, passing
+   pvExtra as an extra argument, in no particular order. */
+
+void ChildSet_map(ChildSet_T oChildSet,
+                  void (*pfApply)(void *pvElement, void *pvExtra),
+                  const void *pvExtra);
+
+#endif
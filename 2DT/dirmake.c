@@ -0,0 +1,434 @@
+/*--------------------------------------------------------------------*/
+/* dirmake.c                                                          */
+/*--------------------------------------------------------------------*/
+
+/* for the POSIX directory, file status and thread interfaces */
+#define _POSIX_C_SOURCE 200112L
+
+#include "dirmake.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The number of directories, and of bytes of their paths, for which
+   a DirMake first has room. */
+
+enum { MIN_DIRS = 64, MIN_PATH_BYTES = 1024 };
+
+/*--------------------------------------------------------------------*/
+
+/* The states of a directory of a DirMake. */
+
+enum DirMake_State { DIRMAKE_PENDING, DIRMAKE_MADE, DIRMAKE_FAILED };
+
+/*--------------------------------------------------------------------*/
+
+/* A directory of a DirMake. */
+
+struct DirMakeDir
+{
+   /* The number of the directory's parent, or 0 for the top one. */
+   size_t uParent;
+
+   /* The offset of the directory's NUL-terminated path on disk in the
+      DirMake's buffer of paths. */
+   size_t uPath;
+
+   /* Whether the directory has been made, and if making it failed, the
+      errno value that it failed with, which is set in advance for a
+      name that cannot be made. */
+   enum DirMake_State eState;
+   int iError;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A DirMake is an array of its directories, in pre-order, with a
+   buffer of their paths, and while it is being run, the state that
+   the threads making its directories share: a queue of the numbers
+   of the directories whose parents have been made, those from uHead
+   to uTail being still to make. */
+
+struct DirMake
+{
+   /* The directories, and how many there are and there is room
+      for. */
+   struct DirMakeDir *psDirs;
+   size_t uLength;
+   size_t uMaxLength;
+
+   /* The paths, and how many bytes of them there are and there is
+      room for. */
+   char *pcPaths;
+   size_t uPathBytes;
+   size_t uMaxPathBytes;
+
+   /* The numbers of the directories that failed, in the order in
+      which they were added, and how many there are. */
+   size_t *auFailures;
+   size_t uFailures;
+
+   /* The number of directories made. */
+   size_t uMade;
+
+   /* For each directory, the position in auKids of the numbers of its
+      children, the children of directory u being at positions
+      auFirstKid[u] to auFirstKid[u + 1]. */
+   size_t *auFirstKid;
+   size_t *auKids;
+
+   /* The queue, and how many threads are making a directory. */
+   size_t *auQueue;
+   size_t uHead;
+   size_t uTail;
+   size_t uBusy;
+
+   /* The lock on the queue, and the condition that a thread waiting
+      for a directory to make waits on. */
+   pthread_mutex_t sLock;
+   pthread_cond_t sMore;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Ensure that oMake has room for uBytes more bytes of paths.  Return
+   1 (TRUE), or 0 (FALSE) if insufficient memory is available. */
+
+static int DirMake_reservePaths(DirMake_T oMake, size_t uBytes)
+{
+   char *pcMore;
+   size_t uMaxPathBytes;
+
+   assert(oMake != NULL);
+
+   if (oMake->uPathBytes + uBytes <= oMake->uMaxPathBytes)
+      return 1;
+   uMaxPathBytes = 2 * oMake->uMaxPathBytes;
+   if (uMaxPathBytes < oMake->uPathBytes + uBytes)
+      uMaxPathBytes = oMake->uPathBytes + uBytes;
+   pcMore = (char *)realloc(oMake->pcPaths, uMaxPathBytes);
+   if (pcMore == NULL)
+      return 0;
+   oMake->pcPaths = pcMore;
+   oMake->uMaxPathBytes = uMaxPathBytes;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+DirMake_T DirMake_new(const char *pcTop)
+{
+   DirMake_T oMake;
+   size_t uTopLength;
+
+   assert(pcTop != NULL);
+
+   oMake = (DirMake_T)malloc(sizeof(struct DirMake));
+   if (oMake == NULL)
+      return NULL;
+   uTopLength = strlen(pcTop);
+   oMake->uMaxLength = MIN_DIRS;
+   oMake->psDirs = (struct DirMakeDir *)malloc(
+      oMake->uMaxLength * sizeof(struct DirMakeDir));
+   oMake->uMaxPathBytes = MIN_PATH_BYTES;
+   if (oMake->uMaxPathBytes < uTopLength + 1)
+      oMake->uMaxPathBytes = uTopLength + 1;
+   oMake->pcPaths = (char *)malloc(oMake->uMaxPathBytes);
+   if (oMake->psDirs == NULL || oMake->pcPaths == NULL)
+   {
+      free(oMake->psDirs);
+      free(oMake->pcPaths);
+      free(oMake);
+      return NULL;
+   }
+
+   memcpy(oMake->pcPaths, pcTop, uTopLength + 1);
+   oMake->uPathBytes = uTopLength + 1;
+   oMake->psDirs[0].uParent = 0;
+   oMake->psDirs[0].uPath = 0;
+   oMake->psDirs[0].eState = DIRMAKE_PENDING;
+   oMake->psDirs[0].iError = 0;
+   oMake->uLength = 1;
+   oMake->auFailures = NULL;
+   oMake->uFailures = 0;
+   oMake->uMade = 0;
+   return oMake;
+}
+
+/*--------------------------------------------------------------------*/
+
+void DirMake_free(DirMake_T oMake)
+{
+   if (oMake == NULL)
+      return;
+   free(oMake->psDirs);
+   free(oMake->pcPaths);
+   free(oMake->auFailures);
+   free(oMake);
+}
+
+/*--------------------------------------------------------------------*/
+
+int DirMake_add(DirMake_T oMake, size_t uParent, const char *pcName,
+                size_t uNameLength, size_t *puIndex)
+{
+   struct DirMakeDir *psMore;
+   struct DirMakeDir *psDir;
+   size_t uParentLength;
+
+   assert(oMake != NULL);
+   assert(uParent < oMake->uLength);
+   assert(pcName != NULL);
+   assert(puIndex != NULL);
+
+   if (oMake->uLength == oMake->uMaxLength)
+   {
+      psMore = (struct DirMakeDir *)realloc(
+         oMake->psDirs,
+         2 * oMake->uMaxLength * sizeof(struct DirMakeDir));
+      if (psMore == NULL)
+         return 0;
+      oMake->psDirs = psMore;
+      oMake->uMaxLength *= 2;
+   }
+   uParentLength =
+      strlen(oMake->pcPaths + oMake->psDirs[uParent].uPath);
+   if (!DirMake_reservePaths(oMake, uParentLength + uNameLength + 2))
+      return 0;
+
+   psDir = &oMake->psDirs[oMake->uLength];
+   psDir->uParent = uParent;
+   psDir->uPath = oMake->uPathBytes;
+   psDir->eState = DIRMAKE_PENDING;
+   psDir->iError = 0;
+   if (uNameLength == 0 || memchr(pcName, '\0', uNameLength) != NULL ||
+       memchr(pcName, '/', uNameLength) != NULL ||
+       (uNameLength == 1 && pcName[0] == '.') ||
+       (uNameLength == 2 && pcName[0] == '.' && pcName[1] == '.'))
+      psDir->iError = EINVAL;
+
+   memcpy(oMake->pcPaths + oMake->uPathBytes,
+          oMake->pcPaths + oMake->psDirs[uParent].uPath, uParentLength);
+   oMake->uPathBytes += uParentLength;
+   oMake->pcPaths[oMake->uPathBytes++] = '/';
+   memcpy(oMake->pcPaths + oMake->uPathBytes, pcName, uNameLength);
+   oMake->uPathBytes += uNameLength;
+   oMake->pcPaths[oMake->uPathBytes++] = '\0';
+
+   *puIndex = oMake->uLength++;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make directory uIndex of oMake, whose parent has been made, and
+   return 0, or the errno value that making it failed with. */
+
+static int DirMake_makeDir(DirMake_T oMake, size_t uIndex)
+{
+   const char *pcPath;
+   struct stat sStat;
+   int iError;
+
+   assert(oMake != NULL);
+
+   if (oMake->psDirs[uIndex].iError != 0)
+      return oMake->psDirs[uIndex].iError;
+   pcPath = oMake->pcPaths + oMake->psDirs[uIndex].uPath;
+   if (mkdir(pcPath, 0777) == 0)
+      return 0;
+   iError = errno;
+   /* a directory already there is as good as one made */
+   if (iError == EEXIST && stat(pcPath, &sStat) == 0 &&
+       S_ISDIR(sStat.st_mode))
+      return 0;
+   return iError;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make directories of the DirMake at pvMake until there are none
+   left whose parents have been made.  Return NULL. */
+
+static void *DirMake_work(void *pvMake)
+{
+   DirMake_T oMake = (DirMake_T)pvMake;
+   size_t uIndex;
+   size_t u;
+   int iError;
+
+   assert(oMake != NULL);
+
+   (void)pthread_mutex_lock(&oMake->sLock);
+   for (;;)
+   {
+      /* the last directory being made may yet have children */
+      while (oMake->uHead == oMake->uTail && oMake->uBusy > 0)
+         (void)pthread_cond_wait(&oMake->sMore, &oMake->sLock);
+      if (oMake->uHead == oMake->uTail)
+         break;
+      uIndex = oMake->auQueue[oMake->uHead++];
+      oMake->uBusy++;
+      (void)pthread_mutex_unlock(&oMake->sLock);
+
+      iError = DirMake_makeDir(oMake, uIndex);
+
+      (void)pthread_mutex_lock(&oMake->sLock);
+      oMake->uBusy--;
+      if (iError != 0)
+      {
+         oMake->psDirs[uIndex].eState = DIRMAKE_FAILED;
+         oMake->psDirs[uIndex].iError = iError;
+      }
+      else
+      {
+         oMake->psDirs[uIndex].eState = DIRMAKE_MADE;
+         oMake->uMade++;
+         for (u = oMake->auFirstKid[uIndex];
+              u < oMake->auFirstKid[uIndex + 1]; u++)
+            oMake->auQueue[oMake->uTail++] = oMake->auKids[u];
+      }
+      if (oMake->uHead < oMake->uTail || oMake->uBusy == 0)
+         (void)pthread_cond_broadcast(&oMake->sMore);
+   }
+   (void)pthread_cond_broadcast(&oMake->sMore);
+   (void)pthread_mutex_unlock(&oMake->sLock);
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Assign to the fields of oMake that DirMake_work uses the children
+   of each of its directories and a queue holding the top one.
+   Return 1 (TRUE), or 0 (FALSE) if insufficient memory is
+   available. */
+
+static int DirMake_prepare(DirMake_T oMake)
+{
+   size_t u;
+
+   assert(oMake != NULL);
+
+   oMake->auKids = NULL;
+   oMake->auQueue = NULL;
+   oMake->auFirstKid = (size_t *)calloc(oMake->uLength + 1,
+                                        sizeof(size_t));
+   oMake->auKids = (size_t *)malloc(oMake->uLength * sizeof(size_t));
+   oMake->auQueue = (size_t *)malloc(oMake->uLength * sizeof(size_t));
+   if (oMake->auFirstKid == NULL || oMake->auKids == NULL ||
+       oMake->auQueue == NULL)
+      return 0;
+
+   /* count each directory's children, sum the counts so that
+      auFirstKid[u] is the end of u's, and then place them from the
+      last back, which leaves auFirstKid[u] at the first of u's */
+   for (u = 1; u < oMake->uLength; u++)
+      oMake->auFirstKid[oMake->psDirs[u].uParent]++;
+   for (u = 1; u <= oMake->uLength; u++)
+      oMake->auFirstKid[u] += oMake->auFirstKid[u - 1];
+   for (u = oMake->uLength - 1; u > 0; u--)
+      oMake->auKids[--oMake->auFirstKid[oMake->psDirs[u].uParent]] = u;
+
+   oMake->auQueue[0] = 0;
+   oMake->uHead = 0;
+   oMake->uTail = 1;
+   oMake->uBusy = 0;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int DirMake_run(DirMake_T oMake, size_t uThreads)
+{
+   pthread_t *psThreads = NULL;
+   size_t uStarted = 0;
+   size_t u;
+   int iOk;
+
+   assert(oMake != NULL);
+   assert(oMake->auFailures == NULL);
+
+   iOk = DirMake_prepare(oMake);
+   if (iOk && pthread_mutex_init(&oMake->sLock, NULL) != 0)
+      iOk = 0;
+   if (iOk && pthread_cond_init(&oMake->sMore, NULL) != 0)
+   {
+      (void)pthread_mutex_destroy(&oMake->sLock);
+      iOk = 0;
+   }
+   if (!iOk)
+   {
+      free(oMake->auFirstKid);
+      free(oMake->auKids);
+      free(oMake->auQueue);
+      return 0;
+   }
+
+   /* the calling thread is one of the makers, so making goes on with
+      however many of the others start */
+   if (uThreads > 1)
+      psThreads = (pthread_t *)malloc((uThreads - 1)
+                                      * sizeof(pthread_t));
+   if (psThreads != NULL)
+      while (uStarted < uThreads - 1 &&
+             pthread_create(&psThreads[uStarted], NULL, DirMake_work,
+                            oMake) == 0)
+         uStarted++;
+   (void)DirMake_work(oMake);
+   for (u = 0; u < uStarted; u++)
+      (void)pthread_join(psThreads[u], NULL);
+   free(psThreads);
+
+   (void)pthread_cond_destroy(&oMake->sMore);
+   (void)pthread_mutex_destroy(&oMake->sLock);
+   free(oMake->auFirstKid);
+   free(oMake->auKids);
+
+   /* the queue has room for every directory, so it can hold the
+      failures in its place */
+   for (u = 0; u < oMake->uLength; u++)
+      if (oMake->psDirs[u].eState == DIRMAKE_FAILED)
+         oMake->auQueue[oMake->uFailures++] = u;
+   oMake->auFailures = oMake->auQueue;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t DirMake_getMade(DirMake_T oMake)
+{
+   assert(oMake != NULL);
+
+   return oMake->uMade;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t DirMake_getFailures(DirMake_T oMake)
+{
+   assert(oMake != NULL);
+
+   return oMake->uFailures;
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *DirMake_getFailure(DirMake_T oMake, size_t uFailure,
+                               int *piError)
+{
+   struct DirMakeDir *psDir;
+
+   assert(oMake != NULL);
+   assert(uFailure < oMake->uFailures);
+   assert(piError != NULL);
+
+   psDir = &oMake->psDirs[oMake->auFailures[uFailure]];
+   *piError = psDir->iError;
+   return oMake->pcPaths + psDir->uPath;
+}
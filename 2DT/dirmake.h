@@ -0,0 +1,77 @@
+/*--------------------------------------------------------------------*/
+/* dirmake.h                                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef DIRMAKE_INCLUDED
+#define DIRMAKE_INCLUDED
+
+#include <stddef.h>
+
+/* A DirMake_T object is a hierarchy of directories to be made on
+   disk, by several threads at once, each of which makes the next
+   directory whose parent has been made.  The directories are
+   numbered in the order in which they are added, which must be
+   pre-order, the top one being 0.  A directory that already exists
+   counts as made; one that cannot be made is a failure, and the
+   directories below it are not attempted. */
+
+typedef struct DirMake *DirMake_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new DirMake_T object whose top directory has the path on
+   disk pcTop, or NULL if insufficient memory is available. */
+
+DirMake_T DirMake_new(const char *pcTop);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oMake. */
+
+void DirMake_free(DirMake_T oMake);
+
+/*--------------------------------------------------------------------*/
+
+/* Add to oMake the next directory in pre-order, whose name is the
+   uNameLength bytes at pcName, below the directory uParent, and
+   assign its number to *puIndex.  A name that is not that of a
+   directory of its own, such as "..", or that holds a '\0', fails
+   with EINVAL when made.  Return 1 (TRUE), or 0 (FALSE) if
+   insufficient memory is available. */
+
+int DirMake_add(DirMake_T oMake, size_t uParent, const char *pcName,
+                size_t uNameLength, size_t *puIndex);
+
+/*--------------------------------------------------------------------*/
+
+/* Make the directories of oMake on disk, with uThreads threads, or
+   with as many as can be started, counting the calling one.  oMake
+   must not have been run before.  Return 1 (TRUE), or 0 (FALSE),
+   having made none, if insufficient memory is available. */
+
+int DirMake_run(DirMake_T oMake, size_t uThreads);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of directories that DirMake_run made or found
+   already there. */
+
+size_t DirMake_getMade(DirMake_T oMake);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of directories that DirMake_run failed to
+   make. */
+
+size_t DirMake_getFailures(DirMake_T oMake);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the path on disk of failure uFailure of oMake, in the order
+   in which the directories were added, and assign the errno value
+   that making it failed with to *piError. */
+
+const char *DirMake_getFailure(DirMake_T oMake, size_t uFailure,
+                               int *piError);
+
+#endif
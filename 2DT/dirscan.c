@@ -0,0 +1,546 @@
+/*--------------------------------------------------------------------*/
+/* dirscan.c                                                          */
+/*--------------------------------------------------------------------*/
+
+/* for the POSIX directory, file status and thread interfaces */
+#define _POSIX_C_SOURCE 200112L
+
+#include "dirscan.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The number of directories for which a DirScan first has room. */
+
+enum { MIN_DIRS = 64 };
+
+/*--------------------------------------------------------------------*/
+
+/* A directory of a DirScan. */
+
+struct DirScanDir
+{
+   /* The directory's path on disk, which the DirScanDir owns, and its
+      length. */
+   char *pcPath;
+   size_t uPathLength;
+
+   /* The offset in pcPath of the directory's name. */
+   size_t uName;
+
+   /* The numbers of the directory's subdirectories, in sorted order,
+      and how many there are. */
+   size_t *auChildren;
+   size_t uChildren;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A DirScan is an array of its directories, in the order in which
+   they were found, and while it is being read, the state that the
+   threads reading it share.  The directories from uNext on are still
+   to be read. */
+
+struct DirScan
+{
+   /* The directories, and how many there are and there is room
+      for. */
+   struct DirScanDir **ppsDirs;
+   size_t uLength;
+   size_t uMaxLength;
+
+   /* The length of the top directory's path on disk. */
+   size_t uTopLength;
+
+   /* The number of entries skipped. */
+   size_t uSkipped;
+
+   /* The number of the next directory to read, and how many threads
+      are reading one. */
+   size_t uNext;
+   size_t uBusy;
+
+   /* Whether the reading has failed, and why. */
+   enum DirScan_Status eStatus;
+
+   /* The lock on the fields above, and the condition that a thread
+      waiting for a directory to read waits on. */
+   pthread_mutex_t sLock;
+   pthread_cond_t sMore;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new directory whose path is the uPathLength bytes at
+   pcPath, followed by a slash and the uNameLength bytes at pcName if
+   pcName is not NULL, or NULL if insufficient memory is available. */
+
+static struct DirScanDir *DirScan_newDir(const char *pcPath,
+                                         size_t uPathLength,
+                                         const char *pcName,
+                                         size_t uNameLength)
+{
+   struct DirScanDir *psDir;
+   size_t uLength = uPathLength;
+
+   assert(pcPath != NULL);
+
+   if (pcName != NULL)
+      uLength += 1 + uNameLength;
+   psDir = (struct DirScanDir *)malloc(sizeof(struct DirScanDir));
+   if (psDir == NULL)
+      return NULL;
+   psDir->pcPath = (char *)malloc(uLength + 1);
+   if (psDir->pcPath == NULL)
+   {
+      free(psDir);
+      return NULL;
+   }
+   memcpy(psDir->pcPath, pcPath, uPathLength);
+   psDir->uName = 0;
+   if (pcName != NULL)
+   {
+      psDir->pcPath[uPathLength] = '/';
+      memcpy(psDir->pcPath + uPathLength + 1, pcName, uNameLength);
+      psDir->uName = uPathLength + 1;
+   }
+   psDir->pcPath[uLength] = '\0';
+   psDir->uPathLength = uLength;
+   psDir->auChildren = NULL;
+   psDir->uChildren = 0;
+   return psDir;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free psDir. */
+
+static void DirScan_freeDir(struct DirScanDir *psDir)
+{
+   assert(psDir != NULL);
+
+   free(psDir->pcPath);
+   free(psDir->auChildren);
+   free(psDir);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return <0, 0, or >0 as the name of the directory at pvDir1 comes
+   before, is, or comes after that of the directory at pvDir2. */
+
+static int DirScan_compareDirs(const void *pvDir1, const void *pvDir2)
+{
+   const struct DirScanDir *psDir1 =
+      *(const struct DirScanDir *const *)pvDir1;
+   const struct DirScanDir *psDir2 =
+      *(const struct DirScanDir *const *)pvDir2;
+
+   return strcmp(psDir1->pcPath + psDir1->uName,
+                 psDir2->pcPath + psDir2->uName);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read the entries of psDir, assigning its subdirectories, in sorted
+   order, to *pppsChildren, which the caller must free, and how many
+   there are to *puChildren, and adding the number of the other
+   entries to *puSkipped.  Only the subdirectories are allocated, not
+   yet numbered.  Return DIRSCAN_OK, or why the reading failed, having
+   freed the subdirectories. */
+
+static enum DirScan_Status DirScan_readDir(struct DirScanDir *psDir,
+                                           struct DirScanDir
+                                              ***pppsChildren,
+                                           size_t *puChildren,
+                                           size_t *puSkipped)
+{
+   DIR *psStream;
+   struct dirent *psEntry;
+   struct stat sStat;
+   struct DirScanDir **ppsChildren = NULL;
+   struct DirScanDir **ppsMore;
+   struct DirScanDir *psChild;
+   size_t uChildren = 0;
+   size_t uMaxChildren = 0;
+   size_t uNameLength;
+   enum DirScan_Status eStatus = DIRSCAN_OK;
+
+   assert(psDir != NULL);
+   assert(pppsChildren != NULL);
+   assert(puChildren != NULL);
+   assert(puSkipped != NULL);
+
+   psStream = opendir(psDir->pcPath);
+   if (psStream == NULL)
+      return errno == ENOMEM ? DIRSCAN_MEMORY : DIRSCAN_IO;
+
+   for (;;)
+   {
+      errno = 0;
+      psEntry = readdir(psStream);
+      if (psEntry == NULL)
+      {
+         if (errno != 0)
+            eStatus = DIRSCAN_IO;
+         break;
+      }
+      if (strcmp(psEntry->d_name, ".") == 0 ||
+          strcmp(psEntry->d_name, "..") == 0)
+         continue;
+
+      uNameLength = strlen(psEntry->d_name);
+      psChild = DirScan_newDir(psDir->pcPath, psDir->uPathLength,
+                               psEntry->d_name, uNameLength);
+      if (psChild == NULL)
+      {
+         eStatus = DIRSCAN_MEMORY;
+         break;
+      }
+      /* an entry removed since it was listed is as good as never
+         there */
+      if (lstat(psChild->pcPath, &sStat) != 0)
+      {
+         if (errno != ENOENT)
+            (*puSkipped)++;
+         DirScan_freeDir(psChild);
+         continue;
+      }
+      if (!S_ISDIR(sStat.st_mode))
+      {
+         (*puSkipped)++;
+         DirScan_freeDir(psChild);
+         continue;
+      }
+
+      if (uChildren == uMaxChildren)
+      {
+         uMaxChildren = uMaxChildren == 0 ? 8 : 2 * uMaxChildren;
+         ppsMore = (struct DirScanDir **)realloc(
+            ppsChildren, uMaxChildren * sizeof(struct DirScanDir *));
+         if (ppsMore == NULL)
+         {
+            DirScan_freeDir(psChild);
+            eStatus = DIRSCAN_MEMORY;
+            break;
+         }
+         ppsChildren = ppsMore;
+      }
+      ppsChildren[uChildren++] = psChild;
+   }
+   (void)closedir(psStream);
+
+   if (eStatus != DIRSCAN_OK)
+   {
+      while (uChildren > 0)
+         DirScan_freeDir(ppsChildren[--uChildren]);
+      free(ppsChildren);
+      return eStatus;
+   }
+
+   if (uChildren > 1)
+      qsort(ppsChildren, uChildren, sizeof(struct DirScanDir *),
+            DirScan_compareDirs);
+   *pppsChildren = ppsChildren;
+   *puChildren = uChildren;
+   return DIRSCAN_OK;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Number the uChildren directories at ppsChildren, the subdirectories
+   of psDir, adding them to oScan to be read in turn.  Return
+   DIRSCAN_OK, or DIRSCAN_MEMORY, having added none of them, if
+   insufficient memory is available.  oScan must be locked. */
+
+static enum DirScan_Status DirScan_addChildren(DirScan_T oScan,
+                                               struct DirScanDir *psDir,
+                                               struct DirScanDir
+                                                  **ppsChildren,
+                                               size_t uChildren)
+{
+   struct DirScanDir **ppsMore;
+   size_t uMaxLength;
+   size_t u;
+
+   assert(oScan != NULL);
+   assert(psDir != NULL);
+
+   if (uChildren == 0)
+      return DIRSCAN_OK;
+   psDir->auChildren = (size_t *)malloc(uChildren * sizeof(size_t));
+   if (psDir->auChildren == NULL)
+      return DIRSCAN_MEMORY;
+   if (oScan->uLength + uChildren > oScan->uMaxLength)
+   {
+      uMaxLength = 2 * oScan->uMaxLength;
+      if (uMaxLength < oScan->uLength + uChildren)
+         uMaxLength = oScan->uLength + uChildren;
+      ppsMore = (struct DirScanDir **)realloc(
+         oScan->ppsDirs, uMaxLength * sizeof(struct DirScanDir *));
+      if (ppsMore == NULL)
+      {
+         free(psDir->auChildren);
+         psDir->auChildren = NULL;
+         return DIRSCAN_MEMORY;
+      }
+      oScan->ppsDirs = ppsMore;
+      oScan->uMaxLength = uMaxLength;
+   }
+
+   for (u = 0; u < uChildren; u++)
+   {
+      psDir->auChildren[u] = oScan->uLength;
+      oScan->ppsDirs[oScan->uLength++] = ppsChildren[u];
+   }
+   psDir->uChildren = uChildren;
+   return DIRSCAN_OK;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read directories of the DirScan at pvScan until there are none
+   left to read, or the reading has failed.  Return NULL. */
+
+static void *DirScan_work(void *pvScan)
+{
+   DirScan_T oScan = (DirScan_T)pvScan;
+   struct DirScanDir *psDir;
+   struct DirScanDir **ppsChildren;
+   size_t uChildren;
+   size_t uSkipped;
+   enum DirScan_Status eStatus;
+
+   assert(oScan != NULL);
+
+   (void)pthread_mutex_lock(&oScan->sLock);
+   for (;;)
+   {
+      /* the last directory being read may yet have subdirectories */
+      while (oScan->eStatus == DIRSCAN_OK &&
+             oScan->uNext == oScan->uLength && oScan->uBusy > 0)
+         (void)pthread_cond_wait(&oScan->sMore, &oScan->sLock);
+      if (oScan->eStatus != DIRSCAN_OK ||
+          oScan->uNext == oScan->uLength)
+         break;
+      psDir = oScan->ppsDirs[oScan->uNext++];
+      oScan->uBusy++;
+      (void)pthread_mutex_unlock(&oScan->sLock);
+
+      ppsChildren = NULL;
+      uChildren = 0;
+      uSkipped = 0;
+      eStatus = DirScan_readDir(psDir, &ppsChildren, &uChildren,
+                                &uSkipped);
+
+      (void)pthread_mutex_lock(&oScan->sLock);
+      if (eStatus == DIRSCAN_OK)
+         eStatus = DirScan_addChildren(oScan, psDir, ppsChildren,
+                                       uChildren);
+      if (eStatus != DIRSCAN_OK)
+      {
+         while (uChildren > 0)
+            DirScan_freeDir(ppsChildren[--uChildren]);
+         if (oScan->eStatus == DIRSCAN_OK)
+            oScan->eStatus = eStatus;
+      }
+      free(ppsChildren);
+      oScan->uSkipped += uSkipped;
+      oScan->uBusy--;
+      if (uChildren > 0 || oScan->uBusy == 0 ||
+          oScan->eStatus != DIRSCAN_OK)
+         (void)pthread_cond_broadcast(&oScan->sMore);
+   }
+   (void)pthread_cond_broadcast(&oScan->sMore);
+   (void)pthread_mutex_unlock(&oScan->sLock);
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+DirScan_T DirScan_read(const char *pcPath, size_t uThreads,
+                       enum DirScan_Status *peStatus)
+{
+   DirScan_T oScan;
+   pthread_t *psThreads = NULL;
+   size_t uStarted = 0;
+   size_t u;
+
+   assert(pcPath != NULL);
+   assert(peStatus != NULL);
+
+   oScan = (DirScan_T)malloc(sizeof(struct DirScan));
+   if (oScan == NULL)
+   {
+      *peStatus = DIRSCAN_MEMORY;
+      return NULL;
+   }
+   oScan->ppsDirs = (struct DirScanDir **)malloc(
+      MIN_DIRS * sizeof(struct DirScanDir *));
+   if (oScan->ppsDirs == NULL)
+   {
+      free(oScan);
+      *peStatus = DIRSCAN_MEMORY;
+      return NULL;
+   }
+   oScan->uMaxLength = MIN_DIRS;
+   oScan->uTopLength = strlen(pcPath);
+   oScan->ppsDirs[0] = DirScan_newDir(pcPath, oScan->uTopLength,
+                                      NULL, 0);
+   if (oScan->ppsDirs[0] == NULL)
+   {
+      free(oScan->ppsDirs);
+      free(oScan);
+      *peStatus = DIRSCAN_MEMORY;
+      return NULL;
+   }
+   oScan->uLength = 1;
+   oScan->uSkipped = 0;
+   oScan->uNext = 0;
+   oScan->uBusy = 0;
+   oScan->eStatus = DIRSCAN_OK;
+   if (pthread_mutex_init(&oScan->sLock, NULL) != 0)
+   {
+      DirScan_freeDir(oScan->ppsDirs[0]);
+      free(oScan->ppsDirs);
+      free(oScan);
+      *peStatus = DIRSCAN_MEMORY;
+      return NULL;
+   }
+   if (pthread_cond_init(&oScan->sMore, NULL) != 0)
+   {
+      (void)pthread_mutex_destroy(&oScan->sLock);
+      DirScan_freeDir(oScan->ppsDirs[0]);
+      free(oScan->ppsDirs);
+      free(oScan);
+      *peStatus = DIRSCAN_MEMORY;
+      return NULL;
+   }
+
+   /* the calling thread is one of the readers, so reading goes on
+      with however many of the others start */
+   if (uThreads > 1)
+      psThreads = (pthread_t *)malloc((uThreads - 1)
+                                      * sizeof(pthread_t));
+   if (psThreads != NULL)
+      while (uStarted < uThreads - 1 &&
+             pthread_create(&psThreads[uStarted], NULL, DirScan_work,
+                            oScan) == 0)
+         uStarted++;
+   (void)DirScan_work(oScan);
+   for (u = 0; u < uStarted; u++)
+      (void)pthread_join(psThreads[u], NULL);
+   free(psThreads);
+
+   (void)pthread_cond_destroy(&oScan->sMore);
+   (void)pthread_mutex_destroy(&oScan->sLock);
+   if (oScan->eStatus != DIRSCAN_OK)
+   {
+      *peStatus = oScan->eStatus;
+      for (u = 0; u < oScan->uLength; u++)
+         DirScan_freeDir(oScan->ppsDirs[u]);
+      free(oScan->ppsDirs);
+      free(oScan);
+      return NULL;
+   }
+   *peStatus = DIRSCAN_OK;
+   return oScan;
+}
+
+/*--------------------------------------------------------------------*/
+
+void DirScan_free(DirScan_T oScan)
+{
+   size_t u;
+
+   if (oScan == NULL)
+      return;
+   for (u = 0; u < oScan->uLength; u++)
+      DirScan_freeDir(oScan->ppsDirs[u]);
+   free(oScan->ppsDirs);
+   free(oScan);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t DirScan_getLength(DirScan_T oScan)
+{
+   assert(oScan != NULL);
+
+   return oScan->uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t DirScan_getSkipped(DirScan_T oScan)
+{
+   assert(oScan != NULL);
+
+   return oScan->uSkipped;
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *DirScan_getPath(DirScan_T oScan, size_t uIndex,
+                            size_t *puLength)
+{
+   struct DirScanDir *psDir;
+
+   assert(oScan != NULL);
+   assert(uIndex < oScan->uLength);
+   assert(puLength != NULL);
+
+   psDir = oScan->ppsDirs[uIndex];
+   if (uIndex == 0)
+   {
+      *puLength = 0;
+      return psDir->pcPath + psDir->uPathLength;
+   }
+   *puLength = psDir->uPathLength - oScan->uTopLength - 1;
+   return psDir->pcPath + oScan->uTopLength + 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *DirScan_getName(DirScan_T oScan, size_t uIndex,
+                            size_t *puLength)
+{
+   struct DirScanDir *psDir;
+
+   assert(oScan != NULL);
+   assert(uIndex < oScan->uLength);
+   assert(puLength != NULL);
+
+   psDir = oScan->ppsDirs[uIndex];
+   *puLength = psDir->uPathLength - psDir->uName;
+   return psDir->pcPath + psDir->uName;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t DirScan_getChildren(DirScan_T oScan, size_t uIndex)
+{
+   assert(oScan != NULL);
+   assert(uIndex < oScan->uLength);
+
+   return oScan->ppsDirs[uIndex]->uChildren;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t DirScan_getChild(DirScan_T oScan, size_t uIndex,
+                        size_t uChild)
+{
+   assert(oScan != NULL);
+   assert(uIndex < oScan->uLength);
+   assert(uChild < oScan->ppsDirs[uIndex]->uChildren);
+
+   return oScan->ppsDirs[uIndex]->auChildren[uChild];
+}
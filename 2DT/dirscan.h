@@ -0,0 +1,88 @@
+/*--------------------------------------------------------------------*/
+/* dirscan.h                                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef DIRSCAN_INCLUDED
+#define DIRSCAN_INCLUDED
+
+#include <stddef.h>
+
+/* A DirScan_T object holds the names of the directories in a
+   hierarchy of directories on disk, read by several threads at once,
+   each of which takes the next directory that none has read yet.
+   Entries that are not directories, symbolic links to directories
+   among them, are counted but not kept.  The directories are
+   numbered, the top one being 0, and each one's subdirectories are
+   kept in sorted order, as strcmp orders their names. */
+
+typedef struct DirScan *DirScan_T;
+
+/* The ways in which reading a hierarchy can fail. */
+
+enum DirScan_Status { DIRSCAN_OK, DIRSCAN_MEMORY, DIRSCAN_IO };
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new DirScan_T object for the hierarchy rooted at the
+   directory whose path on disk is pcPath, read with uThreads threads,
+   or with as many as can be started, counting the calling one.
+   Return NULL, and assign why to *peStatus, if pcPath or a directory
+   below it is not a directory that can be read, or insufficient
+   memory is available. */
+
+DirScan_T DirScan_read(const char *pcPath, size_t uThreads,
+                       enum DirScan_Status *peStatus);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oScan. */
+
+void DirScan_free(DirScan_T oScan);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of directories in oScan, counting the top one. */
+
+size_t DirScan_getLength(DirScan_T oScan);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of entries below the top directory of oScan that
+   were not kept since they are not directories. */
+
+size_t DirScan_getSkipped(DirScan_T oScan);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the path of directory uIndex of oScan relative to the top
+   one, which is "" for the top one itself, and assign its length to
+   *puLength.  The path is NUL-terminated. */
+
+const char *DirScan_getPath(DirScan_T oScan, size_t uIndex,
+                            size_t *puLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the name of directory uIndex of oScan, the last component
+   of its path, and assign its length to *puLength.  The name is
+   NUL-terminated. */
+
+const char *DirScan_getName(DirScan_T oScan, size_t uIndex,
+                            size_t *puLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of subdirectories of directory uIndex of
+   oScan. */
+
+size_t DirScan_getChildren(DirScan_T oScan, size_t uIndex);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of the subdirectory at position uChild, in
+   sorted order, of directory uIndex of oScan. */
+
+size_t DirScan_getChild(DirScan_T oScan, size_t uIndex,
+                        size_t uChild);
+
+#endif
@@ -10,6 +10,7 @@
   A Directory Tree is a representation of a directory hierarchy.
 */
 
+#include <stddef.h>
 #include "a4def.h"
 
 /*
@@ -23,20 +24,194 @@
 */
 int DT_insertPath(char* path);
 
+/*
+  Like DT_insertPath, but with path given as the len characters at
+  path, which need not be NUL-terminated and are not modified, so a
+  client can pass a slice of a larger buffer without copying it.
+*/
+int DT_insertPathN(const char* path, size_t len);
+
 /*
   Returns TRUE if the tree contains the full path parameter
   and FALSE otherwise.
 */
 boolean DT_containsPath(char* path);
 
+/*
+  Like DT_containsPath, but with path given as the len characters at
+  path, which need not be NUL-terminated.
+*/
+boolean DT_containsPathN(const char* path, size_t len);
+
+/*
+  Answers DT_containsPath for each of the n paths in paths at once,
+  setting bit i % CHAR_BIT of bitmap[i / CHAR_BIT] if the tree
+  contains paths[i] and clearing it otherwise, so bitmap must have
+  room for at least (n + CHAR_BIT - 1) / CHAR_BIT bytes.
+  Returns SUCCESS if the bits are set, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns MEMORY_ERROR if unable to allocate working space.
+
+  Each directory that holds any of the paths is found from the root
+  only once per call, so a batch of paths from a few directories
+  costs about one lookup of a name per path, however deep they are.
+*/
+int DT_containsMany(char** paths, size_t n, unsigned char* bitmap);
+
+/*
+  Calls callback on the name (the last component of the path) of each
+  immediate child of the directory at path, in lexicographic order,
+  passing ctx along unchanged. The names are owned by the tree and
+  must not be changed; callback must not change the tree.
+  Returns SUCCESS if path is found, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns NO_SUCH_PATH if not found.
+
+  The cost is proportional to the number of children of path alone,
+  not to the size of the tree.
+*/
+int DT_listDir(char* path, void (*callback)(const char* name, void* ctx),
+               void* ctx);
+
+/*
+  Like DT_listDir, but stores the names of the first (at most)
+  capacity children of path in names[0..capacity-1], and the number
+  of children path has in *numChildren, so that a client whose array
+  is too small can tell how large it needs to be. The names remain valid
+  until the next change to the tree.
+  Returns SUCCESS if path is found, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns NO_SUCH_PATH if not found.
+*/
+int DT_listDirInto(char* path, const char** names, size_t capacity,
+                   size_t* numChildren);
+
+/* Aggregate statistics of a directory hierarchy, from DT_stat */
+struct DT_Stat {
+   /* the number of directories in the hierarchy, including its root */
+   size_t numDirs;
+   /* the number of immediate children of the hierarchy's root */
+   size_t numChildren;
+   /* the length of the hierarchy's listing, as from DT_list with no
+      limit, not counting its terminating NUL */
+   size_t listingBytes;
+};
+
+/*
+  Stores in *stat the aggregate statistics of the hierarchy rooted
+  at path. These are maintained as the tree changes, so this costs
+  no more than finding path, however large the hierarchy is.
+  Returns SUCCESS if path is found, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns NO_SUCH_PATH if not found.
+*/
+int DT_stat(char* path, struct DT_Stat* stat);
+
 /*
   Removes the directory hierarchy rooted at path.
   Returns SUCCESS if found and removed, otherwise:
   returns INITIALIZATION_ERROR if not in an initialized state,
-  returns NO_SUCH_PATH if not found.
+  returns NO_SUCH_PATH if not found,
+  returns MEMORY_ERROR if unable to make the parts of copies (see
+    DT_clone) that were sharing its directories.
 */
 int DT_rmPath(char* path);
 
+/*
+  Like DT_rmPath, but with path given as the len characters at path,
+  which need not be NUL-terminated.
+*/
+int DT_rmPathN(const char* path, size_t len);
+
+/*
+  Moves the directory hierarchy rooted at src so that it is rooted at
+  dst instead, as a new child of dst's parent, which must exist.
+  Open handles on directories in the hierarchy follow it.
+  Returns SUCCESS if moved, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns NO_SUCH_PATH if src or dst's parent is not found,
+  returns ALREADY_IN_TREE if dst is already in the tree,
+  returns CONFLICTING_PATH if src is the root, or dst is src or in
+    its hierarchy, or dst has no parent,
+  returns MEMORY_ERROR if unable to allocate the new paths.
+
+  The hierarchy is relinked as a whole rather than rebuilt, so the
+  only cost for each directory in it is a copy of its new path.
+*/
+int DT_move(const char* src, const char* dst);
+
+/*
+  Copies the directory hierarchy rooted at src so that the copy is
+  rooted at dst, as a new child of dst's parent, which must exist.
+  Returns SUCCESS if copied, otherwise returns as DT_move does.
+
+  The copy shares the directories of src's hierarchy until either
+  one changes, and is only made a level at a time as it is visited
+  or as the two hierarchies diverge, so copying a hierarchy costs
+  about as much as inserting one directory, however large it is.
+  Without the index of names, looking paths up in the copy costs no
+  memory either, but listing its paths (with DT_toString, DT_list,
+  DT_scanRange, DT_glob or DT_findByName) makes the directories
+  listed. A filter of paths must take each path of the copy, which
+  costs time in proportion to their number, and with the index of
+  names the copy is made in full at once.
+*/
+int DT_clone(const char* src, const char* dst);
+
+/*
+  A DT_Dir_T is a handle on a directory in the tree, from which the
+  operations below resolve paths relative to that directory rather
+  than from the root, so they cost time proportional to the number
+  of components of the relative path alone, not to the depth of
+  the directory.
+
+  Handles do not pin their directories: removing a directory, or any
+  of its ancestors, or destroying the tree, leaves its handles stale,
+  and operations on a stale handle fail as for a path that is not in
+  the tree. Reinserting the same path does not revive them.
+*/
+typedef struct DT_Dir* DT_Dir_T;
+
+/*
+  Opens a handle on the directory at path, and stores it in *dir.
+  The client owns the handle, and must close it with DT_closeDir,
+  even if it goes stale.
+  Returns SUCCESS if path is found, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns NO_SUCH_PATH if not found,
+  returns MEMORY_ERROR if unable to allocate the handle, or to make
+    the directory if it is part of a copy (see DT_clone).
+*/
+int DT_openDir(const char* path, DT_Dir_T* dir);
+
+/*
+  Closes and frees the handle dir.
+*/
+void DT_closeDir(DT_Dir_T dir);
+
+/*
+  Like DT_insertPath, but inserts the path rel relative to the
+  directory of dir: "b/c" names the grandchild c of dir by way of
+  its child b.
+  Returns NO_SUCH_PATH if dir is stale, and otherwise as
+  DT_insertPath.
+*/
+int DT_insertAt(DT_Dir_T dir, const char* rel);
+
+/*
+  Returns TRUE if the tree contains the path rel relative to the
+  directory of dir, and FALSE otherwise, or if dir is stale.
+*/
+boolean DT_containsAt(DT_Dir_T dir, const char* rel);
+
+/*
+  Like DT_rmPath, but removes the hierarchy rooted at the path rel
+  relative to the directory of dir, which itself cannot be removed
+  this way. Returns NO_SUCH_PATH if dir is stale, and otherwise as
+  DT_rmPath.
+*/
+int DT_rmAt(DT_Dir_T dir, const char* rel);
+
 /*
   Sets the data structure to initialized status.
   The data structure is initially empty.
@@ -45,11 +220,116 @@ int DT_rmPath(char* path);
 */
 int DT_init(void);
 
+/*
+  How a directory indexes its children once it has too many of them
+  to keep in a small sorted array:
+  DT_INDEX_HASH  - a hash table: fastest insertion and lookup, but
+                   the sorted order is rebuilt on demand after changes.
+  DT_INDEX_BTREE - a B+-tree: O(log n) insertion, removal and lookup,
+                   and always in order, for large directories that
+                   are listed as often as they are changed.
+*/
+enum DT_ChildIndex { DT_INDEX_HASH, DT_INDEX_BTREE };
+
+/* Configuration for DT_initWithOptions */
+struct DT_Options {
+   /* how wide directories index their children */
+   enum DT_ChildIndex childIndex;
+   /* the number of counters in a filter of the paths in the tree,
+      with which DT_containsPath answers most queries for absent
+      paths without a lookup, or 0 for no filter. With k counters
+      per directory, about 8% of absent paths get past it for k = 4,
+      1% for k = 8, and 0.1% for k = 16. It costs one byte per
+      counter. */
+   size_t filterCounters;
+   /* whether to keep an index of the directories by name, with which
+      DT_findByName costs time proportional to the number of matches
+      rather than to the size of the tree. It costs about as much
+      memory again as the tree's own indexes of children. */
+   boolean indexNames;
+   /* a file descriptor open on an image (see DT_save) to start the
+      tree from, or -1 to start it empty */
+   int imageFd;
+   /* a file descriptor open for reading and writing on a journal, or
+      -1 for none. Every change is appended to the journal, so that
+      DT_initWithOptions can replay the changes since the image was
+      saved after a crash. */
+   int journalFd;
+   /* the number of microseconds that a change waits in memory before
+      it is written to the journal and synchronized with the disk
+      (with fsync), with all the others waiting then, so that one
+      synchronization serves them all. A thread of the journal's own
+      writes the changes when their wait is up, even if no more are
+      made; the changes of an open transaction wait for it to be
+      committed. 0 synchronizes every change as it is made, with no
+      thread. */
+   size_t journalWindow;
+};
+
+/*
+  Fills in *options with the defaults that DT_init uses.
+  Clients should call this before changing any fields, so that they
+  get sensible values for fields added in the future.
+*/
+void DT_defaultOptions(struct DT_Options* options);
+
+/*
+  Like DT_init, but configured by *options. The tree starts as the
+  image of options->imageFd, if there is one, with the records of the
+  journal of options->journalFd, if there is one, that come after
+  those the image holds (see DT_checkpoint) replayed on top of it. A
+  record torn by a crash while it was being written is dropped.
+  Returns INITIALIZATION_ERROR if already initialized,
+  MEMORY_ERROR if unable to allocate the filter, the index of names,
+  or the tree,
+  IO_ERROR if unable to read the image or the journal, or if the
+  journal does not carry on from the image,
+  and SUCCESS otherwise.
+*/
+int DT_initWithOptions(const struct DT_Options* options);
+
+/* Counters of the lookup cache, from DT_getCacheStats */
+struct DT_CacheStats {
+   /* lookups that resumed from a cached ancestor of their path */
+   size_t hits;
+   /* lookups that had to start again from the root */
+   size_t misses;
+};
+
+/*
+  Stores in *stats the counters of the cache of recently resolved
+  directories that lookups resume from, which DT_init and
+  DT_initWithOptions reset. Runs of operations on paths under the
+  same directory should mostly hit.
+*/
+void DT_getCacheStats(struct DT_CacheStats* stats);
+
+/* Counters of the path filter, from DT_getFilterStats */
+struct DT_FilterStats {
+   /* queries that the filter answered as absent on its own */
+   size_t rejected;
+   /* queries that the filter passed on to a lookup */
+   size_t passed;
+   /* of those, the ones for paths that were absent after all */
+   size_t falsePositives;
+};
+
+/*
+  Stores in *stats the counters of the filter of DT_containsPath,
+  which DT_initWithOptions resets. The filter's false-positive rate
+  is falsePositives / (rejected + falsePositives). All are 0 if
+  there is no filter.
+*/
+void DT_getFilterStats(struct DT_FilterStats* stats);
+
 /*
   Removes all contents of the data structure and
   returns it to uninitialized status.
   Returns INITIALIZATION_ERROR if not already initialized,
-  and SUCCESS otherwise.
+  IO_ERROR, having destroyed the tree all the same, if unable to
+  write and synchronize the journal's waiting changes, and SUCCESS
+  otherwise. The directories that snapshots not yet released still
+  share (see DT_snapshot) are freed with the last of them.
 */
 int DT_destroy(void);
 
@@ -63,4 +343,379 @@ int DT_destroy(void);
 */
 char* DT_toString(void);
 
+/*
+  Returns one page of the listing of the hierarchy rooted at path:
+  the part of the string that DT_toString would return for that
+  hierarchy alone that covers at most limit directories, starting
+  from the one at position offset (where path itself is at 0). If
+  total is not NULL, stores in *total the number of directories in
+  the whole hierarchy, so that clients can tell how many pages
+  there are.
+
+  Returns NULL if the structure is not initialized, path is not in
+  the tree, or there is an allocation error.
+
+  Locating the first directory of the page does not visit the ones
+  before it, so fetching any page costs time proportional to the
+  depth of the tree and the size of the page, plus the logarithm of
+  the number of children per directory when their index is
+  DT_INDEX_BTREE (or that number itself with DT_INDEX_HASH).
+
+  Allocates memory for the returned string,
+  which is then owned by client!
+*/
+char* DT_list(char* path, size_t offset, size_t limit, size_t* total);
+
+/*
+  Calls callback, passing ctx along unchanged, on the path of each
+  directory in the tree that comes at or after from and before to in
+  the order of DT_toString, in that order. That order compares paths
+  component by component, each component as strcmp would, so that a
+  directory comes after its ancestors and before its later siblings
+  ("a" < "a/b" < "a-b"). Neither from nor to need be in the tree, and
+  either may be NULL for no bound on that side. The paths are owned
+  by the tree and must not be changed; callback must not change the
+  tree.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns MEMORY_ERROR if unable to make a part of a copy (see
+    DT_clone) that it comes to.
+
+  Finding the first directory in range costs one search among the
+  children of each directory along from, and each directory visited
+  after that costs one comparison with to.
+*/
+int DT_scanRange(const char* from, const char* to,
+                 void (*callback)(const char* path, void* ctx),
+                 void* ctx);
+
+/*
+  Calls callback, passing ctx along unchanged, on the path of each
+  directory in the tree that matches pattern, in the order of
+  DT_toString. The pattern is matched component by component: "**"
+  as a whole component matches any number of components, even none;
+  in any other component, '*' matches any run of characters and '?'
+  any one character, within the component. So "**" matches every
+  directory in the tree, and "a/b?" matches a/b1 and a/bc but not
+  a/b or a/b12. The paths are owned by the tree and must not be
+  changed; callback must not change the tree.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns MEMORY_ERROR if unable to allocate working space.
+
+  Components without wildcards are looked up by name, and ones that
+  begin with characters other than wildcards only visit the children
+  that begin with those, so the cost is proportional to the number
+  of directories that match some prefix of pattern, not to the size
+  of the tree.
+*/
+int DT_glob(const char* pattern,
+            void (*callback)(const char* path, void* ctx), void* ctx);
+
+/*
+  Calls callback, passing ctx along unchanged, on the path of each
+  directory in the tree whose name (the last component of its path)
+  is name, in no particular order. The paths are owned by the tree
+  and must not be changed; callback must not change the tree.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns MEMORY_ERROR if unable to make a part of a copy (see
+    DT_clone) that it comes to.
+
+  With the index of names of DT_Options, this costs time proportional
+  to the number of such directories; without it, to the size of the
+  tree.
+*/
+int DT_findByName(const char* name,
+                  void (*callback)(const char* path, void* ctx),
+                  void* ctx);
+
+/*
+  A DT_Snap_T is a snapshot: a read-only view of the tree as it was
+  when the snapshot was taken, which later changes to the tree do not
+  show through. Snapshots outlive the tree itself, even DT_destroy.
+
+  Taking a snapshot costs O(1). The snapshot shares the tree's
+  directories until they change: the first change below a directory
+  since the snapshot was taken gives the snapshot its own copy of the
+  directories along the path from the root, each with a placeholder
+  for each of its children, and the rest stays shared. Reading a
+  snapshot never changes it, nor the tree.
+*/
+typedef struct DT_Snap* DT_Snap_T;
+
+/*
+  Takes a snapshot of the tree, and stores it in *snap, with one
+  reference to it, which the client owns and must release with
+  DT_releaseSnapshot.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns MEMORY_ERROR if unable to allocate the snapshot.
+*/
+int DT_snapshot(DT_Snap_T* snap);
+
+/*
+  Adds a reference to snap, so that it lasts until
+  DT_releaseSnapshot has been called once more than this.
+*/
+void DT_retainSnapshot(DT_Snap_T snap);
+
+/*
+  Releases a reference to snap, and frees it if that was the last.
+*/
+void DT_releaseSnapshot(DT_Snap_T snap);
+
+/*
+  Returns TRUE if snap contains path, and FALSE otherwise.
+*/
+boolean DT_containsIn(DT_Snap_T snap, const char* path);
+
+/*
+  Like DT_stat, but for the directory at path in snap.
+  Returns SUCCESS, or NO_SUCH_PATH if snap does not contain path.
+*/
+int DT_statIn(DT_Snap_T snap, const char* path, struct DT_Stat* stat);
+
+/*
+  Like DT_toString, but for snap.
+  Returns NULL if there is an allocation error.
+*/
+char* DT_toStringIn(DT_Snap_T snap);
+
+/*
+  Like DT_list, but for the hierarchy rooted at path in snap.
+  Returns NULL if snap does not contain path, or there is an
+  allocation error.
+*/
+char* DT_listIn(DT_Snap_T snap, const char* path, size_t offset,
+                size_t limit, size_t* total);
+
+/*
+  Begins a transaction: a group of changes that DT_commit keeps, or
+  DT_abort undoes, all together. Transactions nest, and the changes
+  of a nested one that is committed become those of the enclosing
+  one, to be kept or undone with it. Queries see the changes as they
+  are made.
+
+  Each change logs what it takes to undo it, at the level of the
+  directories it links, unlinks or moves, so that undoing it costs no
+  traversal. Directories removed are kept, and their memory is not
+  freed, until the outermost transaction ends; handles on them (see
+  DT_openDir) go stale all the same, and stay stale even if the
+  removal is undone. The checks that every call makes on the whole
+  tree in debugging builds are made just once, when the outermost
+  transaction ends.
+
+  DT_destroy ends any open transactions, keeping their changes.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns MEMORY_ERROR if unable to allocate the log.
+*/
+int DT_begin(void);
+
+/*
+  Ends the innermost open transaction, keeping its changes.
+  Returns SUCCESS, or INITIALIZATION_ERROR if not in an initialized
+  state or no transaction is open.
+*/
+int DT_commit(void);
+
+/*
+  Ends the innermost open transaction, undoing its changes, latest
+  first.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state or no
+    transaction is open,
+  returns MEMORY_ERROR if unable to undo a change, which can happen
+    only if undoing it must allocate (to link a directory back into
+    a large one, say), in which case the changes not yet undone stay
+    in the transaction, which stays open, and DT_abort can be
+    called again.
+*/
+int DT_abort(void);
+
+
+/*
+  Saves the tree to the file descriptor fd, from its current offset,
+  as an image: a binary format that DT_load and DT_loadSnapshot read
+  back without parsing or inserting any path. It holds a table of the
+  directories in pre-order, each with the index of its parent, a
+  table of each one's children in sorted order, and a table of their
+  names, each stored once however many directories have it. It is in
+  the machine's own byte order and word size, so it can only be read
+  on the kind of machine that wrote it.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns MEMORY_ERROR if unable to allocate the image,
+  returns IO_ERROR if unable to write it all.
+*/
+int DT_save(int fd);
+
+/*
+  Makes the tree that of the image that DT_save saved to the file
+  descriptor fd, read from its current offset to its end. This costs
+  time proportional to the number of directories, with no lookups.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns CONFLICTING_PATH if the tree is not empty or keeps a
+    journal (which starts from an image through DT_initWithOptions
+    instead),
+  returns MEMORY_ERROR if unable to allocate the tree,
+  returns IO_ERROR if unable to read the image, or it is not one
+    that DT_save saved on this kind of machine.
+*/
+int DT_load(int fd);
+
+/*
+  Like DT_load, but stores in *snap a snapshot (see DT_snapshot) of
+  the tree in the image instead, which need not be initialized. The
+  image is mapped into memory where possible, and the snapshot
+  serves its queries from the image as it is, so loading it costs
+  just one pass over the image to check it, and no allocation per
+  directory. The file descriptor may be closed once this returns.
+  Returns SUCCESS, otherwise:
+  returns MEMORY_ERROR if unable to allocate the snapshot,
+  returns IO_ERROR as DT_load does.
+*/
+int DT_loadSnapshot(int fd, DT_Snap_T* snap);
+
+/*
+  Writes the changes waiting for the journal and synchronizes it with
+  the disk, so that they survive a crash. The changes of open
+  transactions are not written until the outermost one is committed;
+  those of an aborted one never are.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns IO_ERROR if unable to write or synchronize the journal, in
+    which case the changes stay waiting for the next attempt.
+*/
+int DT_sync(void);
+
+/*
+  Saves the tree to fd, as DT_save does, and synchronizes it with the
+  disk, as a checkpoint: an image that marks which of the journal's
+  records it holds, so that DT_initWithOptions replays only the ones
+  after them. Once the client has put the image in place of the one
+  it starts from (by renaming it over that one, say), DT_compact can
+  drop those records from the journal.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state or the
+    tree keeps no journal,
+  returns CONFLICTING_PATH if a transaction is open,
+  returns MEMORY_ERROR as DT_save does,
+  returns IO_ERROR if unable to synchronize the journal or to write
+    or synchronize the image.
+*/
+int DT_checkpoint(int fd);
+
+/*
+  Drops all of the journal's records, which the last checkpoint must
+  hold. The file is cut back in one step, so that a crash leaves
+  either all of them or none.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state or the
+    tree keeps no journal,
+  returns CONFLICTING_PATH if a transaction is open, or there has
+    been no checkpoint, or there have been changes since the last,
+  returns IO_ERROR if unable to cut back the journal.
+*/
+int DT_compact(void);
+
+/*
+  Makes the tree that of dump, a listing of the kind that DT_toString
+  returns: one path per line, each followed by a newline (which the
+  last may lack), in pre-order, with the children of each directory
+  in sorted order. Each line is checked against the order as it is
+  read and added under its parent, which is always a line that came
+  before it and still on the path down to the line before, so that
+  no line costs a lookup from the root. The tree must be empty.
+  Returns SUCCESS, otherwise, leaving the tree empty:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns CONFLICTING_PATH if the tree is not empty or keeps a journal
+    (see DT_load), or a line is not under the first line's root,
+  returns PARENT_CHILD_ERROR if a line is empty, is not the path of
+    a child of an earlier line, or is out of order,
+  returns ALREADY_IN_TREE if a line repeats an earlier one,
+  returns MEMORY_ERROR if unable to allocate the tree.
+*/
+int DT_fromString(const char* dump);
+
+/*
+  Like DT_fromString, but with dump given as the len characters at
+  dump, which need not be NUL-terminated, such as a file mapped into
+  memory.
+*/
+int DT_fromStringN(const char* dump, size_t len);
+
+/* What DT_importDir found on disk */
+struct DT_ImportStats {
+   /* the directories added, counting the top one */
+   size_t numDirs;
+   /* the entries that were skipped since they are not directories */
+   size_t numSkipped;
+};
+
+/*
+  Inserts path, as DT_insertPath does, with the hierarchy of
+  directories below the directory on disk at fsPath as its own. The
+  hierarchy is read first, with threads threads (or as many as can be
+  started, and at least the calling one) each taking the next directory
+  that none has read yet; 0 is taken as 1, which reads them all in the
+  calling thread. More threads pay off only where each read waits on
+  something other than the others, such as a server or a disk that
+  serves several reads at once, so that their waits overlap. Then each
+  directory's subdirectories are created and linked under it in sorted
+  order, with no lookups. Symbolic links are not followed; they, files
+  and the other entries that are not directories are skipped, since the
+  tree has no place for them. The import is one change: if it fails,
+  the tree is as it was, and aborting a transaction that it is part of
+  undoes all of it. If stats is not NULL, stores in *stats what was
+  imported.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns IO_ERROR if fsPath, or a directory below it, cannot be read
+    as a directory,
+  returns MEMORY_ERROR if unable to allocate the hierarchy,
+  returns as DT_insertPath does if path cannot be inserted.
+*/
+int DT_importDir(const char* fsPath, const char* path, size_t threads,
+                 struct DT_ImportStats* stats);
+
+/* What DT_exportDir made on disk */
+struct DT_ExportStats {
+   /* the directories made, or found there already, counting the top
+      one */
+   size_t numDirs;
+   /* the directories that could not be made; those below them were
+      not attempted */
+   size_t numFailed;
+};
+
+/*
+  Makes the directory on disk at fsPath, and below it a directory for
+  each directory of the hierarchy rooted at path, the reverse of
+  DT_importDir. The paths are gathered first, in pre-order, and then
+  made with threads threads (or as many as can be started, and at
+  least the calling one), each making the next directory whose parent
+  has been made; 0 is taken as 1, which makes them all in the calling
+  thread. More threads pay off only where each mkdir waits on
+  something other than the others, such as a server, so that their
+  waits overlap. A directory that is already there counts as made.
+  One that cannot be made, or whose name cannot be a directory's on
+  disk (such as ".."), does not stop the others, but the ones below it
+  are not attempted: failed, if it is not NULL, is called with its path
+  on disk, the errno value it failed with, and extra, for each of
+  them in pre-order, once all the others are made. If stats is not
+  NULL, stores in *stats what was made.
+  Returns SUCCESS, otherwise:
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns NO_SUCH_PATH if path is not in the tree,
+  returns MEMORY_ERROR if unable to allocate the list of paths,
+  returns IO_ERROR if any directory could not be made.
+*/
+int DT_exportDir(const char* path, const char* fsPath, size_t threads,
+                 void (*failed)(const char* fsPath, int error,
+                                void* extra),
+                 void* extra, struct DT_ExportStats* stats);
+
 #endif
@@ -3,15 +3,28 @@
 /* Author: Christopher Moretti                                        */
 /*--------------------------------------------------------------------*/
 
+/* for fsync, to make a checkpoint durable before the journal is cut
+   back */
+#define _POSIX_C_SOURCE 200112L
+
 #include <assert.h>
+#include <limits.h>
 #include <string.h>
 #include <stdio.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "dynarray.h"
 #include "dt.h"
 #include "node.h"
+#include "childset.h"
+#include "path.h"
+#include "bloom.h"
+#include "image.h"
+#include "journal.h"
+#include "dirscan.h"
+#include "dirmake.h"
 #include "checkerDT.h"
 
 /* A Directory Tree is an AO with 3 state variables: */
@@ -22,47 +35,456 @@ static Node_T root;
 /* a counter of the number of nodes in the hierarchy */
 static size_t count;
 
+/* The number of entries in the lookup cache: a power of 2 */
+enum { DT_CACHE_SIZE = 64 };
+/* The number of a path's deepest prefixes looked up in the cache */
+enum { DT_CACHE_DEPTH = 16 };
+
+/* A cache of recently resolved directories, each in the entry that
+   the hash of its path selects, from which lookups of paths below
+   them can resume rather than start again from the root. */
+static Node_T cache[DT_CACHE_SIZE];
+/* how many lookups did and did not find an ancestor in the cache */
+static struct DT_CacheStats cacheStats;
+
+/* a filter of the paths in the hierarchy, which answers most
+   containment queries for absent paths on its own, or NULL if the
+   client did not ask for one */
+static Bloom_T filter;
+/* how the filter fared with the queries put to it */
+static struct DT_FilterStats filterStats;
+
+/* The directories that share one name, in the index of names */
+struct DT_NameEntry {
+   /* the name, which the entry owns, since it outlives any one of
+      the directories */
+   char* name;
+   /* the directories with the name, keyed by path */
+   ChildSet_T nodes;
+};
+
+/* an index of the directories in the hierarchy by name, with a
+   DT_NameEntry for each name, or NULL if the client did not ask for
+   one */
+static ChildSet_T nameIndex;
+
+/* A handle on a directory, kept in a list of all open handles so
+   that removing the directory can mark it stale */
+struct DT_Dir {
+   /* the directory, or NULL once it has been removed */
+   Node_T node;
+   /* the neighboring handles in the list of open handles */
+   struct DT_Dir* prev;
+   struct DT_Dir* next;
+};
+
+/* the list of open handles, whether stale or not */
+static struct DT_Dir* openDirs;
+
+/* A snapshot of the hierarchy */
+struct DT_Snap {
+   /* an unexpanded copy of the root as it was, in no tree, or NULL
+      if the hierarchy was empty */
+   Node_T root;
+   /* for a snapshot loaded from an image, the image, from which it
+      serves its queries instead, and NULL otherwise */
+   Image_T image;
+   /* the number of references to the snapshot not yet released */
+   size_t refs;
+   /* the snapshots of the same hierarchy, of which this is one, or
+      NULL for a snapshot loaded from an image */
+   struct DT_SnapSet* set;
+};
+
+/* The snapshots not yet freed of one hierarchy, whose copies may
+   stand for its directories */
+struct DT_SnapSet {
+   /* the number of them */
+   size_t numSnaps;
+   /* once DT_destroy has left the hierarchy to them, its root, or NULL
+      if it was empty, which is freed along with the last of them */
+   Node_T root;
+};
+
+/* the snapshots of the tree's hierarchy, or NULL if there are none */
+static struct DT_SnapSet* snaps;
+
+/* The kinds of change that the log of a transaction records */
+enum DT_ChangeKind {
+   /* a hierarchy was linked into the tree */
+   DT_LINKED,
+   /* a hierarchy was unlinked from the tree, and is kept whole until
+      the transaction ends */
+   DT_UNLINKED,
+   /* a hierarchy was moved */
+   DT_MOVED,
+   /* a nested transaction began */
+   DT_BEGUN
+};
+
+/* A change made within a transaction, with what it takes to undo it */
+struct DT_Change {
+   enum DT_ChangeKind kind;
+   /* the root of the hierarchy linked, unlinked or moved */
+   Node_T node;
+   /* the parent that it had before, or NULL if it was the root */
+   Node_T parent;
+   /* for a move, the name that it had before, which the change owns,
+      and its length */
+   char* name;
+   size_t nameLen;
+   /* for a DT_BEGUN change, the end of the journal when the
+      transaction began */
+   size_t mark;
+};
+
+/* the log of the changes made since the outermost open transaction
+   began, oldest first, which begins with a DT_BEGUN change for it,
+   or NULL if no transaction is open */
+static DynArray_T changes;
+
+/* The kinds of record in the journal. Each has two strings: a path,
+   and a path relative to it that it is followed by, if that is not
+   empty, or a source and a destination. */
+enum DT_RecordKind {
+   DT_RECORD_INSERT,
+   DT_RECORD_REMOVE,
+   DT_RECORD_MOVE,
+   DT_RECORD_CLONE
+};
+
+/* the journal of the changes since the last checkpoint, or NULL if
+   the tree keeps none */
+static Journal_T journal;
+
+/* whether a checkpoint has been taken since the journal was opened,
+   and if so, the sequence number of the latest record it holds */
+static boolean checkpointed;
+static size_t checkpointSequence;
+
+/* Whether the hierarchy is valid, as far as it is due to be checked:
+   within a transaction, it is checked only once the outermost one
+   ends, rather than once per call */
+#define DT_IS_VALID() \
+   (changes != NULL || CheckerDT_isValid(isInitialized,root,count))
+
 /*
    Starting at the parameter curr, traverses as far down
    the hierarchy as possible while still matching the path
-   parameter.
+   parameter, the len characters at path, looking up one child
+   by name per component. The path is scanned in place.
 
    Returns a pointer to the farthest matching node down that path,
    or NULL if there is no node in curr's hierarchy that matches
    a prefix of the path
 */
-static Node_T DT_traversePathFrom(char* path, Node_T curr) {
+static Node_T DT_traversePathFrom(const char* path, size_t len,
+                                  Node_T curr) {
    Node_T found;
+   const char* name;
+   size_t nameLen;
+   size_t offset;
+
+   assert(path != NULL);
+
+   if(curr == NULL)
+      return NULL;
+
+   offset = Node_getPathLength(curr);
+   if(!Path_hasPrefix(path, len, Node_getPath(curr), offset))
+      return NULL;
+
+   offset++;
+   while(Path_nextComponent(path, len, &offset, &name, &nameLen)) {
+      found = Node_findChild(curr, name, nameLen);
+      if(found == NULL)
+         break;
+      curr = found;
+   }
+   return curr;
+}
+
+/*
+   Returns the FNV-1a hash of the len characters at s, continuing from
+   hash, the hash of the characters before them (or, initially, the
+   FNV offset basis).
+*/
+static size_t DT_hashMore(size_t hash, const char* s, size_t len) {
+   size_t i;
+
+   assert(s != NULL || len == 0);
+
+   for(i = 0; i < len; i++) {
+      hash ^= (unsigned char) s[i];
+      hash *= 16777619U;
+   }
+   return hash;
+}
+
+/*
+   Empties the lookup cache, which must be done whenever a node that
+   might be in it is destroyed.
+*/
+static void DT_clearCache(void) {
+   size_t i;
+
+   for(i = 0; i < DT_CACHE_SIZE; i++)
+      cache[i] = NULL;
+}
+
+/*
+   Returns the farthest node reachable from the root following a given
+   path, the len characters at path, or NULL if there is no node in
+   the hierarchy that matches a prefix of the path.
+
+   The walk resumes from the deepest ancestor of path that is in the
+   lookup cache, if any, and the node found and its parent (from which
+   lookups of its siblings resume) are cached in turn.
+*/
+static Node_T DT_traversePath(const char* path, size_t len) {
+   size_t hashes[DT_CACHE_DEPTH];
+   size_t ends[DT_CACHE_DEPTH];
+   size_t depth = 0;
+   size_t hash = 2166136261U;
+   size_t hashed = 0;
+   size_t offset = 0;
+   const char* name;
+   size_t nameLen;
+   Node_T curr = NULL;
+   Node_T parent;
+   Node_T cached;
    size_t i;
 
    assert(path != NULL);
 
+   if(root == NULL)
+      return NULL;
+
+   /* hash each prefix of path that ends with a component, keeping
+      the deepest ones */
+   while(Path_nextComponent(path, len, &offset, &name, &nameLen)) {
+      i = (size_t) (name - path) + nameLen;
+      hash = DT_hashMore(hash, path + hashed, i - hashed);
+      hashed = i;
+      hashes[depth % DT_CACHE_DEPTH] = hash;
+      ends[depth % DT_CACHE_DEPTH] = i;
+      depth++;
+   }
+
+   for(i = depth; i > 0 && i + DT_CACHE_DEPTH > depth; i--) {
+      cached = cache[hashes[(i - 1) % DT_CACHE_DEPTH] %
+                     DT_CACHE_SIZE];
+      if(cached != NULL &&
+         Path_hasPrefix(path, len, Node_getPath(cached),
+                        Node_getPathLength(cached))) {
+         curr = DT_traversePathFrom(path, len, cached);
+         break;
+      }
+   }
+   if(curr == NULL) {
+      cacheStats.misses++;
+      curr = DT_traversePathFrom(path, len, root);
+   }
+   else
+      cacheStats.hits++;
+
    if(curr == NULL)
       return NULL;
 
-   else if(!strcmp(path,Node_getPath(curr)))
-      return curr;
+   parent = Node_getParent(curr);
+   for(i = depth; i > 0 && i + DT_CACHE_DEPTH > depth; i--) {
+      if(ends[(i - 1) % DT_CACHE_DEPTH] == Node_getPathLength(curr))
+         cached = curr;
+      else if(parent != NULL &&
+              ends[(i - 1) % DT_CACHE_DEPTH] ==
+              Node_getPathLength(parent))
+         cached = parent;
+      else
+         continue;
+      cache[hashes[(i - 1) % DT_CACHE_DEPTH] % DT_CACHE_SIZE] = cached;
+   }
+   return curr;
+}
+
+/*
+   Starting at dir, traverses as far down the hierarchy as possible
+   while still matching the relative path given by the len characters
+   at rel, and stores in *rest the position in rel of the first
+   component that does not match, or len + 1 if they all do.
 
-   else if(!strncmp(path, Node_getPath(curr), strlen(Node_getPath(curr)))) {
-      for(i = 0; i < Node_getNumChildren(curr); i++) {
-         found = DT_traversePathFrom(path,
-                                Node_getChild(curr, i));
-         if(found != NULL)
-            return found;
+   Returns the farthest matching node, which is dir itself if not even
+   the first component of rel matches.
+*/
+static Node_T DT_traverseRelative(Node_T dir, const char* rel,
+                                  size_t len, size_t* rest) {
+   Node_T found;
+   const char* name;
+   size_t nameLen;
+   size_t offset = 0;
+
+   assert(dir != NULL);
+   assert(rel != NULL);
+   assert(rest != NULL);
+
+   while(Path_nextComponent(rel, len, &offset, &name, &nameLen)) {
+      found = Node_findChild(dir, name, nameLen);
+      if(found == NULL) {
+         *rest = (size_t) (name - rel);
+         return dir;
       }
-      return curr;
+      dir = found;
    }
-   return NULL;
+   *rest = offset;
+   return dir;
 }
 
 /*
-   Returns the farthest node reachable from the root following a given
-   path, or NULL if there is no node in the hierarchy that matches a
-   prefix of the path.
+   Returns whether node curr, found by traversing the path given by
+   the len characters at path, is the node for that whole path.
+   Since curr's path is then a prefix of path, comparing the lengths
+   suffices.
+*/
+static boolean DT_isWholePath(Node_T curr, size_t len) {
+   return curr != NULL && Node_getPathLength(curr) == len;
+}
+
+/*
+   Returns the node whose children stand for n's: n's source if n is
+   an unexpanded copy, and n itself otherwise.
+*/
+static Node_T DT_childrenOf(Node_T n) {
+   assert(n != NULL);
+
+   if(Node_getSource(n) != NULL)
+      return Node_getSource(n);
+   return n;
+}
+
+/*
+   Given the farthest node curr found along the path given by the len
+   characters at path, and the position rest in path of the first
+   component that it did not match (or len + 1 if it matched them
+   all), returns a node whose children stand for those of the
+   directory with the whole path: the directory's own node, or, below
+   an unexpanded copy, the node in the copy's source that it stands
+   for. Returns NULL if there is no such directory.
+
+   This carries on in copies' sources rather than expanding them, so
+   it never allocates, but the node it returns may have another path.
+*/
+static Node_T DT_lookUp(Node_T curr, const char* path, size_t len,
+                        size_t rest) {
+   size_t more;
+
+   assert(path != NULL);
+
+   while(curr != NULL && rest <= len && Node_getSource(curr) != NULL) {
+      curr = DT_traverseRelative(Node_getSource(curr), path + rest,
+                                 len - rest, &more);
+      rest += more;
+   }
+   if(curr == NULL || rest <= len)
+      return NULL;
+   return curr;
+}
+
+/*
+   Like DT_lookUp, but expands the unexpanded copies along the way
+   instead, updating *curr and *rest to the farthest node of the tree
+   itself found along path. Returns SUCCESS, or MEMORY_ERROR if there
+   is an allocation error.
+*/
+static int DT_expandAlong(Node_T* curr, const char* path, size_t len,
+                          size_t* rest) {
+   size_t more;
+
+   assert(curr != NULL);
+   assert(path != NULL);
+   assert(rest != NULL);
+
+   while(*curr != NULL && *rest <= len && Node_getSource(*curr) != NULL) {
+      if(Node_expand(*curr) != SUCCESS)
+         return MEMORY_ERROR;
+      *curr = DT_traverseRelative(*curr, path + *rest, len - *rest,
+                                  &more);
+      *rest += more;
+   }
+   return SUCCESS;
+}
+
+/*
+   Returns a node whose children stand for those of the directory with
+   the path given by the len characters at path, as DT_lookUp does, or
+   NULL if there is no such directory.
+*/
+static Node_T DT_findPath(const char* path, size_t len) {
+   Node_T curr;
+
+   assert(path != NULL);
+
+   curr = DT_traversePath(path, len);
+   if(curr == NULL)
+      return NULL;
+   return DT_lookUp(curr, path, len, Node_getPathLength(curr) + 1);
+}
+
+/*
+   Stores in *found the node of the tree itself for the directory with
+   the path given by the len characters at path, expanding the copies
+   along the way, or NULL if there is no such directory. The node
+   itself may be an unexpanded copy. Returns SUCCESS, or MEMORY_ERROR
+   if there is an allocation error.
 */
-static Node_T DT_traversePath(char* path) {
+static int DT_findInTree(const char* path, size_t len, Node_T* found) {
+   Node_T curr;
+   size_t rest = 0;
+
    assert(path != NULL);
-   return DT_traversePathFrom(path, root);
+   assert(found != NULL);
+
+   curr = DT_traversePath(path, len);
+   if(curr != NULL)
+      rest = Node_getPathLength(curr) + 1;
+   if(DT_expandAlong(&curr, path, len, &rest) != SUCCESS)
+      return MEMORY_ERROR;
+   *found = rest > len ? curr : NULL;
+   return SUCCESS;
+}
+
+/*
+   Expands every unexpanded copy in the hierarchy rooted at n.
+   Returns FALSE if there is an allocation error, TRUE otherwise.
+*/
+static boolean DT_expandHierarchy(Node_T n) {
+   Node_ChildIter iter;
+   Node_T c;
+
+   assert(n != NULL);
+
+   if(Node_expand(n) != SUCCESS)
+      return FALSE;
+   for(c = Node_firstChild(n, &iter); c != NULL;
+       c = Node_nextChild(n, &iter))
+      if(!DT_expandHierarchy(c))
+         return FALSE;
+   return TRUE;
+}
+
+/*
+   Marks stale every open handle on a directory in the hierarchy
+   rooted at n.
+*/
+static void DT_invalidateDirs(Node_T n) {
+   struct DT_Dir* dir;
+
+   assert(n != NULL);
+
+   for(dir = openDirs; dir != NULL; dir = dir->next)
+      if(dir->node != NULL &&
+         Path_hasPrefix(Node_getPath(dir->node),
+                        Node_getPathLength(dir->node),
+                        Node_getPath(n), Node_getPathLength(n)))
+         dir->node = NULL;
 }
 
 /*
@@ -71,10 +493,375 @@ static Node_T DT_traversePath(char* path) {
 */
 static void DT_removePathFrom(Node_T curr) {
    if(curr != NULL) {
+      DT_clearCache();
+      DT_invalidateDirs(curr);
       count -= Node_destroy(curr);
    }
 }
 
+/*
+   Frees cell, a holder of a node in the index of names. The second
+   parameter is unused, so that this can be a ChildSet_map callback.
+*/
+static void DT_freeNameCell(Node_T* cell, void* unused) {
+   (void) unused;
+   free(cell);
+}
+
+/*
+   Frees entry, an entry of the index of names. The second parameter
+   is unused, so that this can be a ChildSet_map callback.
+*/
+static void DT_freeNameEntry(struct DT_NameEntry* entry, void* unused) {
+   assert(entry != NULL);
+
+   (void) unused;
+   ChildSet_map(entry->nodes, (void (*)(void*, void*)) DT_freeNameCell,
+                NULL);
+   ChildSet_free(entry->nodes);
+   free(entry->name);
+   free(entry);
+}
+
+/*
+   Removes n from the entry of the index of names for the len
+   characters at name, if it is there, and removes that entry too if
+   n was the last directory in it.
+*/
+static void DT_namesRemove(Node_T n, const char* name, size_t len) {
+   struct DT_NameEntry* entry;
+
+   assert(nameIndex != NULL);
+   assert(n != NULL);
+   assert(name != NULL);
+
+   entry = ChildSet_find(nameIndex, name, len);
+   if(entry == NULL)
+      return;
+   free(ChildSet_remove(entry->nodes, (const char*) &n, sizeof(Node_T)));
+   if(ChildSet_getLength(entry->nodes) == 0) {
+      (void) ChildSet_remove(nameIndex, entry->name, len);
+      DT_freeNameEntry(entry, NULL);
+   }
+}
+
+/*
+   Adds n to the entry of the index of names for the len characters
+   at name, creating that entry if need be.
+   Returns FALSE, leaving the index unchanged, if there is an
+   allocation error, and TRUE otherwise.
+*/
+static boolean DT_namesAdd(Node_T n, const char* name, size_t len) {
+   struct DT_NameEntry* entry;
+   Node_T* cell;
+
+   assert(nameIndex != NULL);
+   assert(n != NULL);
+   assert(name != NULL);
+
+   entry = ChildSet_find(nameIndex, name, len);
+   if(entry == NULL) {
+      entry = malloc(sizeof(struct DT_NameEntry));
+      if(entry == NULL)
+         return FALSE;
+      entry->name = malloc(len + 1);
+      entry->nodes = ChildSet_new(CHILDSET_HASH);
+      if(entry->name == NULL || entry->nodes == NULL) {
+         if(entry->nodes != NULL)
+            ChildSet_free(entry->nodes);
+         free(entry->name);
+         free(entry);
+         return FALSE;
+      }
+      memcpy(entry->name, name, len);
+      entry->name[len] = '\0';
+      if(!ChildSet_add(nameIndex, entry->name, len, entry, 1)) {
+         DT_freeNameEntry(entry, NULL);
+         return FALSE;
+      }
+   }
+
+   /* the directories are keyed by the bytes of their Node_Ts, which,
+      unlike their paths, do not change when they move; each key
+      lives in a cell of its own */
+   cell = malloc(sizeof(Node_T));
+   if(cell != NULL) {
+      *cell = n;
+      if(ChildSet_add(entry->nodes, (const char*) cell, sizeof(Node_T),
+                      cell, 1))
+         return TRUE;
+      free(cell);
+   }
+   if(ChildSet_getLength(entry->nodes) == 0) {
+      (void) ChildSet_remove(nameIndex, entry->name, len);
+      DT_freeNameEntry(entry, NULL);
+   }
+   return FALSE;
+}
+
+/*
+   Adds to the filter, if add is TRUE, and otherwise removes from it,
+   the paths of the descendants of a directory whose children are
+   those of n (see DT_childrenOf) and whose path has the filter's
+   hash hash. The paths are hashed a component at a time rather than
+   put together, so that they need not exist, as they do not below an
+   unexpanded copy.
+*/
+static void DT_filterBelow(Node_T n, size_t hash, boolean add) {
+   Node_ChildIter iter;
+   Node_T c;
+   size_t childHash;
+
+   assert(filter != NULL);
+   assert(n != NULL);
+
+   n = DT_childrenOf(n);
+   for(c = Node_firstChild(n, &iter); c != NULL;
+       c = Node_nextChild(n, &iter)) {
+      childHash = Bloom_hashMore(Bloom_hashMore(hash, "/", 1),
+                                 Node_getName(c), Node_getNameLength(c));
+      if(add)
+         Bloom_addHash(filter, childHash);
+      else
+         Bloom_removeHash(filter, childHash);
+      DT_filterBelow(c, childHash, add);
+   }
+}
+
+/*
+   Adds the paths of the hierarchy rooted at n to the filter if add is
+   TRUE, and removes them from it otherwise.
+*/
+static void DT_filterHierarchy(Node_T n, boolean add) {
+   size_t hash;
+
+   assert(filter != NULL);
+   assert(n != NULL);
+
+   hash = Bloom_hash(Node_getPath(n), Node_getPathLength(n));
+   if(add)
+      Bloom_addHash(filter, hash);
+   else
+      Bloom_removeHash(filter, hash);
+   DT_filterBelow(n, hash, add);
+}
+
+/*
+   Adds each directory of the hierarchy rooted at n, which must have
+   no unexpanded copies in it, to the index of names.
+   Returns FALSE if there is an allocation error, having added only
+   some of them, and TRUE otherwise.
+*/
+static boolean DT_namesAddHierarchy(Node_T n) {
+   Node_ChildIter iter;
+   Node_T c;
+
+   assert(n != NULL);
+   assert(Node_getSource(n) == NULL);
+
+   if(!DT_namesAdd(n, Node_getName(n), Node_getNameLength(n)))
+      return FALSE;
+   for(c = Node_firstChild(n, &iter); c != NULL;
+       c = Node_nextChild(n, &iter))
+      if(!DT_namesAddHierarchy(c))
+         return FALSE;
+   return TRUE;
+}
+
+/*
+   Removes each directory of the hierarchy rooted at n that is in the
+   index of names from it.
+*/
+static void DT_namesRemoveHierarchy(Node_T n) {
+   Node_ChildIter iter;
+   Node_T c;
+
+   assert(n != NULL);
+
+   DT_namesRemove(n, Node_getName(n), Node_getNameLength(n));
+   for(c = Node_firstChild(n, &iter); c != NULL;
+       c = Node_nextChild(n, &iter))
+      DT_namesRemoveHierarchy(c);
+}
+
+/*
+   Adds node last and its created - 1 nearest ancestors, the nodes
+   that an insertion just created, to the filter and the index of
+   names, whichever there are.
+   Returns FALSE, leaving both unchanged, if there is an allocation
+   error, and TRUE otherwise.
+*/
+static boolean DT_indexAdd(Node_T last, size_t created) {
+   Node_T n = last;
+   size_t i;
+
+   if(nameIndex != NULL)
+      for(i = 0; i < created; i++, n = Node_getParent(n)) {
+         assert(n != NULL);
+         if(!DT_namesAdd(n, Node_getName(n), Node_getNameLength(n))) {
+            for( ; i > 0; i--, last = Node_getParent(last))
+               DT_namesRemove(last, Node_getName(last),
+                              Node_getNameLength(last));
+            return FALSE;
+         }
+      }
+
+   if(filter != NULL)
+      for(n = last; created > 0; created--, n = Node_getParent(n)) {
+         assert(n != NULL);
+         Bloom_add(filter, Node_getPath(n), Node_getPathLength(n));
+      }
+   return TRUE;
+}
+
+/*
+   Removes the hierarchy rooted at n from the filter and the index
+   of names, whichever there are.
+*/
+static void DT_indexRemove(Node_T n) {
+   assert(n != NULL);
+
+   if(filter != NULL)
+      DT_filterHierarchy(n, FALSE);
+   if(nameIndex != NULL)
+      DT_namesRemoveHierarchy(n);
+}
+
+/*
+   Appends a change of the given kind to n, whose parent is still the
+   one it had before, to the log of the open transaction, if there is
+   one. Returns FALSE if there is an allocation error, and TRUE
+   otherwise.
+*/
+static boolean DT_logChange(enum DT_ChangeKind kind, Node_T n) {
+   struct DT_Change* change;
+
+   if(changes == NULL)
+      return TRUE;
+
+   change = malloc(sizeof(struct DT_Change));
+   if(change == NULL)
+      return FALSE;
+   change->kind = kind;
+   change->node = n;
+   change->parent = n == NULL ? NULL : Node_getParent(n);
+   change->name = NULL;
+   change->nameLen = 0;
+   change->mark = journal == NULL ? 0 : Journal_getEnd(journal);
+   if(kind == DT_MOVED) {
+      change->nameLen = Node_getNameLength(n);
+      change->name = malloc(change->nameLen);
+      if(change->name == NULL) {
+         free(change);
+         return FALSE;
+      }
+      memcpy(change->name, Node_getName(n), change->nameLen);
+   }
+
+   if(!DynArray_add(changes, change)) {
+      free(change->name);
+      free(change);
+      return FALSE;
+   }
+   return TRUE;
+}
+
+/*
+   Frees change, which has been taken off the log, but not any
+   hierarchy that it keeps.
+*/
+static void DT_discardChange(struct DT_Change* change) {
+   assert(change != NULL);
+
+   free(change->name);
+   free(change);
+}
+
+/*
+   Frees change, which has been taken off the log for good, and, if it
+   kept a hierarchy that it unlinked, that hierarchy too. The second
+   parameter is unused, so that this can be a DynArray_map callback.
+*/
+static void DT_freeChange(struct DT_Change* change, void* unused) {
+   assert(change != NULL);
+
+   (void) unused;
+   if(change->kind == DT_UNLINKED)
+      (void) Node_destroy(change->node);
+   DT_discardChange(change);
+}
+
+/*
+   Takes the last change off the log of the open transaction, if
+   there is one, and frees it, for a change that could not be made
+   after all.
+*/
+static void DT_dropChange(void) {
+   struct DT_Change* change;
+
+   if(changes == NULL)
+      return;
+
+   change = DynArray_removeAt(changes, DynArray_getLength(changes) - 1);
+   assert(change->kind != DT_BEGUN);
+   DT_discardChange(change);
+}
+
+/*
+   Ends the outermost transaction for good: frees the log, with the
+   hierarchies that it kept.
+*/
+static void DT_freeChanges(void) {
+   assert(changes != NULL);
+
+   DynArray_map(changes, (void (*)(void*, void*)) DT_freeChange, NULL);
+   DynArray_free(changes);
+   changes = NULL;
+}
+
+/*
+   Returns the end of the journal, as DT_journal and DT_journalDone
+   take it, or 0 if there is no journal.
+*/
+static size_t DT_journalMark(void) {
+   return journal == NULL ? 0 : Journal_getEnd(journal);
+}
+
+/*
+   Appends a record of the given kind, with the firstLen characters at
+   first and the secondLen characters at second, to the journal, if
+   there is one, for a change about to be made. Returns FALSE if
+   there is an allocation error, and TRUE otherwise.
+*/
+static boolean DT_journal(enum DT_RecordKind kind,
+                          const char* first, size_t firstLen,
+                          const char* second, size_t secondLen) {
+   assert(first != NULL);
+   assert(second != NULL);
+
+   if(journal == NULL)
+      return TRUE;
+   return (boolean) Journal_append(journal, (int) kind, first, firstLen,
+                                   second, secondLen);
+}
+
+/*
+   Finishes with the record that DT_journal appended to the journal
+   at mark, given the result of the change: takes the record back if
+   the change was not made, and otherwise, outside transactions,
+   hands it to the journal to synchronize once its window has passed.
+   A failure to write is left for DT_sync to report, since the records
+   stay buffered until they are written.
+*/
+static void DT_journalDone(size_t mark, int result) {
+   if(journal == NULL)
+      return;
+   if(result != SUCCESS)
+      Journal_rollback(journal, mark);
+   else if(changes == NULL)
+      (void) Journal_syncIfDue(journal);
+}
+
 /*
    Given a prospective parent and child node,
    adds child to parent's children list, if possible
@@ -95,10 +882,11 @@ static int DT_linkParentToChild(Node_T parent, Node_T child) {
 }
 
 /*
-   Inserts a new path into the tree rooted at parent, or, if
-   parent is NULL, as the root of the data structure.
-
-   If a node representing path already exists, returns ALREADY_IN_TREE
+   Inserts the components of the path given by the len characters at
+   path from position offset on below parent, or, if parent is NULL,
+   as the root of the data structure, creating each new node straight
+   from its component of path. As with strtok, empty components are
+   skipped.
 
    If there is an allocation error in creating any of the new nodes or
    their fields, returns MEMORY_ERROR
@@ -106,46 +894,37 @@ static int DT_linkParentToChild(Node_T parent, Node_T child) {
    If there is an error linking any of the new nodes,
    returns PARENT_CHILD_ERROR
 
+   If there are no components to insert below parent,
+   returns ALREADY_IN_TREE
+
    Otherwise, returns SUCCESS
 */
-static int DT_insertRestOfPath(char* path, Node_T parent) {
-
+static int DT_insertComponents(const char* path, size_t len,
+                               size_t offset, Node_T parent) {
    Node_T curr = parent;
    Node_T firstNew = NULL;
    Node_T new;
-   char* copyPath;
-   char* restPath = path;
-   char* dirToken;
+   const char* dir;
+   size_t dirLen;
    int result;
    size_t newCount = 0;
 
    assert(path != NULL);
 
-   if(curr == NULL) {
-      if(root != NULL) {
-         return CONFLICTING_PATH;
-      }
-   }
-   else {
-      if(!strcmp(path, Node_getPath(curr)))
-         return ALREADY_IN_TREE;
-
-      restPath += (strlen(Node_getPath(curr)) + 1);
-   }
-
-   copyPath = malloc(strlen(restPath)+1);
-   if(copyPath == NULL)
+   /* before the new nodes are linked to each other, since they
+      already point up to parent */
+   if(parent != NULL && Node_unshare(parent) != SUCCESS)
       return MEMORY_ERROR;
-   strcpy(copyPath, restPath);
-   dirToken = strtok(copyPath, "/");
 
-   while(dirToken != NULL) {
-      new = Node_create(dirToken, curr);
+   while(Path_nextComponent(path, len, &offset, &dir, &dirLen)) {
+      if(dirLen == 0)
+         continue;
+
+      new = Node_createN(dir, dirLen, curr);
 
       if(new == NULL) {
          if(firstNew != NULL)
             (void) Node_destroy(firstNew);
-         free(copyPath);
          return MEMORY_ERROR;
       }
 
@@ -158,21 +937,20 @@ static int DT_insertRestOfPath(char* path, Node_T parent) {
          if(result != SUCCESS) {
             (void) Node_destroy(new);
             (void) Node_destroy(firstNew);
-            free(copyPath);
             return result;
          }
       }
 
       curr = new;
-      dirToken = strtok(NULL, "/");
    }
 
-   free(copyPath);
+   if(firstNew == NULL && parent != NULL)
+      return ALREADY_IN_TREE;
 
    if(parent == NULL) {
       root = firstNew;
       count = newCount;
-      return SUCCESS;
+      result = SUCCESS;
    }
    else {
       result = DT_linkParentToChild(parent, firstNew);
@@ -180,201 +958,2625 @@ static int DT_insertRestOfPath(char* path, Node_T parent) {
          count += newCount;
       else
          (void) Node_destroy(firstNew);
+   }
 
-      return result;
+   if(result == SUCCESS) {
+      if(!DT_logChange(DT_LINKED, firstNew))
+         result = MEMORY_ERROR;
+      else if(!DT_indexAdd(curr, newCount)) {
+         DT_dropChange();
+         result = MEMORY_ERROR;
+      }
+      if(result != SUCCESS) {
+         if(parent == NULL)
+            root = NULL;
+         else
+            Node_unlinkChild(parent, firstNew);
+         count -= Node_destroy(firstNew);
+      }
    }
+   return result;
 }
 
-/* see dt.h for specification */
-int DT_insertPath(char* path) {
-
-   Node_T curr;
-   int result;
+/*
+   Inserts a new path, the len characters at path, into the tree
+   rooted at parent, the farthest node found along it, or, if parent
+   is NULL, as the root of the data structure.
 
-   assert(CheckerDT_isValid(isInitialized,root,count));
-   assert(path != NULL);
+   If a node representing path already exists, returns ALREADY_IN_TREE
 
-   if(!isInitialized)
-      return INITIALIZATION_ERROR;
-   curr = DT_traversePath(path);
-   result = DT_insertRestOfPath(path, curr);
-   assert(CheckerDT_isValid(isInitialized,root,count));
-   return result;
-}
+   If parent is NULL but there is a root already,
+   returns CONFLICTING_PATH
 
-/* see dt.h for specification */
-boolean DT_containsPath(char* path) {
-   Node_T curr;
-   boolean result;
+   Otherwise, returns as DT_insertComponents
+*/
+static int DT_insertRestOfPath(const char* path, size_t len,
+                               Node_T parent) {
+   size_t offset = 0;
 
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   assert(path != NULL);
+
+   if(parent == NULL) {
+      if(root != NULL) {
+         return CONFLICTING_PATH;
+      }
+   }
+   else {
+      if(DT_isWholePath(parent, len))
+         return ALREADY_IN_TREE;
+
+      offset = Node_getPathLength(parent) + 1;
+   }
+
+   return DT_insertComponents(path, len, offset, parent);
+}
+
+/* see dt.h for specification */
+int DT_insertPath(char* path) {
+   assert(path != NULL);
+
+   return DT_insertPathN(path, strlen(path));
+}
+
+/* see dt.h for specification */
+int DT_insertPathN(const char* path, size_t len) {
+
+   Node_T curr;
+   size_t rest = 0;
+   size_t mark;
+   int result;
+
+   assert(DT_IS_VALID());
    assert(path != NULL);
 
    if(!isInitialized)
-      return FALSE;
+      return INITIALIZATION_ERROR;
+   mark = DT_journalMark();
+   if(!DT_journal(DT_RECORD_INSERT, path, len, "", 0))
+      return MEMORY_ERROR;
+   curr = DT_traversePath(path, len);
+   if(curr != NULL)
+      rest = Node_getPathLength(curr) + 1;
+   if(DT_expandAlong(&curr, path, len, &rest) != SUCCESS)
+      result = MEMORY_ERROR;
+   else
+      result = DT_insertRestOfPath(path, len, curr);
+   DT_journalDone(mark, result);
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/* see dt.h for specification */
+boolean DT_containsPath(char* path) {
+   assert(path != NULL);
 
-   curr = DT_traversePath(path);
+   return DT_containsPathN(path, strlen(path));
+}
 
+/* see dt.h for specification */
+boolean DT_containsPathN(const char* path, size_t len) {
+   boolean result;
 
-   if(curr == NULL)
-      result = FALSE;
-   else if(strcmp(path, Node_getPath(curr)))
+   assert(DT_IS_VALID());
+   assert(path != NULL);
+
+   if(!isInitialized)
+      return FALSE;
+
+   if(filter != NULL && !Bloom_mayContain(filter, path, len)) {
+      filterStats.rejected++;
+      return FALSE;
+   }
+
+   if(DT_findPath(path, len) == NULL)
       result = FALSE;
    else
       result = TRUE;
 
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   if(filter != NULL) {
+      filterStats.passed++;
+      if(result == FALSE)
+         filterStats.falsePositives++;
+   }
+
+   assert(DT_IS_VALID());
    return result;
 }
 
+/* A directory looked up while answering a batch of DT_containsMany */
+struct DT_BatchDir {
+   /* its path, the len characters at path, or NULL for an empty slot */
+   const char* path;
+   size_t len;
+   /* the hash of its path */
+   size_t hash;
+   /* its node, or NULL if it is not in the tree */
+   Node_T node;
+};
+
 /*
-  Removes the directory hierarchy rooted at path starting from
-  curr. If curr is the data structure's root, root becomes NULL.
+   Returns a node whose children stand for those of the directory with
+   the path given by the len characters at path, as DT_lookUp does, or
+   NULL if there is none, looking the path up in dirs, a hash table
+   of uMask + 1 slots, and adding it to dirs if it is not there yet.
+   dirs must have an empty slot.
+*/
+static Node_T DT_findBatchDir(struct DT_BatchDir* dirs, size_t uMask,
+                              const char* path, size_t len) {
+   size_t hash;
+   size_t i;
+   Node_T curr;
 
-  Returns NO_SUCH_PATH if curr is not the node for path,
-  and SUCCESS otherwise.
- */
-static int DT_rmPathAt(char* path, Node_T curr) {
+   assert(dirs != NULL);
+   assert(path != NULL);
+
+   hash = DT_hashMore(2166136261U, path, len);
+   for(i = hash & uMask; dirs[i].path != NULL; i = (i + 1) & uMask)
+      if(dirs[i].hash == hash && dirs[i].len == len &&
+         !memcmp(dirs[i].path, path, len))
+         return dirs[i].node;
+
+   curr = DT_traversePathFrom(path, len, root);
+   if(curr != NULL)
+      curr = DT_lookUp(curr, path, len, Node_getPathLength(curr) + 1);
+
+   dirs[i].path = path;
+   dirs[i].len = len;
+   dirs[i].hash = hash;
+   dirs[i].node = curr;
+   return curr;
+}
+
+/* see dt.h for specification */
+int DT_containsMany(char** paths, size_t n, unsigned char* bitmap) {
+   struct DT_BatchDir* dirs;
+   size_t uMask = 1;
+   const char* path;
+   size_t len;
+   size_t dirLen;
+   Node_T curr;
+   boolean found;
+   size_t i;
+
+   assert(DT_IS_VALID());
+   assert(paths != NULL || n == 0);
+   assert(bitmap != NULL || n == 0);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+   if(n == 0)
+      return SUCCESS;
+
+   /* at least twice as many slots as there can be directories */
+   while(uMask < n * 2)
+      uMask = uMask * 2 + 1;
+   dirs = calloc(uMask + 1, sizeof(struct DT_BatchDir));
+   if(dirs == NULL)
+      return MEMORY_ERROR;
+
+   memset(bitmap, 0, (n + CHAR_BIT - 1) / CHAR_BIT);
+   for(i = 0; i < n; i++) {
+      path = paths[i];
+      assert(path != NULL);
+      len = strlen(path);
+
+      if(filter != NULL) {
+         if(!Bloom_mayContain(filter, path, len)) {
+            filterStats.rejected++;
+            continue;
+         }
+         filterStats.passed++;
+      }
+
+      /* look up the last component in the parent directory, which
+         is only found from the root the first time it comes up */
+      dirLen = len;
+      while(dirLen > 0 && path[dirLen - 1] != '/')
+         dirLen--;
+      if(dirLen == 0)
+         found = DT_isWholePath(DT_traversePathFrom(path, len, root),
+                                len);
+      else {
+         curr = DT_findBatchDir(dirs, uMask, path, dirLen - 1);
+         found = curr != NULL &&
+            Node_findChild(DT_childrenOf(curr), path + dirLen,
+                           len - dirLen) != NULL;
+      }
+
+      if(found)
+         bitmap[i / CHAR_BIT] |= (unsigned char) (1U << (i % CHAR_BIT));
+      else if(filter != NULL)
+         filterStats.falsePositives++;
+   }
+
+   free(dirs);
+   assert(DT_IS_VALID());
+   return SUCCESS;
+}
+
+/*
+  Unlinks the directory hierarchy rooted at curr from the tree, and
+  destroys it, unless keep is TRUE, in which case it is left whole,
+  for the log of the open transaction to keep. If curr is the data
+  structure's root, root becomes NULL.
 
+  Returns MEMORY_ERROR if unable to expand the copies that depend on
+  the hierarchy, and SUCCESS otherwise.
+*/
+static int DT_unlinkNode(Node_T curr, boolean keep) {
    Node_T parent;
 
-   assert(path != NULL);
    assert(curr != NULL);
 
    parent = Node_getParent(curr);
 
-   if(!strcmp(path,Node_getPath(curr))) {
-      if(parent == NULL)
-         root = NULL;
-      else
-         Node_unlinkChild(parent, curr);
+   if((parent != NULL && Node_unshare(parent) != SUCCESS) ||
+      Node_unshareHierarchy(curr) != SUCCESS)
+      return MEMORY_ERROR;
 
+   if(parent == NULL)
+      root = NULL;
+   else
+      Node_unlinkChild(parent, curr);
+
+   if(filter != NULL || nameIndex != NULL)
+      DT_indexRemove(curr);
+   if(keep) {
+      DT_clearCache();
+      DT_invalidateDirs(curr);
+      count -= Node_getSubtreeSize(curr);
+   }
+   else
       DT_removePathFrom(curr);
 
-      return SUCCESS;
+   return SUCCESS;
+}
+
+/*
+  Links the directory hierarchy rooted at n, which DT_unlinkNode
+  unlinked and kept, back to parent, or, if parent is NULL, makes it
+  the root again.
+
+  Returns MEMORY_ERROR, leaving everything as it was, if there is an
+  allocation error, and SUCCESS otherwise.
+*/
+static int DT_relinkNode(Node_T n, Node_T parent) {
+   assert(n != NULL);
+
+   if(parent != NULL && Node_unshare(parent) != SUCCESS)
+      return MEMORY_ERROR;
+   if(nameIndex != NULL && !DT_namesAddHierarchy(n)) {
+      DT_namesRemoveHierarchy(n);
+      return MEMORY_ERROR;
    }
-   else
+
+   if(parent == NULL)
+      root = n;
+   else if(Node_linkChild(parent, n) != SUCCESS) {
+      if(nameIndex != NULL)
+         DT_namesRemoveHierarchy(n);
+      return MEMORY_ERROR;
+   }
+
+   if(filter != NULL)
+      DT_filterHierarchy(n, TRUE);
+   count += Node_getSubtreeSize(n);
+   return SUCCESS;
+}
+
+/*
+  Removes the directory hierarchy rooted at curr, the farthest node
+  found along a path of length len, if curr is the node for that
+  whole path. If curr is the data structure's root, root becomes NULL.
+
+  Returns NO_SUCH_PATH if curr is not the node for the path,
+  MEMORY_ERROR if unable to expand the copies that depend on the
+  hierarchy or to log the change, and SUCCESS otherwise.
+ */
+static int DT_rmPathAt(size_t len, Node_T curr) {
+   int result;
+
+   assert(curr != NULL);
+
+   if(!DT_isWholePath(curr, len))
       return NO_SUCH_PATH;
 
+   if(!DT_logChange(DT_UNLINKED, curr))
+      return MEMORY_ERROR;
+   result = DT_unlinkNode(curr, changes != NULL);
+   if(result != SUCCESS)
+      DT_dropChange();
+   return result;
 }
 
 /* see bdt.h for specification */
 int DT_rmPath(char* path) {
+   assert(path != NULL);
+
+   return DT_rmPathN(path, strlen(path));
+}
+
+/* see dt.h for specification */
+int DT_rmPathN(const char* path, size_t len) {
    Node_T curr;
+   size_t rest = 0;
+   size_t mark;
    int result;
 
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   assert(DT_IS_VALID());
    assert(path != NULL);
 
    if(!isInitialized)
       return INITIALIZATION_ERROR;
 
-   curr = DT_traversePath(path);
-   if(curr == NULL)
+   mark = DT_journalMark();
+   if(!DT_journal(DT_RECORD_REMOVE, path, len, "", 0))
+      return MEMORY_ERROR;
+   curr = DT_traversePath(path, len);
+   if(curr != NULL)
+      rest = Node_getPathLength(curr) + 1;
+   if(DT_expandAlong(&curr, path, len, &rest) != SUCCESS)
+      result = MEMORY_ERROR;
+   else if(curr == NULL)
       result =  NO_SUCH_PATH;
    else
-      result = DT_rmPathAt(path, curr);
+      result = DT_rmPathAt(len, curr);
 
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   DT_journalDone(mark, result);
+   assert(DT_IS_VALID());
    return result;
 }
 
+/*
+   Moves the hierarchy rooted at n below newParent, renaming n to the
+   len characters at name, and keeps the filter and the index of
+   names, whichever there are, up to date.
+   Returns MEMORY_ERROR, leaving everything unchanged, if there is an
+   allocation error, and SUCCESS otherwise.
+*/
+static int DT_moveNode(Node_T n, Node_T newParent, const char* name,
+                       size_t len) {
+   struct DT_NameEntry* oldEntry = NULL;
+   size_t oldLen;
+   int result;
 
-/* see dt.h for specification */
-int DT_init(void) {
-   assert(CheckerDT_isValid(isInitialized,root,count));
-   if(isInitialized)
-      return INITIALIZATION_ERROR;
-   isInitialized = 1;
-   root = NULL;
-   count = 0;
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   assert(n != NULL);
+   assert(newParent != NULL);
+   assert(name != NULL);
+
+   /* only n's own name can change, so only n moves in the index of
+      names; its descendants are keyed by node and stay where they
+      are */
+   oldLen = Node_getNameLength(n);
+   if(nameIndex != NULL &&
+      (len != oldLen || memcmp(name, Node_getName(n), len))) {
+      oldEntry = ChildSet_find(nameIndex, Node_getName(n), oldLen);
+      assert(oldEntry != NULL);
+      if(!DT_namesAdd(n, name, len))
+         return MEMORY_ERROR;
+   }
+
+   if(Node_unshare(Node_getParent(n)) != SUCCESS ||
+      Node_unshare(newParent) != SUCCESS)
+      result = MEMORY_ERROR;
+   else {
+      if(filter != NULL)
+         DT_filterHierarchy(n, FALSE);
+      result = Node_move(n, newParent, name, len);
+      if(filter != NULL)
+         DT_filterHierarchy(n, TRUE);
+   }
+
+   if(oldEntry != NULL) {
+      if(result == SUCCESS)
+         DT_namesRemove(n, oldEntry->name, oldLen);
+      else
+         DT_namesRemove(n, name, len);
+   }
+   return result;
+}
+
+/*
+   Finds the directory that DT_move or DT_clone is to make dst a child
+   of, expanding copies so that it is a node of the tree itself with
+   children of its own, and stores it in *parent, and dst's last
+   component in *name and its length in *nameLen.
+   Returns SUCCESS, or otherwise, as DT_move does:
+   CONFLICTING_PATH if dst has no parent or its last component is
+   empty, NO_SUCH_PATH if its parent is not found, ALREADY_IN_TREE if
+   dst is, or MEMORY_ERROR if there is an allocation error.
+*/
+static int DT_findNewParent(const char* dst, Node_T* parent,
+                            const char** name, size_t* nameLen) {
+   const char* last;
+   size_t dstLen;
+
+   assert(dst != NULL);
+   assert(parent != NULL);
+   assert(name != NULL);
+   assert(nameLen != NULL);
+
+   dstLen = strlen(dst);
+   last = strrchr(dst, '/');
+   if(last == NULL || last[1] == '\0')
+      return CONFLICTING_PATH;
+   if(DT_findInTree(dst, (size_t) (last - dst), parent) != SUCCESS)
+      return MEMORY_ERROR;
+   if(*parent == NULL)
+      return NO_SUCH_PATH;
+   if(Node_expand(*parent) != SUCCESS)
+      return MEMORY_ERROR;
+
+   *name = last + 1;
+   *nameLen = dstLen - (size_t) (last + 1 - dst);
+   if(Node_findChild(*parent, *name, *nameLen) != NULL)
+      return ALREADY_IN_TREE;
    return SUCCESS;
 }
 
 /* see dt.h for specification */
-int DT_destroy(void) {
-   assert(CheckerDT_isValid(isInitialized,root,count));
+int DT_move(const char* src, const char* dst) {
+   Node_T curr;
+   Node_T newParent;
+   const char* name;
+   size_t nameLen;
+   size_t srcLen;
+   size_t mark;
+   int result;
+
+   assert(DT_IS_VALID());
+   assert(src != NULL);
+   assert(dst != NULL);
+
    if(!isInitialized)
       return INITIALIZATION_ERROR;
-   DT_removePathFrom(root);
-   root = NULL;
-   isInitialized = 0;
-   assert(CheckerDT_isValid(isInitialized,root,count));
-   return SUCCESS;
+
+   srcLen = strlen(src);
+   mark = DT_journalMark();
+   if(!DT_journal(DT_RECORD_MOVE, src, srcLen, dst, strlen(dst)))
+      return MEMORY_ERROR;
+   if(DT_findInTree(src, srcLen, &curr) != SUCCESS)
+      result = MEMORY_ERROR;
+   else if(curr == NULL)
+      result = NO_SUCH_PATH;
+   else if(Node_getParent(curr) == NULL ||
+           Path_hasPrefix(dst, strlen(dst), src, srcLen))
+      result = CONFLICTING_PATH;
+   else {
+      result = DT_findNewParent(dst, &newParent, &name, &nameLen);
+      /* the cached nodes all still exist, and each is checked
+         against the path being looked up before use, so the cache
+         can be left as it is */
+      if(result == SUCCESS) {
+         if(!DT_logChange(DT_MOVED, curr))
+            result = MEMORY_ERROR;
+         else {
+            result = DT_moveNode(curr, newParent, name, nameLen);
+            if(result != SUCCESS)
+               DT_dropChange();
+         }
+      }
+   }
+
+   DT_journalDone(mark, result);
+   assert(DT_IS_VALID());
+   return result;
 }
 
+/* see dt.h for specification */
+int DT_clone(const char* src, const char* dst) {
+   Node_T curr;
+   Node_T source;
+   Node_T newParent;
+   Node_T copy;
+   Node_T n;
+   boolean inside;
+   const char* name;
+   size_t nameLen;
+   size_t srcLen;
+   size_t mark;
+   int result;
 
-/*
-   Performs a pre-order traversal of the tree rooted at n,
-   inserting each payload to DynArray_T d beginning at index i.
-   Returns the next unused index in d after the insertion(s).
-*/
-static size_t DT_preOrderTraversal(Node_T n, DynArray_T d, size_t i) {
-   size_t c;
+   assert(DT_IS_VALID());
+   assert(src != NULL);
+   assert(dst != NULL);
 
-   assert(d != NULL);
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
 
-   if(n != NULL) {
-      (void) DynArray_set(d, i, Node_getPath(n));
-      i++;
-      for(c = 0; c < Node_getNumChildren(n); c++)
-         i = DT_preOrderTraversal(Node_getChild(n, c), d, i);
+   /* the hierarchy copied need not be in the tree itself: a copy of
+      part of an unexpanded copy shares the same source */
+   srcLen = strlen(src);
+   mark = DT_journalMark();
+   if(!DT_journal(DT_RECORD_CLONE, src, srcLen, dst, strlen(dst)))
+      return MEMORY_ERROR;
+   curr = DT_findPath(src, srcLen);
+   if(curr == NULL)
+      result = NO_SUCH_PATH;
+   else if(Path_hasPrefix(dst, strlen(dst), src, srcLen))
+      result = CONFLICTING_PATH;
+   else {
+      result = DT_findNewParent(dst, &newParent, &name, &nameLen);
+      if(result == SUCCESS && Node_unshare(newParent) != SUCCESS)
+         result = MEMORY_ERROR;
    }
-   return i;
+   /* curr may be a source elsewhere in the tree, under another path
+      than src, or a copy of one, and dst may then be inside the
+      hierarchy that the copy would stand for: that copy is made in
+      full before it is linked, so that it holds the hierarchy as it
+      was, not itself */
+   inside = FALSE;
+   if(result == SUCCESS) {
+      source = Node_getSource(curr);
+      for(n = newParent; n != NULL && !inside; n = Node_getParent(n))
+         inside = (boolean) (n == curr || n == source);
+   }
+   if(result == SUCCESS) {
+      copy = Node_createCopy(curr, name, nameLen, newParent);
+      if(copy == NULL)
+         result = MEMORY_ERROR;
+      else if(inside && !DT_expandHierarchy(copy)) {
+         (void) Node_destroy(copy);
+         result = MEMORY_ERROR;
+      }
+      else
+         result = DT_linkParentToChild(newParent, copy);
+   }
+   if(result != SUCCESS) {
+      DT_journalDone(mark, result);
+      assert(DT_IS_VALID());
+      return result;
+   }
+   count += Node_getSubtreeSize(copy);
+
+   /* the filter takes the copy's paths without their being made, but
+      the index of names holds every directory anyway, so with it the
+      copy is made in full at once */
+   if(filter != NULL)
+      DT_filterHierarchy(copy, TRUE);
+   if((nameIndex != NULL &&
+       (!DT_expandHierarchy(copy) || !DT_namesAddHierarchy(copy))) ||
+      !DT_logChange(DT_LINKED, copy)) {
+      DT_indexRemove(copy);
+      (void) Node_unlinkChild(newParent, copy);
+      count -= Node_destroy(copy);
+      result = MEMORY_ERROR;
+   }
+
+   DT_journalDone(mark, result);
+   assert(DT_IS_VALID());
+   return result;
 }
 
-/*
-   Alternate version of strlen that uses pAcc as an in-out parameter
-   to accumulate a string length, rather than returning the length of
-   str, and also always adds one more in addition to str's length.
-*/
-static void DT_strlenAccumulate(char* str, size_t* pAcc) {
-   assert(pAcc != NULL);
+/* see dt.h for specification */
+int DT_openDir(const char* path, DT_Dir_T* dir) {
+   Node_T curr;
+   struct DT_Dir* new;
 
-   if(str != NULL)
-      *pAcc += (strlen(str) + 1);
+   assert(DT_IS_VALID());
+   assert(path != NULL);
+   assert(dir != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+
+   if(DT_findInTree(path, strlen(path), &curr) != SUCCESS)
+      return MEMORY_ERROR;
+   if(curr == NULL)
+      return NO_SUCH_PATH;
+
+   new = malloc(sizeof(struct DT_Dir));
+   if(new == NULL)
+      return MEMORY_ERROR;
+
+   new->node = curr;
+   new->prev = NULL;
+   new->next = openDirs;
+   if(openDirs != NULL)
+      openDirs->prev = new;
+   openDirs = new;
+
+   *dir = new;
+   return SUCCESS;
 }
 
-/*
-   Alternate version of strcat that inverts the typical argument
-   order, appending str onto acc, and also always adds a newline at
-   the end of the concatenated string.
-*/
-static void DT_strcatAccumulate(char* str, char* acc) {
-   assert(acc != NULL);
+/* see dt.h for specification */
+void DT_closeDir(DT_Dir_T dir) {
+   assert(dir != NULL);
 
-   if(str != NULL)
-      strcat(acc, str); strcat(acc, "\n");
+   if(dir->prev == NULL)
+      openDirs = dir->next;
+   else
+      dir->prev->next = dir->next;
+   if(dir->next != NULL)
+      dir->next->prev = dir->prev;
+   free(dir);
 }
 
 /* see dt.h for specification */
-char* DT_toString(void) {
-   DynArray_T nodes;
-   size_t totalStrlen = 1;
-   char* result = NULL;
+int DT_insertAt(DT_Dir_T dir, const char* rel) {
+   Node_T curr;
+   size_t len;
+   size_t rest;
+   size_t mark;
+   int result;
 
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   assert(DT_IS_VALID());
+   assert(dir != NULL);
+   assert(rel != NULL);
 
    if(!isInitialized)
-      return NULL;
+      return INITIALIZATION_ERROR;
+   if(dir->node == NULL)
+      return NO_SUCH_PATH;
 
-   nodes = DynArray_new(count);
-   (void) DT_preOrderTraversal(root, nodes, 0);
+   len = strlen(rel);
+   mark = DT_journalMark();
+   if(!DT_journal(DT_RECORD_INSERT, Node_getPath(dir->node),
+                  Node_getPathLength(dir->node), rel, len))
+      return MEMORY_ERROR;
+   curr = DT_traverseRelative(dir->node, rel, len, &rest);
+   if(DT_expandAlong(&curr, rel, len, &rest) != SUCCESS)
+      result = MEMORY_ERROR;
+   else if(rest > len)
+      result = ALREADY_IN_TREE;
+   else
+      result = DT_insertComponents(rel, len, rest, curr);
 
-   DynArray_map(nodes, (void (*)(void *, void*)) DT_strlenAccumulate, (void*) &totalStrlen);
+   DT_journalDone(mark, result);
+   assert(DT_IS_VALID());
+   return result;
+}
 
-   result = malloc(totalStrlen);
-   if(result == NULL) {
-      DynArray_free(nodes);
-      assert(CheckerDT_isValid(isInitialized,root,count));
-      return NULL;
-   }
-   *result = '\0';
+/* see dt.h for specification */
+boolean DT_containsAt(DT_Dir_T dir, const char* rel) {
+   Node_T curr;
+   size_t len;
+   size_t rest;
 
-   DynArray_map(nodes, (void (*)(void *, void*)) DT_strcatAccumulate, (void *) result);
+   assert(DT_IS_VALID());
+   assert(dir != NULL);
+   assert(rel != NULL);
+
+   if(!isInitialized || dir->node == NULL)
+      return FALSE;
+
+   len = strlen(rel);
+   curr = DT_traverseRelative(dir->node, rel, len, &rest);
+   if(DT_lookUp(curr, rel, len, rest) != NULL)
+      return TRUE;
+   else
+      return FALSE;
+}
+
+/* see dt.h for specification */
+int DT_rmAt(DT_Dir_T dir, const char* rel) {
+   Node_T curr;
+   size_t len;
+   size_t rest;
+   size_t mark;
+   int result;
+
+   assert(DT_IS_VALID());
+   assert(dir != NULL);
+   assert(rel != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+   if(dir->node == NULL)
+      return NO_SUCH_PATH;
+
+   len = strlen(rel);
+   mark = DT_journalMark();
+   if(!DT_journal(DT_RECORD_REMOVE, Node_getPath(dir->node),
+                  Node_getPathLength(dir->node), rel, len))
+      return MEMORY_ERROR;
+   curr = DT_traverseRelative(dir->node, rel, len, &rest);
+   if(DT_expandAlong(&curr, rel, len, &rest) != SUCCESS)
+      result = MEMORY_ERROR;
+   else if(rest <= len)
+      result = NO_SUCH_PATH;
+   else
+      result = DT_rmPathAt(Node_getPathLength(curr), curr);
+
+   DT_journalDone(mark, result);
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/*
+   Fills in *stat for the directory whose path is len characters long
+   and whose children curr's stand for, as DT_lookUp found it.
+*/
+static void DT_statNode(Node_T curr, size_t len, struct DT_Stat* stat) {
+   size_t size;
+
+   assert(curr != NULL);
+   assert(stat != NULL);
+
+   /* below a copy, curr's paths are as much shorter or longer than
+      the ones it stands for as its own is than path */
+   size = Node_getSubtreeSize(curr);
+   stat->numDirs = size;
+   stat->numChildren = Node_getNumChildren(DT_childrenOf(curr));
+   stat->listingBytes = Node_getSubtreeBytes(curr)
+      - size * Node_getPathLength(curr) + size * len;
+}
+
+/* see dt.h for specification */
+int DT_stat(char* path, struct DT_Stat* stat) {
+   Node_T curr;
+   size_t len;
+
+   assert(DT_IS_VALID());
+   assert(path != NULL);
+   assert(stat != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+
+   len = strlen(path);
+   curr = DT_findPath(path, len);
+   if(curr == NULL)
+      return NO_SUCH_PATH;
+   DT_statNode(curr, len, stat);
+
+   assert(DT_IS_VALID());
+   return SUCCESS;
+}
+
+/* see dt.h for specification */
+int DT_listDir(char* path, void (*callback)(const char* name, void* ctx),
+               void* ctx) {
+   Node_ChildIter iter;
+   Node_T curr;
+   Node_T c;
+
+   assert(DT_IS_VALID());
+   assert(path != NULL);
+   assert(callback != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+
+   curr = DT_findPath(path, strlen(path));
+   if(curr == NULL)
+      return NO_SUCH_PATH;
+
+   curr = DT_childrenOf(curr);
+   for(c = Node_firstChild(curr, &iter); c != NULL;
+       c = Node_nextChild(curr, &iter))
+      callback(Node_getName(c), ctx);
+
+   assert(DT_IS_VALID());
+   return SUCCESS;
+}
+
+/* see dt.h for specification */
+int DT_listDirInto(char* path, const char** names, size_t capacity,
+                   size_t* numChildren) {
+   Node_ChildIter iter;
+   Node_T curr;
+   Node_T c;
+   size_t i = 0;
+
+   assert(DT_IS_VALID());
+   assert(path != NULL);
+   assert(names != NULL || capacity == 0);
+   assert(numChildren != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+
+   curr = DT_findPath(path, strlen(path));
+   if(curr == NULL)
+      return NO_SUCH_PATH;
+
+   curr = DT_childrenOf(curr);
+   for(c = Node_firstChild(curr, &iter); c != NULL && i < capacity;
+       c = Node_nextChild(curr, &iter))
+      names[i++] = Node_getName(c);
+   *numChildren = Node_getNumChildren(curr);
+
+   assert(DT_IS_VALID());
+   return SUCCESS;
+}
+
+
+/*
+   Makes n, the root of a hierarchy built apart from the tree, which
+   must be empty, the tree's root, indexing and logging it as a
+   hierarchy linked in. Returns SUCCESS, or MEMORY_ERROR, having
+   destroyed the hierarchy and left the tree empty, if there is an
+   allocation error.
+*/
+static int DT_adoptHierarchy(Node_T n) {
+   assert(n != NULL);
+   assert(root == NULL);
+
+   root = n;
+   count = Node_getSubtreeSize(root);
+   if(filter != NULL)
+      DT_filterHierarchy(root, TRUE);
+   if((nameIndex != NULL && !DT_namesAddHierarchy(root)) ||
+      !DT_logChange(DT_LINKED, root)) {
+      DT_indexRemove(root);
+      count -= Node_destroy(root);
+      root = NULL;
+      return MEMORY_ERROR;
+   }
+   return SUCCESS;
+}
+
+/*
+   Reads the image from the file descriptor fd, as DT_load does, and
+   checks it whole, storing it in *image. Returns SUCCESS, or
+   MEMORY_ERROR or IO_ERROR as DT_load does.
+*/
+static int DT_readImage(int fd, Image_T* image) {
+   enum Image_Status status;
+
+   assert(image != NULL);
+
+   *image = Image_map(fd, &status);
+   if(*image == NULL)
+      return status == IMAGE_MEMORY ? MEMORY_ERROR : IO_ERROR;
+   if(!Image_check(*image)) {
+      Image_free(*image);
+      return IO_ERROR;
+   }
+   return SUCCESS;
+}
+
+/*
+   Builds the hierarchy of the nodes of image, which has at least one
+   and has been checked, from the root down, and returns its root, or
+   returns NULL if there is an allocation error. Each node comes after
+   its parent, so building them in order only ever links a new node
+   to one already built.
+*/
+static Node_T DT_buildImage(Image_T image) {
+   const struct ImageNode* record;
+   Node_T* nodes;
+   Node_T parent;
+   Node_T new;
+   size_t n;
+   size_t i;
+
+   assert(image != NULL);
+
+   n = Image_getLength(image);
+   nodes = malloc(n * sizeof(Node_T));
+   if(nodes == NULL)
+      return NULL;
+
+   for(i = 0; i < n; i++) {
+      record = Image_getNode(image, i);
+      parent = i == 0 ? NULL : nodes[record->uParent];
+      new = Node_createN(Image_getName(image, record),
+                         record->uNameLength, parent);
+      if(new == NULL ||
+         (parent != NULL && Node_linkChild(parent, new) != SUCCESS)) {
+         if(new != NULL)
+            (void) Node_destroy(new);
+         if(i > 0)
+            (void) Node_destroy(nodes[0]);
+         free(nodes);
+         return NULL;
+      }
+      nodes[i] = new;
+   }
+
+   new = nodes[0];
+   free(nodes);
+   return new;
+}
+
+/*
+   Makes the tree, which must be empty, that of image, which has been
+   checked. Returns SUCCESS, or MEMORY_ERROR, leaving the tree empty,
+   if there is an allocation error.
+*/
+static int DT_loadImage(Image_T image) {
+   Node_T built;
+
+   assert(image != NULL);
+   assert(root == NULL);
+
+   if(Image_getLength(image) == 0)
+      return SUCCESS;
+   built = DT_buildImage(image);
+   if(built == NULL)
+      return MEMORY_ERROR;
+   return DT_adoptHierarchy(built);
+}
+
+/*
+   Applies record, read back from the journal, to the tree, as the
+   change that it records was first made. Returns the result of the
+   change, which should be SUCCESS, or MEMORY_ERROR if there is an
+   allocation error.
+*/
+static int DT_replay(const struct Journal_Record* record) {
+   char* path;
+   size_t len;
+   int result;
+
+   assert(record != NULL);
+
+   if(record->iKind == DT_RECORD_MOVE)
+      return DT_move(record->pcFirst, record->pcSecond);
+   if(record->iKind == DT_RECORD_CLONE)
+      return DT_clone(record->pcFirst, record->pcSecond);
+   if(record->iKind != DT_RECORD_INSERT &&
+      record->iKind != DT_RECORD_REMOVE)
+      return IO_ERROR;
+
+   /* a path relative to a directory is joined to the directory's */
+   if(record->uSecondLength == 0) {
+      if(record->iKind == DT_RECORD_INSERT)
+         return DT_insertPathN(record->pcFirst, record->uFirstLength);
+      return DT_rmPathN(record->pcFirst, record->uFirstLength);
+   }
+   len = record->uFirstLength + 1 + record->uSecondLength;
+   path = malloc(len);
+   if(path == NULL)
+      return MEMORY_ERROR;
+   memcpy(path, record->pcFirst, record->uFirstLength);
+   path[record->uFirstLength] = '/';
+   memcpy(path + record->uFirstLength + 1, record->pcSecond,
+          record->uSecondLength);
+   if(record->iKind == DT_RECORD_INSERT)
+      result = DT_insertPathN(path, len);
+   else
+      result = DT_rmPathN(path, len);
+   free(path);
+   return result;
+}
+
+/*
+   Recovers the tree that options give: loads the image, if any, and
+   then replays the records of the journal, if any, that come after
+   those that the image holds, and keeps the journal for the changes
+   to come. Returns SUCCESS, otherwise MEMORY_ERROR or IO_ERROR as
+   DT_initWithOptions does, leaving the journal unopened.
+*/
+static int DT_recover(const struct DT_Options* options) {
+   struct Journal_Record record;
+   enum Journal_Status status;
+   Journal_T opened;
+   Image_T image;
+   size_t stamp = 0;
+   size_t latest;
+   int result;
+
+   assert(options != NULL);
+
+   if(options->imageFd >= 0) {
+      result = DT_readImage(options->imageFd, &image);
+      if(result != SUCCESS)
+         return result;
+      stamp = Image_getStamp(image);
+      result = DT_loadImage(image);
+      Image_free(image);
+      if(result != SUCCESS)
+         return result;
+   }
+   if(options->journalFd < 0)
+      return SUCCESS;
+
+   opened = Journal_open(options->journalFd, options->journalWindow,
+                         &status);
+   if(opened == NULL)
+      return status == JOURNAL_MEMORY ? MEMORY_ERROR : IO_ERROR;
+
+   /* the records must pick up where the image leaves off, and every
+      change that they record succeeded the first time */
+   latest = stamp;
+   result = SUCCESS;
+   while(result == SUCCESS && Journal_next(opened, &record)) {
+      if(record.uSequence <= stamp)
+         continue;
+      if(record.uSequence != latest + 1)
+         result = IO_ERROR;
+      else {
+         result = DT_replay(&record);
+         if(result != SUCCESS && result != MEMORY_ERROR)
+            result = IO_ERROR;
+      }
+      latest = record.uSequence;
+   }
+   if(result != SUCCESS) {
+      Journal_free(opened);
+      return result;
+   }
+
+   if(Journal_getSequence(opened) < stamp)
+      Journal_setSequence(opened, stamp);
+   journal = opened;
+   return SUCCESS;
+}
+
+/* see dt.h for specification */
+void DT_defaultOptions(struct DT_Options* options) {
+   assert(options != NULL);
+
+   options->childIndex = DT_INDEX_HASH;
+   options->filterCounters = 0;
+   options->indexNames = FALSE;
+   options->imageFd = -1;
+   options->journalFd = -1;
+   options->journalWindow = 0;
+}
+
+/* see dt.h for specification */
+int DT_initWithOptions(const struct DT_Options* options) {
+   int result;
+
+   assert(DT_IS_VALID());
+   assert(options != NULL);
+
+   if(isInitialized)
+      return INITIALIZATION_ERROR;
+
+   filter = NULL;
+   if(options->filterCounters > 0) {
+      filter = Bloom_new(options->filterCounters);
+      if(filter == NULL)
+         return MEMORY_ERROR;
+   }
+   filterStats.rejected = 0;
+   filterStats.passed = 0;
+   filterStats.falsePositives = 0;
+
+   nameIndex = NULL;
+   if(options->indexNames) {
+      nameIndex = ChildSet_new(CHILDSET_HASH);
+      if(nameIndex == NULL) {
+         if(filter != NULL) {
+            Bloom_free(filter);
+            filter = NULL;
+         }
+         return MEMORY_ERROR;
+      }
+   }
+
+   if(options->childIndex == DT_INDEX_BTREE)
+      Node_setChildKind(CHILDSET_BTREE);
+   else
+      Node_setChildKind(CHILDSET_HASH);
+
+   isInitialized = 1;
+   root = NULL;
+   count = 0;
+   DT_clearCache();
+   cacheStats.hits = 0;
+   cacheStats.misses = 0;
+   journal = NULL;
+   checkpointed = FALSE;
+
+   result = DT_recover(options);
+   if(result != SUCCESS)
+      (void) DT_destroy();
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/* see dt.h for specification */
+int DT_init(void) {
+   struct DT_Options options;
+
+   DT_defaultOptions(&options);
+   return DT_initWithOptions(&options);
+}
+
+/* see dt.h for specification */
+void DT_getCacheStats(struct DT_CacheStats* stats) {
+   assert(stats != NULL);
+
+   *stats = cacheStats;
+}
+
+/* see dt.h for specification */
+void DT_getFilterStats(struct DT_FilterStats* stats) {
+   assert(stats != NULL);
+
+   *stats = filterStats;
+}
+
+/* see dt.h for specification */
+int DT_destroy(void) {
+   int result = SUCCESS;
+
+   assert(DT_IS_VALID());
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+   if(changes != NULL)
+      DT_freeChanges();
+   if(journal != NULL) {
+      if(!Journal_sync(journal, Journal_getEnd(journal)))
+         result = IO_ERROR;
+      Journal_free(journal);
+      journal = NULL;
+   }
+   /* rather than give the snapshots directories of their own, which
+      could fail, leave them the hierarchy, which nothing changes now */
+   if(snaps != NULL) {
+      DT_clearCache();
+      if(root != NULL)
+         DT_invalidateDirs(root);
+      snaps->root = root;
+      snaps = NULL;
+      count = 0;
+   }
+   else
+      DT_removePathFrom(root);
+   root = NULL;
+   if(filter != NULL) {
+      Bloom_free(filter);
+      filter = NULL;
+   }
+   if(nameIndex != NULL) {
+      ChildSet_map(nameIndex,
+                   (void (*)(void*, void*)) DT_freeNameEntry, NULL);
+      ChildSet_free(nameIndex);
+      nameIndex = NULL;
+   }
+   isInitialized = 0;
+   assert(DT_IS_VALID());
+   return result;
+}
+
+
+/*
+   Performs a pre-order traversal of the tree rooted at n,
+   inserting each payload to DynArray_T d beginning at index i.
+   Returns the next unused index in d after the insertion(s).
+*/
+static size_t DT_preOrderTraversal(Node_T n, DynArray_T d, size_t i) {
+   Node_ChildIter iter;
+   Node_T c;
+
+   assert(d != NULL);
+
+   if(n != NULL) {
+      (void) DynArray_set(d, i, Node_getPath(n));
+      i++;
+      for(c = Node_firstChild(n, &iter); c != NULL;
+          c = Node_nextChild(n, &iter))
+         i = DT_preOrderTraversal(c, d, i);
+   }
+   return i;
+}
+
+/*
+   Alternate version of strlen that uses pAcc as an in-out parameter
+   to accumulate a string length, rather than returning the length of
+   str, and also always adds one more in addition to str's length.
+*/
+static void DT_strlenAccumulate(char* str, size_t* pAcc) {
+   assert(pAcc != NULL);
+
+   if(str != NULL)
+      *pAcc += (strlen(str) + 1);
+}
+
+/*
+   Alternate version of strcat that inverts the typical argument
+   order, appending str onto acc, and also always adds a newline at
+   the end of the concatenated string.
+*/
+static void DT_strcatAccumulate(char* str, char* acc) {
+   assert(acc != NULL);
+
+   if(str != NULL)
+      strcat(acc, str); strcat(acc, "\n");
+}
+
+/*
+   Returns a new string of the paths in nodes, each followed by a
+   newline, or NULL if there is an allocation error.
+*/
+static char* DT_joinPaths(DynArray_T nodes) {
+   size_t totalStrlen = 1;
+   char* result = NULL;
+
+   assert(nodes != NULL);
+
+   DynArray_map(nodes, (void (*)(void *, void*)) DT_strlenAccumulate, (void*) &totalStrlen);
+
+   result = malloc(totalStrlen);
+   if(result == NULL)
+      return NULL;
+   *result = '\0';
+
+   DynArray_map(nodes, (void (*)(void *, void*)) DT_strcatAccumulate, (void *) result);
+
+   return result;
+}
+
+/* see dt.h for specification */
+char* DT_toString(void) {
+   DynArray_T nodes;
+   char* result = NULL;
+
+   assert(DT_IS_VALID());
+
+   if(!isInitialized)
+      return NULL;
+
+   /* every path is listed, so every copy must be made in full */
+   if(root != NULL && !DT_expandHierarchy(root))
+      return NULL;
+
+   nodes = DynArray_new(count);
+   (void) DT_preOrderTraversal(root, nodes, 0);
+
+   result = DT_joinPaths(nodes);
 
    DynArray_free(nodes);
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/*
+   Adds to d the paths of at most *remaining nodes of the hierarchy
+   rooted at n, in pre-order, starting from the one at position offset
+   in that order, and decreases *remaining by the number added.
+
+   Rather than visiting the nodes before offset, this seeks past them
+   one level at a time by subtree size, so the only copies that are
+   expanded are those along the way to the nodes added.
+
+   Returns FALSE if there is an allocation error, TRUE otherwise.
+*/
+static boolean DT_listFrom(Node_T n, size_t offset, size_t* remaining,
+                           DynArray_T d) {
+   Node_ChildIter iter;
+   Node_T c;
+
+   assert(n != NULL);
+   assert(remaining != NULL);
+   assert(d != NULL);
+
+   if(*remaining == 0)
+      return TRUE;
+
+   if(offset == 0) {
+      if(!DynArray_add(d, Node_getPath(n)))
+         return FALSE;
+      (*remaining)--;
+      if(*remaining == 0)
+         return TRUE;
+   }
+   if(Node_expand(n) != SUCCESS)
+      return FALSE;
+
+   if(offset == 0)
+      c = Node_firstChild(n, &iter);
+   else {
+      offset--;
+      c = Node_seekChild(n, &offset, &iter);
+   }
+
+   for( ; c != NULL && *remaining > 0; c = Node_nextChild(n, &iter)) {
+      if(!DT_listFrom(c, offset, remaining, d))
+         return FALSE;
+      offset = 0;
+   }
+   return TRUE;
+}
+
+/* see dt.h for specification */
+char* DT_list(char* path, size_t offset, size_t limit, size_t* total) {
+   DynArray_T nodes;
+   Node_T curr;
+   char* result = NULL;
+
+   assert(DT_IS_VALID());
+   assert(path != NULL);
+
+   if(!isInitialized)
+      return NULL;
+
+   if(DT_findInTree(path, strlen(path), &curr) != SUCCESS ||
+      curr == NULL)
+      return NULL;
+
+   if(total != NULL)
+      *total = Node_getSubtreeSize(curr);
+
+   nodes = DynArray_new(0);
+   if(nodes == NULL)
+      return NULL;
+
+   if(DT_listFrom(curr, offset, &limit, nodes))
+      result = DT_joinPaths(nodes);
+
+   DynArray_free(nodes);
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/* The upper bound and callback of a DT_scanRange, and its result */
+struct DT_Scan {
+   /* the bound, the len characters at to, or NULL for none */
+   const char* to;
+   size_t toLen;
+   void (*callback)(const char* path, void* ctx);
+   void* ctx;
+   /* SUCCESS, or MEMORY_ERROR if a copy could not be expanded */
+   int result;
+};
+
+/*
+   Calls scan's callback on the path of each node of the hierarchy
+   rooted at n, in pre-order, until it comes to one not before scan's
+   upper bound, expanding the copies it comes to.
+
+   Returns FALSE if it came to such a node, or could not expand a
+   copy, so that the scan should stop, and TRUE otherwise.
+*/
+static boolean DT_scanAll(Node_T n, struct DT_Scan* scan) {
+   Node_ChildIter iter;
+   Node_T c;
+
+   assert(n != NULL);
+   assert(scan != NULL);
+
+   if(scan->to != NULL &&
+      Path_compare(Node_getPath(n), Node_getPathLength(n),
+                   scan->to, scan->toLen) >= 0)
+      return FALSE;
+
+   scan->callback(Node_getPath(n), scan->ctx);
+   if(Node_expand(n) != SUCCESS) {
+      scan->result = MEMORY_ERROR;
+      return FALSE;
+   }
+   for(c = Node_firstChild(n, &iter); c != NULL;
+       c = Node_nextChild(n, &iter))
+      if(!DT_scanAll(c, scan))
+         return FALSE;
+   return TRUE;
+}
+
+/*
+   Like DT_scanAll, but skips the nodes before the lower bound from,
+   the fromLen characters at from, which must be at or below n.
+   Rather than visiting the skipped nodes, this seeks past them one
+   level at a time by name.
+*/
+static boolean DT_scanFrom(Node_T n, const char* from, size_t fromLen,
+                           struct DT_Scan* scan) {
+   Node_ChildIter iter;
+   Node_T c;
+   const char* name;
+   size_t nameLen;
+   size_t offset;
+
+   assert(n != NULL);
+   assert(from != NULL);
+   assert(scan != NULL);
+
+   offset = Node_getPathLength(n);
+   if(offset == fromLen)
+      return DT_scanAll(n, scan);
+
+   /* n itself comes before from, as do its children before the one
+      along from */
+   if(Node_expand(n) != SUCCESS) {
+      scan->result = MEMORY_ERROR;
+      return FALSE;
+   }
+   offset++;
+   (void) Path_nextComponent(from, fromLen, &offset, &name, &nameLen);
+   c = Node_seekChildName(n, name, nameLen, &iter);
+   if(c != NULL && Path_hasPrefix(from, fromLen, Node_getPath(c),
+                                  Node_getPathLength(c))) {
+      if(!DT_scanFrom(c, from, fromLen, scan))
+         return FALSE;
+      c = Node_nextChild(n, &iter);
+   }
+   for( ; c != NULL; c = Node_nextChild(n, &iter))
+      if(!DT_scanAll(c, scan))
+         return FALSE;
+   return TRUE;
+}
+
+/* see dt.h for specification */
+int DT_scanRange(const char* from, const char* to,
+                 void (*callback)(const char* path, void* ctx),
+                 void* ctx) {
+   struct DT_Scan scan;
+   size_t fromLen;
+
+   assert(DT_IS_VALID());
+   assert(callback != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+   if(root == NULL)
+      return SUCCESS;
+
+   scan.to = to;
+   scan.toLen = to == NULL ? 0 : strlen(to);
+   scan.callback = callback;
+   scan.ctx = ctx;
+   scan.result = SUCCESS;
+
+   if(from == NULL)
+      (void) DT_scanAll(root, &scan);
+   else {
+      fromLen = strlen(from);
+      if(Path_hasPrefix(from, fromLen, Node_getPath(root),
+                        Node_getPathLength(root)))
+         (void) DT_scanFrom(root, from, fromLen, &scan);
+      else if(Path_compare(Node_getPath(root), Node_getPathLength(root),
+                           from, fromLen) > 0)
+         (void) DT_scanAll(root, &scan);
+   }
+
+   assert(DT_IS_VALID());
+   return scan.result;
+}
+
+/* One component of a DT_glob pattern */
+struct DT_GlobPart {
+   /* the component, the len characters at part */
+   const char* part;
+   size_t len;
+   /* how many of them come before its first wildcard */
+   size_t literalLen;
+   /* whether the component is "**" */
+   boolean anyDepth;
+};
+
+/* A DT_glob query: its pattern, split into components, and its
+   callback */
+struct DT_Glob {
+   struct DT_GlobPart* parts;
+   size_t numParts;
+   void (*callback)(const char* path, void* ctx);
+   void* ctx;
+};
+
+/*
+   Sets states[i + 1] for every states[i] that is set and whose
+   component of glob is "**", since that can match no components.
+*/
+static void DT_globClose(const struct DT_Glob* glob, boolean* states) {
+   size_t i;
+
+   assert(glob != NULL);
+   assert(states != NULL);
+
+   for(i = 0; i < glob->numParts; i++)
+      if(states[i] && glob->parts[i].anyDepth)
+         states[i + 1] = TRUE;
+}
+
+/*
+   Stores in next the states of glob after node n, given the states
+   before it, where states[i] is set if the components of glob before
+   the one at i have matched the path so far.
+
+   Returns TRUE if any of next is set, and FALSE otherwise.
+*/
+static boolean DT_globStep(const struct DT_Glob* glob,
+                           const boolean* states, Node_T n,
+                           boolean* next) {
+   const struct DT_GlobPart* part;
+   boolean any = FALSE;
+   size_t i;
+
+   assert(glob != NULL);
+   assert(states != NULL);
+   assert(n != NULL);
+   assert(next != NULL);
+
+   for(i = 0; i <= glob->numParts; i++)
+      next[i] = FALSE;
+   for(i = 0; i < glob->numParts; i++) {
+      if(!states[i])
+         continue;
+      part = &glob->parts[i];
+      if(part->anyDepth)
+         next[i] = any = TRUE;
+      else if(Path_match(part->part, part->len, Node_getName(n),
+                         Node_getNameLength(n)))
+         next[i + 1] = any = TRUE;
+   }
+   DT_globClose(glob, next);
+   return any;
+}
+
+/*
+   Calls glob's callback on n, whose states are in states, if it
+   matches the whole pattern, and then on the nodes that match below
+   it, visiting only the children that some state could match.
+
+   Returns MEMORY_ERROR if unable to allocate the states of n's
+   children or to expand n, if it is a copy, and SUCCESS otherwise.
+*/
+static int DT_globFrom(const struct DT_Glob* glob, Node_T n,
+                       const boolean* states) {
+   const struct DT_GlobPart* part = NULL;
+   Node_ChildIter iter;
+   Node_T c;
+   boolean* next;
+   size_t active = 0;
+   size_t i;
+   int result = SUCCESS;
+
+   assert(glob != NULL);
+   assert(n != NULL);
+   assert(states != NULL);
+
+   if(states[glob->numParts])
+      glob->callback(Node_getPath(n), glob->ctx);
+
+   for(i = 0; i < glob->numParts; i++)
+      if(states[i]) {
+         part = &glob->parts[i];
+         active++;
+      }
+   if(active == 0)
+      return SUCCESS;
+   if(Node_expand(n) != SUCCESS)
+      return MEMORY_ERROR;
+   if(Node_getNumChildren(n) == 0)
+      return SUCCESS;
+
+   next = malloc((glob->numParts + 1) * sizeof(boolean));
+   if(next == NULL)
+      return MEMORY_ERROR;
+
+   /* with one component left to match, and no "**" to match it
+      with, the children worth visiting are the one of its name or
+      those that start with its literal prefix */
+   if(active == 1 && !part->anyDepth &&
+      part->literalLen == part->len) {
+      c = Node_findChild(n, part->part, part->len);
+      if(c != NULL && DT_globStep(glob, states, c, next))
+         result = DT_globFrom(glob, c, next);
+   }
+   else if(active == 1 && !part->anyDepth) {
+      for(c = Node_seekChildName(n, part->part, part->literalLen, &iter);
+          c != NULL && result == SUCCESS &&
+             Node_getNameLength(c) >= part->literalLen &&
+             !memcmp(Node_getName(c), part->part, part->literalLen);
+          c = Node_nextChild(n, &iter))
+         if(DT_globStep(glob, states, c, next))
+            result = DT_globFrom(glob, c, next);
+   }
+   else {
+      for(c = Node_firstChild(n, &iter); c != NULL && result == SUCCESS;
+          c = Node_nextChild(n, &iter))
+         if(DT_globStep(glob, states, c, next))
+            result = DT_globFrom(glob, c, next);
+   }
+
+   free(next);
+   return result;
+}
+
+/* see dt.h for specification */
+int DT_glob(const char* pattern,
+            void (*callback)(const char* path, void* ctx), void* ctx) {
+   struct DT_Glob glob;
+   const char* part;
+   size_t partLen;
+   size_t len;
+   size_t offset;
+   boolean* states;
+   boolean* rootStates;
+   int result = SUCCESS;
+
+   assert(DT_IS_VALID());
+   assert(pattern != NULL);
+   assert(callback != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+   if(root == NULL)
+      return SUCCESS;
+
+   len = strlen(pattern);
+   glob.numParts = 0;
+   offset = 0;
+   while(Path_nextComponent(pattern, len, &offset, &part, &partLen))
+      glob.numParts++;
+
+   glob.parts = malloc(glob.numParts * sizeof(struct DT_GlobPart));
+   states = calloc(2 * (glob.numParts + 1), sizeof(boolean));
+   if(glob.parts == NULL || states == NULL) {
+      free(glob.parts);
+      free(states);
+      return MEMORY_ERROR;
+   }
+   glob.numParts = 0;
+   offset = 0;
+   while(Path_nextComponent(pattern, len, &offset, &part, &partLen)) {
+      glob.parts[glob.numParts].part = part;
+      glob.parts[glob.numParts].len = partLen;
+      glob.parts[glob.numParts].literalLen =
+         Path_literalLength(part, partLen);
+      glob.parts[glob.numParts].anyDepth =
+         partLen == 2 && part[0] == '*' && part[1] == '*';
+      glob.numParts++;
+   }
+   glob.callback = callback;
+   glob.ctx = ctx;
+
+   /* the states before the root, and then after it */
+   states[0] = TRUE;
+   DT_globClose(&glob, states);
+   rootStates = states + glob.numParts + 1;
+   if(DT_globStep(&glob, states, root, rootStates))
+      result = DT_globFrom(&glob, root, rootStates);
+
+   free(states);
+   free(glob.parts);
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/*
+   Calls callback, passing ctx along, on the path of each node of the
+   hierarchy rooted at n whose name is the len characters at name,
+   expanding the copies it comes to.
+
+   Returns MEMORY_ERROR if unable to expand a copy, and SUCCESS
+   otherwise.
+*/
+static int DT_findByNameFrom(Node_T n, const char* name, size_t len,
+                             void (*callback)(const char* path,
+                                              void* ctx),
+                             void* ctx) {
+   Node_ChildIter iter;
+   Node_T c;
+
+   assert(n != NULL);
+   assert(name != NULL);
+   assert(callback != NULL);
+
+   if(Node_getNameLength(n) == len && !memcmp(Node_getName(n), name, len))
+      callback(Node_getPath(n), ctx);
+   if(Node_expand(n) != SUCCESS)
+      return MEMORY_ERROR;
+   for(c = Node_firstChild(n, &iter); c != NULL;
+       c = Node_nextChild(n, &iter))
+      if(DT_findByNameFrom(c, name, len, callback, ctx) != SUCCESS)
+         return MEMORY_ERROR;
+   return SUCCESS;
+}
+
+/* see dt.h for specification */
+int DT_findByName(const char* name,
+                  void (*callback)(const char* path, void* ctx),
+                  void* ctx) {
+   struct DT_NameEntry* entry;
+   ChildSet_Cursor cursor;
+   Node_T* cell;
+   size_t len;
+   int result = SUCCESS;
+
+   assert(DT_IS_VALID());
+   assert(name != NULL);
+   assert(callback != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+
+   len = strlen(name);
+   if(nameIndex != NULL) {
+      entry = ChildSet_find(nameIndex, name, len);
+      if(entry != NULL)
+         for(cell = ChildSet_first(entry->nodes, &cursor); cell != NULL;
+             cell = ChildSet_next(entry->nodes, &cursor))
+            callback(Node_getPath(*cell), ctx);
+   }
+   else if(root != NULL)
+      result = DT_findByNameFrom(root, name, len, callback, ctx);
+
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/* see dt.h for specification */
+int DT_snapshot(DT_Snap_T* snap) {
+   struct DT_Snap* new;
+
+   assert(DT_IS_VALID());
+   assert(snap != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+
+   new = malloc(sizeof(struct DT_Snap));
+   if(new == NULL)
+      return MEMORY_ERROR;
+   if(snaps == NULL) {
+      snaps = malloc(sizeof(struct DT_SnapSet));
+      if(snaps == NULL) {
+         free(new);
+         return MEMORY_ERROR;
+      }
+      snaps->numSnaps = 0;
+      snaps->root = NULL;
+   }
+
+   /* a copy of the root stands for the whole hierarchy, and every
+      change from now on expands it as far as the changed directory
+      before going ahead (see Node_unshare) */
+   new->root = NULL;
+   new->image = NULL;
+   if(root != NULL) {
+      new->root = Node_createCopy(root, Node_getPath(root),
+                                  Node_getPathLength(root), NULL);
+      if(new->root == NULL) {
+         if(snaps->numSnaps == 0) {
+            free(snaps);
+            snaps = NULL;
+         }
+         free(new);
+         return MEMORY_ERROR;
+      }
+   }
+   new->refs = 1;
+   new->set = snaps;
+   snaps->numSnaps++;
+
+   *snap = new;
+   assert(DT_IS_VALID());
+   return SUCCESS;
+}
+
+/* see dt.h for specification */
+void DT_retainSnapshot(DT_Snap_T snap) {
+   assert(snap != NULL);
+   assert(snap->refs > 0);
+
+   snap->refs++;
+}
+
+/* see dt.h for specification */
+void DT_releaseSnapshot(DT_Snap_T snap) {
+   assert(snap != NULL);
+   assert(snap->refs > 0);
+
+   snap->refs--;
+   if(snap->refs > 0)
+      return;
+
+   /* an image's snapshot stands for no directory of the tree */
+   if(snap->image != NULL)
+      Image_free(snap->image);
+   else {
+      if(snap->root != NULL)
+         (void) Node_destroy(snap->root);
+      snap->set->numSnaps--;
+      if(snap->set->numSnaps == 0) {
+         if(snap->set == snaps)
+            snaps = NULL;
+         else if(snap->set->root != NULL)
+            (void) Node_destroy(snap->set->root);
+         free(snap->set);
+      }
+   }
+   free(snap);
+}
+
+/*
+   Returns a node whose children stand for those of the directory with
+   the path given by the len characters at path in snap, as DT_lookUp
+   does, or NULL if there is no such directory.
+*/
+static Node_T DT_findPathIn(DT_Snap_T snap, const char* path,
+                            size_t len) {
+   Node_T curr;
+
+   assert(snap != NULL);
+   assert(path != NULL);
+
+   curr = DT_traversePathFrom(path, len, snap->root);
+   if(curr == NULL)
+      return NULL;
+   return DT_lookUp(curr, path, len, Node_getPathLength(curr) + 1);
+}
+
+/* see dt.h for specification */
+boolean DT_containsIn(DT_Snap_T snap, const char* path) {
+   size_t index;
+
+   assert(snap != NULL);
+   assert(path != NULL);
+
+   if(snap->image != NULL)
+      return (boolean) Image_find(snap->image, path, strlen(path),
+                                  &index);
+   return (boolean) (DT_findPathIn(snap, path, strlen(path)) != NULL);
+}
+
+/* see dt.h for specification */
+int DT_statIn(DT_Snap_T snap, const char* path, struct DT_Stat* stat) {
+   const struct ImageNode* record;
+   Node_T curr;
+   size_t len;
+   size_t index;
+
+   assert(snap != NULL);
+   assert(path != NULL);
+   assert(stat != NULL);
+
+   len = strlen(path);
+   if(snap->image != NULL) {
+      if(!Image_find(snap->image, path, len, &index))
+         return NO_SUCH_PATH;
+      record = Image_getNode(snap->image, index);
+      stat->numDirs = record->uSize;
+      stat->numChildren = record->uChildren;
+      stat->listingBytes = record->uBytes;
+      return SUCCESS;
+   }
+   curr = DT_findPathIn(snap, path, len);
+   if(curr == NULL)
+      return NO_SUCH_PATH;
+   DT_statNode(curr, len, stat);
+   return SUCCESS;
+}
+
+/* A page of the listing of a snapshot, as it is built. The nodes that
+   the snapshot's copies stand for may have other paths by now, so
+   each directory's path is built from the names on the way to it. */
+struct DT_SnapList {
+   /* the path of the directory being visited, in a buffer of
+      pathSize bytes */
+   char* path;
+   size_t pathLen;
+   size_t pathSize;
+   /* the listing so far, in a buffer of outSize bytes */
+   char* out;
+   size_t outLen;
+   size_t outSize;
+};
+
+/*
+   Makes the buffer *buf, of *size bytes, at least need bytes long,
+   at least doubling it if it must grow. Returns FALSE, leaving it as
+   it was, if there is an allocation error, and TRUE otherwise.
+*/
+static boolean DT_reserve(char** buf, size_t* size, size_t need) {
+   char* grown;
+   size_t newSize;
+
+   assert(buf != NULL);
+   assert(size != NULL);
+
+   if(need <= *size)
+      return TRUE;
+   newSize = 2 * *size;
+   if(newSize < need)
+      newSize = need;
+   grown = realloc(*buf, newSize);
+   if(grown == NULL)
+      return FALSE;
+   *buf = grown;
+   *size = newSize;
+   return TRUE;
+}
+
+/*
+   Like DT_listFrom, but for the directory of a snapshot whose path is
+   list's and whose children n's stand for, adding the paths to list's
+   listing. This expands no copies, so it changes nothing.
+*/
+static boolean DT_listSnapFrom(Node_T n, size_t offset,
+                               size_t* remaining,
+                               struct DT_SnapList* list) {
+   Node_ChildIter iter;
+   Node_T c;
+   size_t len;
+
+   assert(n != NULL);
+   assert(remaining != NULL);
+   assert(list != NULL);
+
+   if(*remaining == 0)
+      return TRUE;
+
+   len = list->pathLen;
+   if(offset == 0) {
+      if(!DT_reserve(&list->out, &list->outSize,
+                     list->outLen + len + 2))
+         return FALSE;
+      memcpy(list->out + list->outLen, list->path, len);
+      list->outLen += len;
+      list->out[list->outLen++] = '\n';
+      (*remaining)--;
+      if(*remaining == 0)
+         return TRUE;
+   }
+
+   n = DT_childrenOf(n);
+   if(offset == 0)
+      c = Node_firstChild(n, &iter);
+   else {
+      offset--;
+      c = Node_seekChild(n, &offset, &iter);
+   }
+
+   for( ; c != NULL && *remaining > 0; c = Node_nextChild(n, &iter)) {
+      if(!DT_reserve(&list->path, &list->pathSize,
+                     len + 1 + Node_getNameLength(c)))
+         return FALSE;
+      list->path[len] = '/';
+      memcpy(list->path + len + 1, Node_getName(c),
+             Node_getNameLength(c));
+      list->pathLen = len + 1 + Node_getNameLength(c);
+      if(!DT_listSnapFrom(c, offset, remaining, list))
+         return FALSE;
+      offset = 0;
+   }
+   list->pathLen = len;
+   return TRUE;
+}
+
+/* see dt.h for specification */
+char* DT_listIn(DT_Snap_T snap, const char* path, size_t offset,
+                size_t limit, size_t* total) {
+   struct DT_SnapList list;
+   Node_T curr;
+   size_t len;
+   size_t index;
+   char* result = NULL;
+
+   assert(snap != NULL);
+   assert(path != NULL);
+
+   len = strlen(path);
+   if(snap->image != NULL) {
+      if(!Image_find(snap->image, path, len, &index))
+         return NULL;
+      if(total != NULL)
+         *total = Image_getNode(snap->image, index)->uSize;
+      return Image_list(snap->image, index, offset, limit);
+   }
+   curr = DT_findPathIn(snap, path, len);
+   if(curr == NULL)
+      return NULL;
+
+   if(total != NULL)
+      *total = Node_getSubtreeSize(curr);
+
+   list.path = NULL;
+   list.pathLen = len;
+   list.pathSize = 0;
+   list.out = NULL;
+   list.outLen = 0;
+   list.outSize = 0;
+   if(DT_reserve(&list.path, &list.pathSize, len) &&
+      DT_reserve(&list.out, &list.outSize, 1)) {
+      memcpy(list.path, path, len);
+      if(DT_listSnapFrom(curr, offset, &limit, &list)) {
+         list.out[list.outLen] = '\0';
+         result = list.out;
+         list.out = NULL;
+      }
+   }
+
+   free(list.path);
+   free(list.out);
+   return result;
+}
+
+/* see dt.h for specification */
+char* DT_toStringIn(DT_Snap_T snap) {
+   char* result;
+
+   assert(snap != NULL);
+
+   if(snap->image != NULL && Image_getLength(snap->image) > 0)
+      return Image_list(snap->image, 0, 0, Image_getLength(snap->image));
+   if(snap->root == NULL) {
+      result = malloc(1);
+      if(result != NULL)
+         *result = '\0';
+      return result;
+   }
+   return DT_listIn(snap, Node_getPath(snap->root), 0,
+                    Node_getSubtreeSize(snap->root), NULL);
+}
+
+/* see dt.h for specification */
+int DT_begin(void) {
+   DynArray_T log = changes;
+
+   assert(DT_IS_VALID());
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+
+   if(log == NULL) {
+      changes = DynArray_new(0);
+      if(changes == NULL)
+         return MEMORY_ERROR;
+   }
+   if(!DT_logChange(DT_BEGUN, NULL)) {
+      if(log == NULL) {
+         DynArray_free(changes);
+         changes = NULL;
+      }
+      return MEMORY_ERROR;
+   }
+   return SUCCESS;
+}
+
+/*
+   Returns the position in the log of the open transaction of the
+   change that began the innermost one.
+*/
+static size_t DT_innermostBegun(void) {
+   struct DT_Change* change;
+   size_t i;
+
+   assert(changes != NULL);
+
+   for(i = DynArray_getLength(changes); i > 0; i--) {
+      change = DynArray_get(changes, i - 1);
+      if(change->kind == DT_BEGUN)
+         return i - 1;
+   }
+   assert(FALSE);
+   return 0;
+}
+
+/* see dt.h for specification */
+int DT_commit(void) {
+   size_t begun;
+
+   if(!isInitialized || changes == NULL)
+      return INITIALIZATION_ERROR;
+
+   /* a nested transaction's changes become the enclosing one's, to
+      be undone with it */
+   begun = DT_innermostBegun();
+   DT_discardChange(DynArray_removeAt(changes, begun));
+   if(begun == 0) {
+      DT_freeChanges();
+      if(journal != NULL)
+         (void) Journal_syncIfDue(journal);
+   }
+
+   assert(DT_IS_VALID());
+   return SUCCESS;
+}
+
+/*
+   Undoes change, the latest in the log of the open transaction that
+   has not been undone. Returns SUCCESS, or MEMORY_ERROR, leaving
+   everything as it was, if there is an allocation error.
+*/
+static int DT_undo(struct DT_Change* change) {
+   assert(change != NULL);
+   assert(change->kind != DT_BEGUN);
+
+   if(change->kind == DT_LINKED)
+      return DT_unlinkNode(change->node, FALSE);
+   else if(change->kind == DT_UNLINKED)
+      return DT_relinkNode(change->node, change->parent);
+   else
+      return DT_moveNode(change->node, change->parent, change->name,
+                         change->nameLen);
+}
+
+/* see dt.h for specification */
+int DT_abort(void) {
+   struct DT_Change* change;
+   size_t begun;
+   size_t i;
+
+   if(!isInitialized || changes == NULL)
+      return INITIALIZATION_ERROR;
+
+   begun = DT_innermostBegun();
+   for(i = DynArray_getLength(changes) - 1; i > begun; i--) {
+      change = DynArray_get(changes, i);
+      if(DT_undo(change) != SUCCESS)
+         return MEMORY_ERROR;
+      /* a hierarchy that has been linked back in is the tree's */
+      (void) DynArray_removeAt(changes, i);
+      DT_discardChange(change);
+   }
+   /* the changes undone never happened, as far as the journal goes */
+   change = DynArray_removeAt(changes, begun);
+   if(journal != NULL)
+      Journal_rollback(journal, change->mark);
+   DT_discardChange(change);
+   if(begun == 0) {
+      DynArray_free(changes);
+      changes = NULL;
+   }
+
+   assert(DT_IS_VALID());
+   return SUCCESS;
+}
+
+/*
+   Adds to writer the directory whose children n's stand for, with the
+   parent at index parent, and then its descendants, in pre-order.
+   Returns FALSE if there is an allocation error, and TRUE otherwise.
+*/
+static boolean DT_saveFrom(ImageWriter_T writer, Node_T n,
+                           size_t parent) {
+   Node_ChildIter iter;
+   Node_T kids;
+   Node_T c;
+   size_t index;
+
+   assert(writer != NULL);
+   assert(n != NULL);
+
+   /* a copy is saved as what it stands for, without being expanded */
+   kids = DT_childrenOf(n);
+   if(!ImageWriter_add(writer, parent, Node_getName(n),
+                       Node_getNameLength(n), Node_getNumChildren(kids),
+                       &index))
+      return FALSE;
+   for(c = Node_firstChild(kids, &iter); c != NULL;
+       c = Node_nextChild(kids, &iter))
+      if(!DT_saveFrom(writer, c, index))
+         return FALSE;
+   return TRUE;
+}
+
+/* see dt.h for specification */
+int DT_save(int fd) {
+   ImageWriter_T writer;
+   int result = SUCCESS;
+
+   assert(DT_IS_VALID());
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+
+   writer = ImageWriter_new(count);
+   if(writer == NULL)
+      return MEMORY_ERROR;
+   /* the stamp tells DT_initWithOptions which records of the journal
+      the image already holds */
+   if(journal != NULL)
+      ImageWriter_setStamp(writer, Journal_getSequence(journal));
+   if(root != NULL && !DT_saveFrom(writer, root, 0))
+      result = MEMORY_ERROR;
+   else if(!ImageWriter_write(writer, fd))
+      result = IO_ERROR;
+   ImageWriter_free(writer);
+
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/* see dt.h for specification */
+int DT_load(int fd) {
+   Image_T image;
+   int result;
+
+   assert(DT_IS_VALID());
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+   /* a load is no change that the journal could replay */
+   if(root != NULL || journal != NULL)
+      return CONFLICTING_PATH;
+
+   result = DT_readImage(fd, &image);
+   if(result != SUCCESS)
+      return result;
+   result = DT_loadImage(image);
+   Image_free(image);
+
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/* see dt.h for specification */
+int DT_loadSnapshot(int fd, DT_Snap_T* snap) {
+   struct DT_Snap* new;
+   int result;
+
+   assert(snap != NULL);
+
+   new = malloc(sizeof(struct DT_Snap));
+   if(new == NULL)
+      return MEMORY_ERROR;
+   result = DT_readImage(fd, &new->image);
+   if(result != SUCCESS) {
+      free(new);
+      return result;
+   }
+   new->root = NULL;
+   new->refs = 1;
+   new->set = NULL;
+
+   *snap = new;
+   return SUCCESS;
+}
+
+/* see dt.h for specification */
+int DT_sync(void) {
+   struct DT_Change* begun;
+   size_t end;
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+   if(journal == NULL)
+      return SUCCESS;
+
+   /* the changes of open transactions may yet be undone */
+   end = Journal_getEnd(journal);
+   if(changes != NULL) {
+      begun = DynArray_get(changes, 0);
+      end = begun->mark;
+   }
+   if(!Journal_sync(journal, end))
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/* see dt.h for specification */
+int DT_checkpoint(int fd) {
+   int result;
+
+   assert(DT_IS_VALID());
+
+   if(!isInitialized || journal == NULL)
+      return INITIALIZATION_ERROR;
+   if(changes != NULL)
+      return CONFLICTING_PATH;
+
+   if(!Journal_sync(journal, Journal_getEnd(journal)))
+      return IO_ERROR;
+   result = DT_save(fd);
+   if(result == SUCCESS && fsync(fd) != 0)
+      result = IO_ERROR;
+   if(result == SUCCESS) {
+      checkpointed = TRUE;
+      checkpointSequence = Journal_getSequence(journal);
+   }
+
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/* see dt.h for specification */
+int DT_compact(void) {
+   if(!isInitialized || journal == NULL)
+      return INITIALIZATION_ERROR;
+   if(changes != NULL || !checkpointed ||
+      Journal_getSequence(journal) != checkpointSequence)
+      return CONFLICTING_PATH;
+
+   if(!Journal_truncate(journal))
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*
+   Adds the directory whose path is the len characters at line, the
+   next line of a listing in the order of DT_toString, to the
+   hierarchy being built, whose root is *built, or NULL before the
+   first line. stack holds the directories from the root to the one
+   of the line before, and is left holding those to the new one: the
+   new directory's parent must be on it, and the directories after
+   the parent, whose hierarchies the listing has left, come off it,
+   the first of them being the new directory's previous sibling. So
+   no line costs a lookup from the root.
+
+   Returns SUCCESS, otherwise:
+   CONFLICTING_PATH if the line is not under the root,
+   PARENT_CHILD_ERROR if it is not where DT_toString would put it,
+   ALREADY_IN_TREE if it is the line of a directory already added,
+   MEMORY_ERROR if there is an allocation error.
+*/
+static int DT_addLine(DynArray_T stack, const char* line, size_t len,
+                      Node_T* built) {
+   Node_T parent = NULL;
+   Node_T prev = NULL;
+   Node_T new;
+   const char* name;
+   size_t nameLen;
+   size_t parentLen = 0;
+   int order;
+
+   assert(stack != NULL);
+   assert(line != NULL);
+   assert(built != NULL);
+
+   while(DynArray_getLength(stack) > 0) {
+      parent = DynArray_get(stack, DynArray_getLength(stack) - 1);
+      parentLen = Node_getPathLength(parent);
+      if(len > parentLen && line[parentLen] == '/' &&
+         memcmp(line, Node_getPath(parent), parentLen) == 0)
+         break;
+      prev = DynArray_removeAt(stack, DynArray_getLength(stack) - 1);
+      parent = NULL;
+   }
+
+   if(parent == NULL) {
+      if(*built != NULL)
+         return CONFLICTING_PATH;
+      name = line;
+      nameLen = len;
+   }
+   else {
+      name = line + parentLen + 1;
+      nameLen = len - parentLen - 1;
+      if(prev != NULL) {
+         order = Path_compare(Node_getName(prev),
+                              Node_getNameLength(prev), name, nameLen);
+         if(order == 0)
+            return ALREADY_IN_TREE;
+         if(order > 0)
+            return PARENT_CHILD_ERROR;
+      }
+   }
+   if(nameLen == 0 || Path_findSeparator(name, nameLen) != NULL)
+      return PARENT_CHILD_ERROR;
+
+   new = Node_createN(name, nameLen, parent);
+   if(new == NULL)
+      return MEMORY_ERROR;
+   if(parent == NULL)
+      *built = new;
+   else if(Node_linkChild(parent, new) != SUCCESS) {
+      (void) Node_destroy(new);
+      return MEMORY_ERROR;
+   }
+   if(!DynArray_add(stack, new))
+      return MEMORY_ERROR;
+   return SUCCESS;
+}
+
+/* see dt.h for specification */
+int DT_fromString(const char* dump) {
+   assert(dump != NULL);
+
+   return DT_fromStringN(dump, strlen(dump));
+}
+
+/* see dt.h for specification */
+int DT_fromStringN(const char* dump, size_t len) {
+   DynArray_T stack;
+   Node_T built = NULL;
+   const char* end;
+   size_t offset;
+   size_t lineLen;
+   int result = SUCCESS;
+
+   assert(DT_IS_VALID());
+   assert(dump != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+   if(root != NULL || journal != NULL)
+      return CONFLICTING_PATH;
+
+   stack = DynArray_new(0);
+   if(stack == NULL)
+      return MEMORY_ERROR;
+   for(offset = 0; offset < len && result == SUCCESS;
+       offset += lineLen + 1) {
+      end = memchr(dump + offset, '\n', len - offset);
+      lineLen = end == NULL ? len - offset : (size_t) (end - dump) - offset;
+      result = DT_addLine(stack, dump + offset, lineLen, &built);
+   }
+   DynArray_free(stack);
+
+   if(result != SUCCESS) {
+      if(built != NULL)
+         (void) Node_destroy(built);
+   }
+   else if(built != NULL)
+      result = DT_adoptHierarchy(built);
+
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/*
+   Returns a new node for directory index of scan, with parent as its
+   parent but not yet linked to it, with the hierarchy below the
+   directory, or NULL if there is an allocation error.
+*/
+static Node_T DT_buildScan(DirScan_T scan, size_t index, Node_T parent) {
+   Node_T n;
+   Node_T child;
+   const char* name;
+   size_t nameLen;
+   size_t i;
+
+   assert(scan != NULL);
+
+   name = DirScan_getName(scan, index, &nameLen);
+   n = Node_createN(name, nameLen, parent);
+   if(n == NULL)
+      return NULL;
+   for(i = 0; i < DirScan_getChildren(scan, index); i++) {
+      child = DT_buildScan(scan, DirScan_getChild(scan, index, i), n);
+      if(child == NULL || DT_linkParentToChild(n, child) != SUCCESS) {
+         (void) Node_destroy(n);
+         return NULL;
+      }
+   }
+   return n;
+}
+
+/*
+   Links the hierarchies below the top directory of scan under top,
+   each as a change of the open transaction, and journals an insert
+   of each of their leaves relative to top. Returns SUCCESS, or
+   MEMORY_ERROR if there is an allocation error, leaving the
+   hierarchies linked so far for the transaction to undo.
+*/
+static int DT_importScan(DirScan_T scan, Node_T top) {
+   Node_T child;
+   const char* rel;
+   size_t relLen;
+   size_t i;
+
+   assert(scan != NULL);
+   assert(top != NULL);
+
+   if(Node_unshare(top) != SUCCESS)
+      return MEMORY_ERROR;
+   for(i = 0; i < DirScan_getChildren(scan, 0); i++) {
+      child = DT_buildScan(scan, DirScan_getChild(scan, 0, i), top);
+      if(child == NULL || DT_linkParentToChild(top, child) != SUCCESS)
+         return MEMORY_ERROR;
+      count += Node_getSubtreeSize(child);
+      if(filter != NULL)
+         DT_filterHierarchy(child, TRUE);
+      if((nameIndex != NULL && !DT_namesAddHierarchy(child)) ||
+         !DT_logChange(DT_LINKED, child)) {
+         DT_indexRemove(child);
+         (void) Node_unlinkChild(top, child);
+         count -= Node_destroy(child);
+         return MEMORY_ERROR;
+      }
+   }
+
+   if(journal == NULL)
+      return SUCCESS;
+   for(i = 1; i < DirScan_getLength(scan); i++) {
+      if(DirScan_getChildren(scan, i) > 0)
+         continue;
+      rel = DirScan_getPath(scan, i, &relLen);
+      if(!DT_journal(DT_RECORD_INSERT, Node_getPath(top),
+                     Node_getPathLength(top), rel, relLen))
+         return MEMORY_ERROR;
+   }
+   return SUCCESS;
+}
+
+/* see dt.h for specification */
+int DT_importDir(const char* fsPath, const char* path, size_t threads,
+                 struct DT_ImportStats* stats) {
+   DirScan_T scan;
+   enum DirScan_Status status;
+   Node_T top;
+   size_t len;
+   int result;
+
+   assert(DT_IS_VALID());
+   assert(fsPath != NULL);
+   assert(path != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+
+   /* the disk is read before the tree is touched, so that the
+      threads share nothing of it */
+   scan = DirScan_read(fsPath, threads, &status);
+   if(scan == NULL)
+      return status == DIRSCAN_MEMORY ? MEMORY_ERROR : IO_ERROR;
+
+   /* within a transaction of its own, the whole import, the insert
+      of path and its journal records included, is undone at once if
+      any of it fails */
+   result = DT_begin();
+   if(result == SUCCESS) {
+      len = strlen(path);
+      result = DT_insertPathN(path, len);
+      if(result == SUCCESS) {
+         top = DT_findPath(path, len);
+         result = top == NULL ? MEMORY_ERROR : DT_importScan(scan, top);
+      }
+      if(result == SUCCESS)
+         (void) DT_commit();
+      else
+         (void) DT_abort();
+   }
+
+   if(result == SUCCESS && stats != NULL) {
+      stats->numDirs = DirScan_getLength(scan);
+      stats->numSkipped = DirScan_getSkipped(scan);
+   }
+   DirScan_free(scan);
+   assert(DT_IS_VALID());
+   return result;
+}
+
+/*
+   Adds to make the children of the directory whose children n's
+   stand for, below the directory at index parent, and then their
+   descendants, in pre-order. Returns FALSE if there is an allocation
+   error, and TRUE otherwise.
+*/
+static boolean DT_exportFrom(DirMake_T make, Node_T n, size_t parent) {
+   Node_ChildIter iter;
+   Node_T kids;
+   Node_T c;
+   size_t index;
+
+   assert(make != NULL);
+   assert(n != NULL);
+
+   kids = DT_childrenOf(n);
+   for(c = Node_firstChild(kids, &iter); c != NULL;
+       c = Node_nextChild(kids, &iter)) {
+      if(!DirMake_add(make, parent, Node_getName(c),
+                      Node_getNameLength(c), &index) ||
+         !DT_exportFrom(make, c, index))
+         return FALSE;
+   }
+   return TRUE;
+}
+
+/* see dt.h for specification */
+int DT_exportDir(const char* path, const char* fsPath, size_t threads,
+                 void (*failed)(const char* fsPath, int error,
+                                void* extra),
+                 void* extra, struct DT_ExportStats* stats) {
+   DirMake_T make;
+   Node_T curr;
+   const char* failedPath;
+   int error;
+   size_t i;
+   int result = SUCCESS;
+
+   assert(DT_IS_VALID());
+   assert(path != NULL);
+   assert(fsPath != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+
+   /* the paths are gathered before the threads start, so that they
+      share nothing of the tree, and copies are not expanded */
+   curr = DT_findPath(path, strlen(path));
+   if(curr == NULL)
+      return NO_SUCH_PATH;
+   make = DirMake_new(fsPath);
+   if(make == NULL)
+      return MEMORY_ERROR;
+   if(!DT_exportFrom(make, curr, 0) || !DirMake_run(make, threads)) {
+      DirMake_free(make);
+      return MEMORY_ERROR;
+   }
+
+   for(i = 0; i < DirMake_getFailures(make); i++) {
+      failedPath = DirMake_getFailure(make, i, &error);
+      if(failed != NULL)
+         failed(failedPath, error, extra);
+      result = IO_ERROR;
+   }
+   if(stats != NULL) {
+      stats->numDirs = DirMake_getMade(make);
+      stats->numFailed = DirMake_getFailures(make);
+   }
+   DirMake_free(make);
+   assert(DT_IS_VALID());
    return result;
 }
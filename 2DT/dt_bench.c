@@ -0,0 +1,718 @@
+/*--------------------------------------------------------------------*/
+/* dt_bench.c                                                         */
+/*--------------------------------------------------------------------*/
+
+/* Times dtGood on large trees and reports the figures to stdout.
+   Build it with assertions off (see the Makefile), since checking
+   the whole tree after every operation would swamp the timings. */
+
+/* for fileno and clock_gettime, to time images and journals in
+   temporary files, and mkdir, to time imports of a directory */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "dt.h"
+
+/* The number of top-level directories, and of children of each */
+enum { BENCH_DIRS = 100, BENCH_FILES = 1000 };
+
+/* Inserts r/DD/FFFF for every DD < BENCH_DIRS and FFFF < BENCH_FILES,
+   so that the tree holds BENCH_DIRS * (BENCH_FILES + 1) + 1
+   directories. */
+static void buildTree(void) {
+  char buf[32];
+  size_t d;
+  size_t f;
+
+  for(d = 0; d < BENCH_DIRS; d++)
+    for(f = 0; f < BENCH_FILES; f++) {
+      sprintf(buf, "r/%02lu/%04lu", (unsigned long) d, (unsigned long) f);
+      if(DT_insertPath(buf) != SUCCESS) {
+        fprintf(stderr, "insert of %s failed\n", buf);
+        exit(EXIT_FAILURE);
+      }
+    }
+}
+
+/* Looks up one path absent from the tree built by buildTree for each
+   of its leaves, and returns the number of seconds taken. */
+static double lookUpAbsent(void) {
+  char buf[32];
+  size_t d;
+  size_t f;
+  clock_t start;
+
+  start = clock();
+  for(d = 0; d < BENCH_DIRS; d++)
+    for(f = 0; f < BENCH_FILES; f++) {
+      sprintf(buf, "r/%02lu/%04lux", (unsigned long) d,
+              (unsigned long) f);
+      if(DT_containsPath(buf)) {
+        fprintf(stderr, "%s should be absent\n", buf);
+        exit(EXIT_FAILURE);
+      }
+    }
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* Reports, for filters of several sizes, how many absent paths get
+   past the path filter, and how long looking them up takes. */
+static void benchFilter(void) {
+  static const size_t perDir[] = { 0, 4, 8, 16 };
+  struct DT_Options options;
+  struct DT_FilterStats stats;
+  size_t dirs = BENCH_DIRS * (BENCH_FILES + 1) + 1;
+  size_t i;
+  double seconds;
+
+  printf("path filter: %lu directories, %lu absent lookups\n",
+         (unsigned long) dirs,
+         (unsigned long) (BENCH_DIRS * BENCH_FILES));
+  printf("%12s %12s %10s\n", "counters/dir", "false pos.", "seconds");
+  for(i = 0; i < sizeof(perDir) / sizeof(perDir[0]); i++) {
+    DT_defaultOptions(&options);
+    options.filterCounters = perDir[i] * dirs;
+    if(DT_initWithOptions(&options) != SUCCESS) {
+      fprintf(stderr, "init failed\n");
+      exit(EXIT_FAILURE);
+    }
+    buildTree();
+    seconds = lookUpAbsent();
+    DT_getFilterStats(&stats);
+    if(perDir[i] == 0)
+      printf("%12s %12s %10.3f\n", "none", "-", seconds);
+    else
+      printf("%12lu %11.3f%% %10.3f\n", (unsigned long) perDir[i],
+             100.0 * stats.falsePositives /
+             (stats.rejected + stats.falsePositives), seconds);
+    (void) DT_destroy();
+  }
+}
+
+/* Reports how long answering one batch of queries for every leaf of
+   the tree built by buildTree, and for a sibling of each that is
+   absent, takes with one DT_containsPath call per path and with one
+   DT_containsMany call for the lot. The batch is shuffled, as a
+   client's would be. */
+static void benchContainsMany(void) {
+  enum { BATCH = 2 * BENCH_DIRS * BENCH_FILES };
+  char (*bufs)[16];
+  char** paths;
+  char* tmp;
+  unsigned char* bitmap;
+  unsigned long seed = 12345;
+  size_t i;
+  size_t j;
+  size_t found;
+  clock_t start;
+  double loopSeconds;
+  double batchSeconds;
+
+  bufs = malloc(BATCH * sizeof(*bufs));
+  paths = malloc(BATCH * sizeof(char*));
+  bitmap = malloc((BATCH + CHAR_BIT - 1) / CHAR_BIT);
+  if(bufs == NULL || paths == NULL || bitmap == NULL ||
+     DT_init() != SUCCESS) {
+    fprintf(stderr, "setup failed\n");
+    exit(EXIT_FAILURE);
+  }
+  buildTree();
+
+  for(i = 0; i < BATCH; i++) {
+    sprintf(bufs[i], "r/%02lu/%04lu%s",
+            (unsigned long) (i / 2 / BENCH_FILES),
+            (unsigned long) (i / 2 % BENCH_FILES), i % 2 ? "x" : "");
+    paths[i] = bufs[i];
+  }
+  for(i = BATCH - 1; i > 0; i--) {
+    seed = seed * 1103515245UL + 12345UL;
+    j = (size_t) ((seed >> 8) % (i + 1));
+    tmp = paths[i];
+    paths[i] = paths[j];
+    paths[j] = tmp;
+  }
+
+  found = 0;
+  start = clock();
+  for(i = 0; i < BATCH; i++)
+    if(DT_containsPath(paths[i]))
+      found++;
+  loopSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+  if(found != BATCH / 2) {
+    fprintf(stderr, "per-call loop found %lu\n", (unsigned long) found);
+    exit(EXIT_FAILURE);
+  }
+
+  start = clock();
+  if(DT_containsMany(paths, BATCH, bitmap) != SUCCESS) {
+    fprintf(stderr, "DT_containsMany failed\n");
+    exit(EXIT_FAILURE);
+  }
+  batchSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+  for(i = 0; i < BATCH; i++)
+    if(((bitmap[i / CHAR_BIT] >> (i % CHAR_BIT)) & 1) !=
+       (strchr(paths[i], 'x') == NULL)) {
+      fprintf(stderr, "DT_containsMany is wrong about %s\n", paths[i]);
+      exit(EXIT_FAILURE);
+    }
+
+  printf("batched queries: %lu paths, half of them present\n",
+         (unsigned long) BATCH);
+  printf("%12s %10.3f\n", "per call", loopSeconds);
+  printf("%12s %10.3f\n", "batched", batchSeconds);
+
+  (void) DT_destroy();
+  free(bitmap);
+  free(paths);
+  free(bufs);
+}
+
+/* Reports how long moving each top-level directory of the tree built
+   by buildTree, with its BENCH_FILES children, to a new parent takes
+   with DT_move, and with what a client had to do before it: insert
+   the hierarchy's paths under another new parent and then remove
+   the old one. */
+static void benchMove(void) {
+  char src[32];
+  char dst[32];
+  char* listing;
+  char* line;
+  char* end;
+  size_t d;
+  clock_t start;
+  double moveSeconds;
+  double copySeconds;
+
+  if(DT_init() != SUCCESS) {
+    fprintf(stderr, "init failed\n");
+    exit(EXIT_FAILURE);
+  }
+  buildTree();
+  if(DT_insertPath("r/s") != SUCCESS || DT_insertPath("r/t") != SUCCESS) {
+    fprintf(stderr, "insert of r/s or r/t failed\n");
+    exit(EXIT_FAILURE);
+  }
+
+  start = clock();
+  for(d = 0; d < BENCH_DIRS; d++) {
+    sprintf(src, "r/%02lu", (unsigned long) d);
+    sprintf(dst, "r/s/%02lu", (unsigned long) d);
+    if(DT_move(src, dst) != SUCCESS) {
+      fprintf(stderr, "move of %s failed\n", src);
+      exit(EXIT_FAILURE);
+    }
+  }
+  moveSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for(d = 0; d < BENCH_DIRS; d++) {
+    sprintf(src, "r/s/%02lu", (unsigned long) d);
+    listing = DT_list(src, 0, BENCH_FILES + 1, NULL);
+    if(listing == NULL) {
+      fprintf(stderr, "listing of %s failed\n", src);
+      exit(EXIT_FAILURE);
+    }
+    for(line = listing; *line != '\0'; line = end + 1) {
+      end = strchr(line, '\n');
+      *end = '\0';
+      line[2] = 't';
+      if(DT_insertPath(line) != SUCCESS) {
+        fprintf(stderr, "insert of %s failed\n", line);
+        exit(EXIT_FAILURE);
+      }
+    }
+    free(listing);
+    if(DT_rmPath(src) != SUCCESS) {
+      fprintf(stderr, "removal of %s failed\n", src);
+      exit(EXIT_FAILURE);
+    }
+  }
+  copySeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  printf("moves: %lu hierarchies of %lu directories\n",
+         (unsigned long) BENCH_DIRS, (unsigned long) (BENCH_FILES + 1));
+  printf("%12s %10.3f\n", "DT_move", moveSeconds);
+  printf("%12s %10.3f\n", "copy, rm", copySeconds);
+
+  (void) DT_destroy();
+}
+
+/* Reports how long copying each top-level directory of the tree built
+   by buildTree, with its BENCH_FILES children, to a new parent takes
+   with DT_clone, then how long the first change within each copy
+   takes, and how long the copies take when a client inserts the
+   hierarchy's paths one at a time instead. */
+static void benchClone(void) {
+  char src[32];
+  char dst[32];
+  char* listing;
+  char* line;
+  char* end;
+  size_t d;
+  clock_t start;
+  double cloneSeconds;
+  double changeSeconds;
+  double copySeconds;
+
+  if(DT_init() != SUCCESS) {
+    fprintf(stderr, "init failed\n");
+    exit(EXIT_FAILURE);
+  }
+  buildTree();
+  if(DT_insertPath("r/s") != SUCCESS || DT_insertPath("r/t") != SUCCESS) {
+    fprintf(stderr, "insert of r/s or r/t failed\n");
+    exit(EXIT_FAILURE);
+  }
+
+  start = clock();
+  for(d = 0; d < BENCH_DIRS; d++) {
+    sprintf(src, "r/%02lu", (unsigned long) d);
+    sprintf(dst, "r/s/%02lu", (unsigned long) d);
+    if(DT_clone(src, dst) != SUCCESS) {
+      fprintf(stderr, "clone of %s failed\n", src);
+      exit(EXIT_FAILURE);
+    }
+  }
+  cloneSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for(d = 0; d < BENCH_DIRS; d++) {
+    sprintf(dst, "r/s/%02lu/0000/x", (unsigned long) d);
+    if(DT_insertPath(dst) != SUCCESS) {
+      fprintf(stderr, "insert of %s failed\n", dst);
+      exit(EXIT_FAILURE);
+    }
+  }
+  changeSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for(d = 0; d < BENCH_DIRS; d++) {
+    sprintf(src, "r/%02lu", (unsigned long) d);
+    listing = DT_list(src, 0, BENCH_FILES + 1, NULL);
+    if(listing == NULL) {
+      fprintf(stderr, "listing of %s failed\n", src);
+      exit(EXIT_FAILURE);
+    }
+    for(line = listing; *line != '\0'; line = end + 1) {
+      end = strchr(line, '\n');
+      *end = '\0';
+      sprintf(dst, "r/t/%s", line + 2);
+      if(DT_insertPath(dst) != SUCCESS) {
+        fprintf(stderr, "insert of %s failed\n", dst);
+        exit(EXIT_FAILURE);
+      }
+    }
+    free(listing);
+  }
+  copySeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  printf("copies: %lu hierarchies of %lu directories\n",
+         (unsigned long) BENCH_DIRS, (unsigned long) (BENCH_FILES + 1));
+  printf("%12s %10.3f\n", "DT_clone", cloneSeconds);
+  printf("%12s %10.3f\n", "1st change", changeSeconds);
+  printf("%12s %10.3f\n", "insert each", copySeconds);
+
+  (void) DT_destroy();
+}
+
+/* Reports how long a snapshot of the tree built by buildTree takes
+   to take, how long writers then take to add a directory below each
+   top-level one, and how long listing the snapshot takes, against
+   listing the tree itself, as a reader had to before, with writers
+   held off all the while. */
+static void benchSnapshot(void) {
+  char buf[32];
+  DT_Snap_T snap;
+  char* listing;
+  size_t d;
+  clock_t start;
+  double snapSeconds;
+  double writeSeconds;
+  double listSeconds;
+  double toStringSeconds;
+
+  if(DT_init() != SUCCESS) {
+    fprintf(stderr, "init failed\n");
+    exit(EXIT_FAILURE);
+  }
+  buildTree();
+
+  start = clock();
+  if(DT_snapshot(&snap) != SUCCESS) {
+    fprintf(stderr, "snapshot failed\n");
+    exit(EXIT_FAILURE);
+  }
+  snapSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for(d = 0; d < BENCH_DIRS; d++) {
+    sprintf(buf, "r/%02lu/new", (unsigned long) d);
+    if(DT_insertPath(buf) != SUCCESS) {
+      fprintf(stderr, "insert of %s failed\n", buf);
+      exit(EXIT_FAILURE);
+    }
+  }
+  writeSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  listing = DT_toStringIn(snap);
+  listSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+  if(listing == NULL) {
+    fprintf(stderr, "listing of the snapshot failed\n");
+    exit(EXIT_FAILURE);
+  }
+  free(listing);
+
+  start = clock();
+  listing = DT_toString();
+  toStringSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+  if(listing == NULL) {
+    fprintf(stderr, "listing of the tree failed\n");
+    exit(EXIT_FAILURE);
+  }
+  free(listing);
+
+  printf("snapshot: %lu directories, then %lu writes\n",
+         (unsigned long) (BENCH_DIRS * (BENCH_FILES + 1) + 1),
+         (unsigned long) BENCH_DIRS);
+  printf("%12s %10.3f\n", "DT_snapshot", snapSeconds);
+  printf("%12s %10.3f\n", "writes", writeSeconds);
+  printf("%12s %10.3f\n", "list snap", listSeconds);
+  printf("%12s %10.3f\n", "DT_toString", toStringSeconds);
+
+  DT_releaseSnapshot(snap);
+  (void) DT_destroy();
+}
+
+/* Reports how long building the tree by inserting every path takes,
+   against saving it as an image, loading the image back into the
+   tree, and loading it as a snapshot that serves queries from the
+   image in place. */
+static void benchImage(void) {
+  DT_Snap_T snap;
+  FILE* file;
+  clock_t start;
+  double insertSeconds;
+  double saveSeconds;
+  double loadSeconds;
+  double snapSeconds;
+  int fd;
+
+  if(DT_init() != SUCCESS) {
+    fprintf(stderr, "init failed\n");
+    exit(EXIT_FAILURE);
+  }
+  start = clock();
+  buildTree();
+  insertSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  file = tmpfile();
+  if(file == NULL) {
+    fprintf(stderr, "no temporary file\n");
+    exit(EXIT_FAILURE);
+  }
+  fd = fileno(file);
+  start = clock();
+  if(DT_save(fd) != SUCCESS) {
+    fprintf(stderr, "save failed\n");
+    exit(EXIT_FAILURE);
+  }
+  saveSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+  (void) DT_destroy();
+
+  if(DT_init() != SUCCESS || lseek(fd, 0, SEEK_SET) != 0) {
+    fprintf(stderr, "init failed\n");
+    exit(EXIT_FAILURE);
+  }
+  start = clock();
+  if(DT_load(fd) != SUCCESS) {
+    fprintf(stderr, "load failed\n");
+    exit(EXIT_FAILURE);
+  }
+  loadSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+  (void) DT_destroy();
+
+  if(lseek(fd, 0, SEEK_SET) != 0) {
+    fprintf(stderr, "seek failed\n");
+    exit(EXIT_FAILURE);
+  }
+  start = clock();
+  if(DT_loadSnapshot(fd, &snap) != SUCCESS ||
+     !DT_containsIn(snap, "r/42/0042")) {
+    fprintf(stderr, "load of the snapshot failed\n");
+    exit(EXIT_FAILURE);
+  }
+  snapSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+  DT_releaseSnapshot(snap);
+  fclose(file);
+
+  printf("image: %lu directories\n",
+         (unsigned long) (BENCH_DIRS * (BENCH_FILES + 1) + 1));
+  printf("%12s %10.3f\n", "inserts", insertSeconds);
+  printf("%12s %10.3f\n", "DT_save", saveSeconds);
+  printf("%12s %10.3f\n", "DT_load", loadSeconds);
+  printf("%12s %10.3f\n", "load snap", snapSeconds);
+}
+
+/* Reports how long rebuilding the tree from its DT_toString listing
+   takes with DT_fromString, and with an insert of each line. */
+static void benchFromString(void) {
+  char* dump;
+  char* line;
+  char* end;
+  clock_t start;
+  double parseSeconds;
+  double insertSeconds;
+
+  if(DT_init() != SUCCESS) {
+    fprintf(stderr, "init failed\n");
+    exit(EXIT_FAILURE);
+  }
+  buildTree();
+  dump = DT_toString();
+  if(dump == NULL) {
+    fprintf(stderr, "toString failed\n");
+    exit(EXIT_FAILURE);
+  }
+  (void) DT_destroy();
+
+  if(DT_init() != SUCCESS) {
+    fprintf(stderr, "init failed\n");
+    exit(EXIT_FAILURE);
+  }
+  start = clock();
+  if(DT_fromString(dump) != SUCCESS) {
+    fprintf(stderr, "fromString failed\n");
+    exit(EXIT_FAILURE);
+  }
+  parseSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+  (void) DT_destroy();
+
+  if(DT_init() != SUCCESS) {
+    fprintf(stderr, "init failed\n");
+    exit(EXIT_FAILURE);
+  }
+  start = clock();
+  for(line = dump; *line != '\0'; line = end + 1) {
+    end = strchr(line, '\n');
+    if(DT_insertPathN(line, (size_t) (end - line)) != SUCCESS) {
+      fprintf(stderr, "insert failed\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  insertSeconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+  (void) DT_destroy();
+  free(dump);
+
+  printf("fromString: %lu directories\n",
+         (unsigned long) (BENCH_DIRS * (BENCH_FILES + 1) + 1));
+  printf("%12s %10.3f\n", "inserts", insertSeconds);
+  printf("%12s %10.3f\n", "fromString", parseSeconds);
+}
+
+/* Reports how long BENCH_FILES inserts take with no journal, and
+   with a journal synchronized after every change and in groups of
+   several windows. */
+static void benchJournal(void) {
+  static const size_t windows[] = { 0, 1000, 10000 };
+  struct DT_Options options;
+  FILE* file;
+  char buf[32];
+  size_t w;
+  size_t f;
+  clock_t start;
+  struct timespec wallStart;
+  struct timespec wallEnd;
+  double seconds;
+
+  printf("journal: %lu inserts\n", (unsigned long) BENCH_FILES);
+  printf("%12s %10s %10s\n", "window (us)", "cpu", "wall");
+  for(w = 0; w <= sizeof(windows) / sizeof(windows[0]); w++) {
+    DT_defaultOptions(&options);
+    file = NULL;
+    if(w > 0) {
+      file = tmpfile();
+      if(file == NULL) {
+        fprintf(stderr, "no temporary file\n");
+        exit(EXIT_FAILURE);
+      }
+      options.journalFd = fileno(file);
+      options.journalWindow = windows[w - 1];
+    }
+    if(DT_initWithOptions(&options) != SUCCESS) {
+      fprintf(stderr, "init failed\n");
+      exit(EXIT_FAILURE);
+    }
+
+    start = clock();
+    (void) clock_gettime(CLOCK_MONOTONIC, &wallStart);
+    for(f = 0; f < BENCH_FILES; f++) {
+      sprintf(buf, "r/%04lu", (unsigned long) f);
+      if(DT_insertPath(buf) != SUCCESS) {
+        fprintf(stderr, "insert of %s failed\n", buf);
+        exit(EXIT_FAILURE);
+      }
+    }
+    if(DT_sync() != SUCCESS) {
+      fprintf(stderr, "sync failed\n");
+      exit(EXIT_FAILURE);
+    }
+    seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    (void) clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+
+    if(w == 0)
+      printf("%12s", "none");
+    else
+      printf("%12lu", (unsigned long) windows[w - 1]);
+    printf(" %10.3f %10.3f\n", seconds,
+           (double) (wallEnd.tv_sec - wallStart.tv_sec)
+           + (double) (wallEnd.tv_nsec - wallStart.tv_nsec) / 1e9);
+    (void) DT_destroy();
+    if(file != NULL)
+      fclose(file);
+  }
+}
+
+/* Makes, or if make is FALSE removes, the directories top/DD/FF on
+   disk for every DD < BENCH_DIRS and FF < 100. */
+static void makeImportDir(const char* top, boolean make) {
+  char buf[64];
+  size_t d;
+  size_t f;
+
+  if(make && mkdir(top, 0700) != 0) {
+    fprintf(stderr, "mkdir of %s failed\n", top);
+    exit(EXIT_FAILURE);
+  }
+  for(d = 0; d < BENCH_DIRS; d++) {
+    sprintf(buf, "%s/%02lu", top, (unsigned long) d);
+    if(make)
+      (void) mkdir(buf, 0700);
+    for(f = 0; f < 100; f++) {
+      sprintf(buf, "%s/%02lu/%02lu", top, (unsigned long) d,
+              (unsigned long) f);
+      if(make)
+        (void) mkdir(buf, 0700);
+      else
+        (void) rmdir(buf);
+    }
+    sprintf(buf, "%s/%02lu", top, (unsigned long) d);
+    if(!make)
+      (void) rmdir(buf);
+  }
+  if(!make)
+    (void) rmdir(top);
+}
+
+/* Reports how long importing a directory of BENCH_DIRS * 100
+   subdirectories from disk takes with several numbers of threads,
+   once the disk's cache holds it. */
+static void benchImport(void) {
+  static const size_t threads[] = { 1, 2, 4, 8 };
+  struct DT_ImportStats stats;
+  char top[64];
+  size_t t;
+  struct timespec wallStart;
+  struct timespec wallEnd;
+  double seconds;
+
+  sprintf(top, "/tmp/dtBench.%ld", (long) getpid());
+  makeImportDir(top, TRUE);
+  printf("import: %lu directories\n",
+         (unsigned long) (BENCH_DIRS * 101 + 1));
+  printf("%12s %10s %10s\n", "threads", "wall", "dirs/s");
+  /* the first import only warms the cache */
+  for(t = 0; t <= sizeof(threads) / sizeof(threads[0]); t++) {
+    if(DT_init() != SUCCESS) {
+      fprintf(stderr, "init failed\n");
+      exit(EXIT_FAILURE);
+    }
+    (void) clock_gettime(CLOCK_MONOTONIC, &wallStart);
+    if(DT_importDir(top, "r", t == 0 ? 1 : threads[t - 1], &stats)
+       != SUCCESS) {
+      fprintf(stderr, "import failed\n");
+      exit(EXIT_FAILURE);
+    }
+    (void) clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+    (void) DT_destroy();
+    if(t == 0)
+      continue;
+    seconds = (double) (wallEnd.tv_sec - wallStart.tv_sec)
+              + (double) (wallEnd.tv_nsec - wallStart.tv_nsec) / 1e9;
+    printf("%12lu %10.3f %10.0f\n", (unsigned long) threads[t - 1],
+           seconds, (double) stats.numDirs / seconds);
+  }
+  makeImportDir(top, FALSE);
+}
+
+/* Reports how long exporting a hierarchy of BENCH_DIRS * 100
+   directories to disk takes with several numbers of threads. */
+static void benchExport(void) {
+  static const size_t threads[] = { 1, 2, 4, 8 };
+  struct DT_ExportStats stats;
+  char top[64];
+  char buf[32];
+  size_t t;
+  size_t d;
+  size_t f;
+  struct timespec wallStart;
+  struct timespec wallEnd;
+  double seconds;
+
+  if(DT_init() != SUCCESS) {
+    fprintf(stderr, "init failed\n");
+    exit(EXIT_FAILURE);
+  }
+  for(d = 0; d < BENCH_DIRS; d++)
+    for(f = 0; f < 100; f++) {
+      sprintf(buf, "r/%02lu/%02lu", (unsigned long) d, (unsigned long) f);
+      if(DT_insertPath(buf) != SUCCESS) {
+        fprintf(stderr, "insert of %s failed\n", buf);
+        exit(EXIT_FAILURE);
+      }
+    }
+
+  sprintf(top, "/tmp/dtBench.%ld", (long) getpid());
+  printf("export: %lu directories\n",
+         (unsigned long) (BENCH_DIRS * 101 + 1));
+  printf("%12s %10s %10s\n", "threads", "wall", "dirs/s");
+  for(t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+    (void) clock_gettime(CLOCK_MONOTONIC, &wallStart);
+    if(DT_exportDir("r", top, threads[t], NULL, NULL, &stats)
+       != SUCCESS) {
+      fprintf(stderr, "export failed\n");
+      exit(EXIT_FAILURE);
+    }
+    (void) clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+    makeImportDir(top, FALSE);
+    seconds = (double) (wallEnd.tv_sec - wallStart.tv_sec)
+              + (double) (wallEnd.tv_nsec - wallStart.tv_nsec) / 1e9;
+    printf("%12lu %10.3f %10.0f\n", (unsigned long) threads[t],
+           seconds, (double) stats.numDirs / seconds);
+  }
+  (void) DT_destroy();
+}
+
+/* Runs every benchmark. Returns 0. */
+int main(void) {
+  benchFilter();
+  benchContainsMany();
+  benchMove();
+  benchClone();
+  benchSnapshot();
+  benchImage();
+  benchFromString();
+  benchJournal();
+  benchImport();
+  benchExport();
+  return 0;
+}
@@ -15,6 +15,8 @@
    Returns 0. */
 int main(void) {
   char* temp;
+  char buf[32];
+  size_t i;
 
   /* Before the data structure is initialized, insertPath, removePath,
      and destroy operations should return INITIALIZATION_ERROR, and
@@ -47,6 +49,8 @@ int main(void) {
   free(temp);
   assert(DT_insertPath("a/bb/c") == ALREADY_IN_TREE);
   assert(DT_insertPath("d/e/f") == CONFLICTING_PATH);
+  assert(DT_insertPath("ab") == CONFLICTING_PATH);
+  assert(DT_containsPath("ab") == FALSE);
 
   /* After inserting a second child to a node in the hierarchy, trying
      to insert a third child should still succeed, unlike in BDT */
@@ -102,6 +106,27 @@ int main(void) {
   fprintf(stderr, "%s\n", temp);
   free(temp);
 
+  /* a directory with many children is promoted to a hash table,
+     but its children are still found by name and kept in order */
+  for(i = 0; i < 200; i++) {
+    sprintf(buf, "a/w/%03lu", (unsigned long) (i * 7 % 200));
+    assert(DT_insertPath(buf) == SUCCESS);
+  }
+  assert(DT_containsPath("a/w/000") == TRUE);
+  assert(DT_containsPath("a/w/199") == TRUE);
+  assert(DT_containsPath("a/w/200") == FALSE);
+  assert(DT_insertPath("a/w/123") == ALREADY_IN_TREE);
+  assert(DT_rmPath("a/w/100") == SUCCESS);
+  assert(DT_containsPath("a/w/100") == FALSE);
+  assert(DT_insertPath("a/w/042/x") == SUCCESS);
+  assert((temp = DT_toString()) != NULL);
+  assert(strstr(temp, "a/w/041\na/w/042\na/w/042/x\na/w/043\n")
+         != NULL);
+  assert(strstr(temp, "a/w/099\na/w/101\n") != NULL);
+  free(temp);
+  assert(DT_rmPath("a/w") == SUCCESS);
+  assert(DT_containsPath("a/w/000") == FALSE);
+
   assert(DT_destroy() == SUCCESS);
   assert(DT_destroy() == INITIALIZATION_ERROR);
   assert(DT_containsPath("a") == FALSE);
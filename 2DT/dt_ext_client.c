@@ -0,0 +1,1320 @@
+/*--------------------------------------------------------------------*/
+/* dt_ext_client.c                                                    */
+/*--------------------------------------------------------------------*/
+
+/* Tests the parts of the DT interface beyond insert, contains, rm,
+   and toString. Only dtGood implements those, so they are kept out
+   of dt_client.c, which every dtBad* must still link with. */
+
+/* for fileno and ftruncate, to save and load images in temporary
+   files, mkdir and symlink, to import a directory, and nanosleep, to
+   wait for a journal */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "dt.h"
+
+/* Appends name and a newline to the string acc.
+   Used as a DT_listDir callback. */
+static void appendName(const char* name, void* acc) {
+  strcat((char*) acc, name);
+  strcat((char*) acc, "\n");
+}
+
+/* Inserts enough children under a/w for a/w to promote its child
+   index, checks paginated listing, aggregates, and directory
+   listing of it, and removes a/w again. The DT must contain a but
+   not a/w. */
+static void testWideDirectory(void) {
+  char* temp;
+  char* page;
+  char* pages;
+  const char* names[3];
+  struct DT_Stat before;
+  struct DT_Stat stat;
+  char buf[32];
+  size_t i;
+  size_t total;
+
+  assert(DT_stat("a", &before) == SUCCESS);
+
+  for(i = 0; i < 200; i++) {
+    sprintf(buf, "a/w/%03lu", (unsigned long) (i * 7 % 200));
+    assert(DT_insertPath(buf) == SUCCESS);
+  }
+  assert(DT_rmPath("a/w/100") == SUCCESS);
+  assert(DT_insertPath("a/w/042/x") == SUCCESS);
+  assert((temp = DT_toString()) != NULL);
+
+  /* the listing of a/w, page by page, is the part of the whole
+     listing from a/w on */
+  assert((pages = calloc(strlen(temp) + 1, 1)) != NULL);
+  for(i = 0; ; i += 3) {
+    assert((page = DT_list("a/w", i, 3, &total)) != NULL);
+    assert(total == 201);
+    if(*page == '\0') {
+      free(page);
+      break;
+    }
+    strcat(pages, page);
+    free(page);
+  }
+  assert(i == 201);
+  assert(strlen(pages) == strlen("a/w\n") + 199 * strlen("a/w/000\n")
+         + strlen("a/w/042/x\n"));
+  assert(!strncmp(pages, strstr(temp, "a/w\n"), strlen(pages)));
+  assert((page = DT_list("a/w", 44, 2, NULL)) != NULL);
+  assert(!strcmp(page, "a/w/042/x\na/w/043\n"));
+  free(page);
+  assert(DT_list("a/w/100", 0, 1, NULL) == NULL);
+
+  /* the aggregates match the listings */
+  assert(DT_stat("a/w", &stat) == SUCCESS);
+  assert(stat.numDirs == 201 && stat.numChildren == 199);
+  assert(stat.listingBytes == strlen(pages));
+  assert(DT_stat("a/w/042", &stat) == SUCCESS);
+  assert(stat.numDirs == 2 && stat.numChildren == 1);
+  assert(stat.listingBytes == strlen("a/w/042\na/w/042/x\n"));
+  assert(DT_stat("a", &stat) == SUCCESS);
+  assert(stat.listingBytes == strlen(temp));
+  assert(DT_stat("a/w/100", &stat) == NO_SUCH_PATH);
+
+  /* listing a/w itself yields just the names of its children */
+  *pages = '\0';
+  assert(DT_listDir("a/w", appendName, pages) == SUCCESS);
+  assert(strlen(pages) == 199 * strlen("000\n"));
+  assert(!strncmp(pages, "000\n001\n", 8));
+  assert(strstr(pages, "099\n101\n") != NULL);
+  assert(DT_listDirInto("a/w", names, 3, &total) == SUCCESS);
+  assert(total == 199);
+  assert(!strcmp(names[0], "000") && !strcmp(names[2], "002"));
+  assert(DT_listDirInto("a/w/042", names, 3, &total) == SUCCESS);
+  assert(total == 1 && !strcmp(names[0], "x"));
+  assert(DT_listDir("a/w/100", appendName, pages) == NO_SUCH_PATH);
+  free(pages);
+  free(temp);
+
+  assert(DT_rmPath("a/w/042/x") == SUCCESS);
+  assert(DT_stat("a/w", &stat) == SUCCESS);
+  assert(stat.numDirs == 200);
+  assert(stat.listingBytes == strlen("a/w\n") + 199 * strlen("a/w/000\n"));
+  assert(DT_rmPath("a/w") == SUCCESS);
+  assert(DT_stat("a", &stat) == SUCCESS);
+  assert(stat.numDirs == before.numDirs);
+  assert(stat.listingBytes == before.listingBytes);
+}
+
+/* Checks the N variants, which take paths as slices of a larger,
+   constant buffer. The DT must contain a/bb/c but not a/bb/q. */
+static void testSlices(void) {
+  assert(DT_containsPathN("a/bb/c/zz", 6) == TRUE);
+  assert(DT_containsPathN("a/bb/c/zz", 5) == FALSE);
+  assert(DT_containsPathN("a/bb/c/zz", 9) == FALSE);
+  assert(DT_insertPathN("a/bb/q/r", 6) == SUCCESS);
+  assert(DT_containsPath("a/bb/q") == TRUE);
+  assert(DT_containsPath("a/bb/q/r") == FALSE);
+  assert(DT_insertPathN("a/bb/q/r", 6) == ALREADY_IN_TREE);
+  assert(DT_rmPathN("a/bb/q/r", 6) == SUCCESS);
+  assert(DT_rmPathN("a/bb/q/r", 6) == NO_SUCH_PATH);
+}
+
+/* Checks that lookups under one deep directory resume from the
+   lookup cache, and that removing a directory leaves no stale entry
+   behind. The DT must contain a/bb/c but not a/bb/c/d. */
+static void testCache(void) {
+  struct DT_CacheStats before;
+  struct DT_CacheStats after;
+  char buf[32];
+  size_t i;
+
+  DT_getCacheStats(&before);
+  assert(DT_insertPath("a/bb/c/d/e/f") == SUCCESS);
+  for(i = 0; i < 10; i++) {
+    sprintf(buf, "a/bb/c/d/e/f/%lu", (unsigned long) i);
+    assert(DT_insertPath(buf) == SUCCESS);
+    assert(DT_containsPath(buf) == TRUE);
+  }
+  DT_getCacheStats(&after);
+  assert(after.hits - before.hits >= 19);
+
+  assert(DT_rmPath("a/bb/c/d") == SUCCESS);
+  assert(DT_containsPath("a/bb/c/d/e/f/3") == FALSE);
+  assert(DT_containsPath("a/bb/c/d") == FALSE);
+  assert(DT_insertPath("a/bb/c/d/e") == SUCCESS);
+  assert(DT_containsPath("a/bb/c/d/e/f") == FALSE);
+  assert(DT_insertPath("a/bb/c/d/e/f/3") == SUCCESS);
+  assert(DT_rmPath("a/bb/c/d") == SUCCESS);
+  assert(DT_containsPath("a/bb/c") == TRUE);
+}
+
+/* Checks that the path filter, if there is one, answers queries for
+   absent paths on its own, including ones for removed paths. The DT
+   must contain a but not a/f. */
+static void testFilter(boolean filtered) {
+  struct DT_FilterStats before;
+  struct DT_FilterStats after;
+  char buf[32];
+  size_t i;
+
+  assert(DT_insertPath("a/f/g") == SUCCESS);
+  assert(DT_containsPath("a/f/g") == TRUE);
+  assert(DT_rmPath("a/f") == SUCCESS);
+
+  DT_getFilterStats(&before);
+  assert(DT_containsPath("a/f/g") == FALSE);
+  for(i = 0; i < 100; i++) {
+    sprintf(buf, "a/%lu", (unsigned long) i);
+    assert(DT_containsPath(buf) == FALSE);
+  }
+  assert(DT_containsPath("a") == TRUE);
+  DT_getFilterStats(&after);
+
+  if(filtered) {
+    assert(after.rejected - before.rejected >= 95);
+    assert(after.passed - before.passed
+           == after.falsePositives - before.falsePositives + 1);
+  }
+  else
+    assert(after.rejected == 0 && after.passed == 0);
+}
+
+/* Checks that a batch of queries, in no particular order and with
+   repeats, gets the same answers as one query per path. The DT must
+   contain a/bb/c but not a/bb/c/d or a/bc. */
+static void testMany(void) {
+  char* paths[] = { "a/bb/c/d/1", "a/bb", "a/bb/c/d/0", "x/bb",
+                    "a/bb/c", "a/bb/c/d/1", "a/bb/cc", "a", "a/bc",
+                    "a/bb/c/d", "a/bb/c/d/10", "", "a/bb/c/d/0/1" };
+  size_t n = sizeof(paths) / sizeof(paths[0]);
+  unsigned char bitmap[(sizeof(paths) / sizeof(paths[0]) + CHAR_BIT - 1)
+                       / CHAR_BIT];
+  size_t i;
+
+  assert(DT_insertPath("a/bb/c/d/0") == SUCCESS);
+  assert(DT_insertPath("a/bb/c/d/1") == SUCCESS);
+
+  memset(bitmap, 0xff, sizeof(bitmap));
+  assert(DT_containsMany(paths, n, bitmap) == SUCCESS);
+  for(i = 0; i < n; i++)
+    assert(((bitmap[i / CHAR_BIT] >> (i % CHAR_BIT)) & 1)
+           == (unsigned) DT_containsPath(paths[i]));
+  assert(bitmap[0] == 0xb7 && bitmap[1] == 0x02);
+  assert(DT_containsMany(paths, 0, NULL) == SUCCESS);
+
+  assert(DT_rmPath("a/bb/c/d") == SUCCESS);
+}
+
+/* Returns <0, 0, or >0 as path p1 comes before, is, or comes after
+   path p2 in the order of DT_toString: strcmp's, but with '/' ranked
+   below every other character. */
+static int comparePaths(const char* p1, const char* p2) {
+  for( ; *p1 != '\0' && *p1 == *p2; p1++, p2++)
+    ;
+  if(*p1 == *p2)
+    return 0;
+  if(*p1 == '\0')
+    return -1;
+  if(*p2 == '\0')
+    return 1;
+  if(*p1 == '/')
+    return -1;
+  if(*p2 == '/')
+    return 1;
+  return (unsigned char) *p1 < (unsigned char) *p2 ? -1 : 1;
+}
+
+/* Checks that range scans yield the same lines as the whole listing
+   does between their bounds, with bounds in and out of the tree, and
+   among children both few and many. The DT must contain a/bb/c but
+   not a/s. */
+static void testScan(void) {
+  const char* bounds[] = { NULL, "", "a", "a/bb", "a/bb/c", "a/bb/cc",
+                           "a/s", "a/s/b", "a/s/b/", "a/s/b/c",
+                           "a/s/b-c", "a/s/ba", "a/s/w/050",
+                           "a/s/w/05", "a/s/w/050/x", "a/s/w/131",
+                           "a/s/w/198/", "a/t", "b" };
+  size_t n = sizeof(bounds) / sizeof(bounds[0]);
+  char* temp;
+  char* expected;
+  char* actual;
+  char* line;
+  char* end;
+  char buf[32];
+  size_t i;
+  size_t j;
+
+  assert(DT_insertPath("a/s/b/c") == SUCCESS);
+  assert(DT_insertPath("a/s/b-c") == SUCCESS);
+  assert(DT_insertPath("a/s/ba") == SUCCESS);
+  for(i = 0; i < 200; i += 2) {
+    sprintf(buf, "a/s/w/%03lu", (unsigned long) i);
+    assert(DT_insertPath(buf) == SUCCESS);
+  }
+
+  assert((temp = DT_toString()) != NULL);
+  assert((expected = malloc(strlen(temp) + 1)) != NULL);
+  assert((actual = malloc(strlen(temp) + 1)) != NULL);
+  for(i = 0; i < n; i++)
+    for(j = 0; j < n; j++) {
+      *expected = '\0';
+      for(line = temp; *line != '\0'; line = end + 1) {
+        end = strchr(line, '\n');
+        *end = '\0';
+        if((bounds[i] == NULL || comparePaths(line, bounds[i]) >= 0) &&
+           (bounds[j] == NULL || comparePaths(line, bounds[j]) < 0))
+          appendName(line, expected);
+        *end = '\n';
+      }
+      *actual = '\0';
+      assert(DT_scanRange(bounds[i], bounds[j], appendName, actual)
+             == SUCCESS);
+      assert(!strcmp(actual, expected));
+    }
+  free(actual);
+  free(expected);
+  free(temp);
+
+  assert(DT_rmPath("a/s") == SUCCESS);
+}
+
+/* Returns a new string of the paths in the tree that match pattern,
+   each followed by a newline. */
+static char* globbed(const char* pattern) {
+  char* result;
+
+  assert((result = calloc(4096, 1)) != NULL);
+  assert(DT_glob(pattern, appendName, result) == SUCCESS);
+  return result;
+}
+
+/* Checks glob patterns with literal, wildcard, and "**" components.
+   The DT must contain a but not a/g. */
+static void testGlob(void) {
+  const char* patterns[] = {
+    "a/g/*/logs/**/*.gz", "a/g/x/logs/**", "**/*.txt",
+    "a/g/**/**/4.gz", "a/g/w/01?", "a/g/w/1*9", "a/g/q*", "b/**",
+    "*", "" };
+  const char* expected[] = {
+    "a/g/x/logs/1.gz\na/g/x/logs/d/2.gz\na/g/y/logs/4.gz\n",
+    "a/g/x/logs\na/g/x/logs/1.gz\na/g/x/logs/d\na/g/x/logs/d/2.gz\n"
+    "a/g/x/logs/d/3.txt\n",
+    "a/g/x/logs/d/3.txt\n",
+    "a/g/y/logs/4.gz\n",
+    "a/g/w/010\na/g/w/011\na/g/w/012\na/g/w/013\na/g/w/014\n"
+    "a/g/w/015\na/g/w/016\na/g/w/017\na/g/w/018\na/g/w/019\n",
+    "a/g/w/109\na/g/w/119\na/g/w/129\na/g/w/139\na/g/w/149\n"
+    "a/g/w/159\na/g/w/169\na/g/w/179\na/g/w/189\na/g/w/199\n",
+    "", "", "a\n", "" };
+  char* result;
+  char buf[32];
+  size_t i;
+
+  assert(DT_insertPath("a/g/x/logs/1.gz") == SUCCESS);
+  assert(DT_insertPath("a/g/x/logs/d/2.gz") == SUCCESS);
+  assert(DT_insertPath("a/g/x/logs/d/3.txt") == SUCCESS);
+  assert(DT_insertPath("a/g/y/logs/4.gz") == SUCCESS);
+  assert(DT_insertPath("a/g/y/other/5.gz") == SUCCESS);
+  assert(DT_insertPath("a/g/z") == SUCCESS);
+  for(i = 0; i < 200; i++) {
+    sprintf(buf, "a/g/w/%03lu", (unsigned long) i);
+    assert(DT_insertPath(buf) == SUCCESS);
+  }
+
+  for(i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+    result = globbed(patterns[i]);
+    assert(!strcmp(result, expected[i]));
+    free(result);
+  }
+
+  assert(DT_rmPath("a/g") == SUCCESS);
+}
+
+/* Returns a new string of the paths of the directories named name,
+   each followed by a newline, and all after one more newline, so that
+   clients can search it for "\n" followed by a line. */
+static char* named(const char* name) {
+  char* result;
+
+  assert((result = calloc(4096, 1)) != NULL);
+  strcpy(result, "\n");
+  assert(DT_findByName(name, appendName, result) == SUCCESS);
+  return result;
+}
+
+/* Checks finding directories by name as the tree changes, whether or
+   not there is an index of names. The DT must contain a but not
+   a/n. */
+static void testNames(void) {
+  char* result;
+  char buf[32];
+  size_t i;
+
+  assert(DT_insertPath("a/n/x/logs") == SUCCESS);
+  assert(DT_insertPath("a/n/y/logs/logs") == SUCCESS);
+  assert(DT_insertPath("a/n/logs") == SUCCESS);
+
+  result = named("logs");
+  assert(strlen(result) == strlen("\na/n/x/logs\na/n/y/logs\n"
+                                  "a/n/y/logs/logs\na/n/logs\n"));
+  assert(strstr(result, "\na/n/x/logs\n") != NULL);
+  assert(strstr(result, "\na/n/y/logs\n") != NULL);
+  assert(strstr(result, "\na/n/y/logs/logs\n") != NULL);
+  assert(strstr(result, "\na/n/logs\n") != NULL);
+  free(result);
+
+  assert(DT_rmPath("a/n/y") == SUCCESS);
+  result = named("logs");
+  assert(strlen(result) == strlen("\na/n/x/logs\na/n/logs\n"));
+  assert(strstr(result, "\na/n/x/logs\n") != NULL);
+  assert(strstr(result, "\na/n/logs\n") != NULL);
+  free(result);
+
+  result = named("a");
+  assert(!strcmp(result, "\na\n"));
+  free(result);
+  result = named("y");
+  assert(!strcmp(result, "\n"));
+  free(result);
+  result = named("n/x");
+  assert(!strcmp(result, "\n"));
+  free(result);
+
+  /* enough directories of one name for the index to promote them */
+  for(i = 0; i < 100; i++) {
+    sprintf(buf, "a/n/%03lu/logs", (unsigned long) i);
+    assert(DT_insertPath(buf) == SUCCESS);
+  }
+  assert(DT_rmPath("a/n/042") == SUCCESS);
+  result = named("logs");
+  assert(strlen(result) == 1 + 99 * strlen("a/n/000/logs\n")
+         + strlen("a/n/x/logs\na/n/logs\n"));
+  assert(strstr(result, "\na/n/042/logs\n") == NULL);
+  assert(strstr(result, "\na/n/043/logs\n") != NULL);
+  free(result);
+
+  assert(DT_rmPath("a/n") == SUCCESS);
+  result = named("logs");
+  assert(!strcmp(result, "\n"));
+  free(result);
+}
+
+/* Checks operations relative to directory handles, and that removing
+   a directory leaves the handles on it stale. The DT must contain
+   a/bb/c but not a/bb/c/d or a/bb/q. */
+static void testDirs(void) {
+  DT_Dir_T bb;
+  DT_Dir_T d;
+
+  assert(DT_openDir("a/bb/q", &bb) == NO_SUCH_PATH);
+  assert(DT_openDir("a/bb", &bb) == SUCCESS);
+  assert(DT_containsAt(bb, "c") == TRUE);
+  assert(DT_containsAt(bb, "q") == FALSE);
+  assert(DT_containsAt(bb, "") == FALSE);
+  assert(DT_insertAt(bb, "c") == ALREADY_IN_TREE);
+  assert(DT_insertAt(bb, "c/d/e") == SUCCESS);
+  assert(DT_containsPath("a/bb/c/d/e") == TRUE);
+  assert(DT_containsAt(bb, "c/d/e") == TRUE);
+
+  assert(DT_openDir("a/bb/c/d", &d) == SUCCESS);
+  assert(DT_containsAt(d, "e") == TRUE);
+  assert(DT_rmAt(d, "e/f") == NO_SUCH_PATH);
+  assert(DT_rmAt(d, "e") == SUCCESS);
+  assert(DT_containsPath("a/bb/c/d/e") == FALSE);
+  assert(DT_insertAt(d, "e") == SUCCESS);
+
+  /* a handle below a removed directory stays stale, even once the
+     same path is back in the tree */
+  assert(DT_rmAt(bb, "c/d") == SUCCESS);
+  assert(DT_insertPath("a/bb/c/d") == SUCCESS);
+  assert(DT_insertAt(d, "e") == NO_SUCH_PATH);
+  assert(DT_containsAt(d, "") == FALSE);
+  assert(DT_rmAt(d, "e") == NO_SUCH_PATH);
+  assert(DT_containsPath("a/bb/c/d/e") == FALSE);
+  DT_closeDir(d);
+
+  assert(DT_rmAt(bb, "c/d") == SUCCESS);
+  assert(DT_containsAt(bb, "c") == TRUE);
+  DT_closeDir(bb);
+}
+
+/* Checks that DT_move relinks a whole hierarchy, with its listing,
+   aggregates, handles and names, and rejects every impossible move.
+   The DT must contain a but not a/m. */
+static void testMove(void) {
+  struct DT_Stat stat;
+  DT_Dir_T dir;
+  char* result;
+  char buf[32];
+  size_t total;
+  size_t i;
+
+  for(i = 0; i < 100; i++) {
+    sprintf(buf, "a/m/p/q/%03lu", (unsigned long) i);
+    assert(DT_insertPath(buf) == SUCCESS);
+  }
+  assert(DT_insertPath("a/m/p/q/050/r") == SUCCESS);
+  assert(DT_insertPath("a/m/s") == SUCCESS);
+  assert(DT_openDir("a/m/p/q/050", &dir) == SUCCESS);
+
+  assert(DT_move("a/m/p/q", "a/m/s/longer") == SUCCESS);
+  assert(DT_containsPath("a/m/p/q") == FALSE);
+  assert(DT_containsPath("a/m/p/q/050/r") == FALSE);
+  assert(DT_containsPath("a/m/s/longer/050/r") == TRUE);
+  assert(DT_containsPath("a/m/s/longer/099") == TRUE);
+  assert(DT_containsAt(dir, "r") == TRUE);
+  assert(DT_insertAt(dir, "t") == SUCCESS);
+  assert(DT_containsPath("a/m/s/longer/050/t") == TRUE);
+
+  assert(DT_stat("a/m/p", &stat) == SUCCESS);
+  assert(stat.numDirs == 1);
+  assert(stat.listingBytes == strlen("a/m/p\n"));
+  assert(DT_stat("a/m", &stat) == SUCCESS);
+  assert(stat.numDirs == 106);
+  assert(stat.listingBytes == strlen("a/m\na/m/p\na/m/s\na/m/s/longer\n")
+         + 100 * strlen("a/m/s/longer/000\n")
+         + 2 * strlen("a/m/s/longer/050/r\n"));
+  result = DT_list("a/m/s", 0, 4, &total);
+  assert(total == 104);
+  assert(!strcmp(result, "a/m/s\na/m/s/longer\na/m/s/longer/000\n"
+                 "a/m/s/longer/001\n"));
+  free(result);
+  result = DT_list("a/m/s/longer/050", 0, 3, NULL);
+  assert(!strcmp(result, "a/m/s/longer/050\na/m/s/longer/050/r\n"
+                 "a/m/s/longer/050/t\n"));
+  free(result);
+
+  /* back up the tree, under a shorter name, and into a wide
+     directory */
+  assert(DT_move("a/m/s/longer/050", "a/m/s/longer/q") == SUCCESS);
+  assert(DT_move("a/m/s/longer", "a/m/l") == SUCCESS);
+  assert(DT_containsPath("a/m/l/q/t") == TRUE);
+  assert(DT_containsAt(dir, "r") == TRUE);
+  assert(DT_move("a/m/p", "a/m/l/050") == SUCCESS);
+  assert(DT_stat("a/m/l", &stat) == SUCCESS);
+  assert(stat.numDirs == 104);
+  assert(stat.numChildren == 101);
+  assert(stat.listingBytes == strlen("a/m/l\n")
+         + 100 * strlen("a/m/l/000\n") + strlen("a/m/l/q\n")
+         + 2 * strlen("a/m/l/q/r\n"));
+
+  result = named("q");
+  assert(!strcmp(result, "\na/m/l/q\n"));
+  free(result);
+  result = named("050");
+  assert(!strcmp(result, "\na/m/l/050\n"));
+  free(result);
+  result = named("longer");
+  assert(!strcmp(result, "\n"));
+  free(result);
+  result = globbed("a/m/**/r");
+  assert(!strcmp(result, "a/m/l/q/r\n"));
+  free(result);
+
+  assert(DT_move("a/m/x", "a/m/y") == NO_SUCH_PATH);
+  assert(DT_move("a/m/l", "a/m/x/y") == NO_SUCH_PATH);
+  assert(DT_move("a/m/l/q", "a/m/s") == ALREADY_IN_TREE);
+  assert(DT_move("a", "b") == CONFLICTING_PATH);
+  assert(DT_move("a/m/l", "a/m/l") == CONFLICTING_PATH);
+  assert(DT_move("a/m/l", "a/m/l/q/z") == CONFLICTING_PATH);
+  assert(DT_move("a/m/l", "z") == CONFLICTING_PATH);
+  assert(DT_move("a/m/l", "a/m/") == CONFLICTING_PATH);
+  assert(DT_move("a/m/l", "a/m/ll") == SUCCESS);
+  assert(DT_containsPath("a/m/ll/q/r") == TRUE);
+
+  DT_closeDir(dir);
+  assert(DT_rmPath("a/m") == SUCCESS);
+  assert(DT_containsPath("a/m/ll/q") == FALSE);
+}
+
+/* Checks that a copy from DT_clone answers every query as its source
+   did, and that the two diverge as either changes, whatever becomes
+   of the other. The DT must contain a but not a/t, a/cc, a/d, a/m,
+   a/p or a/q. */
+static void testClone(void) {
+  struct DT_Stat stat;
+  struct DT_Stat copied;
+  DT_Dir_T dir;
+  char* result;
+  char buf[32];
+  size_t i;
+
+  for(i = 0; i < 100; i++) {
+    sprintf(buf, "a/t/%03lu", (unsigned long) i);
+    assert(DT_insertPath(buf) == SUCCESS);
+  }
+  assert(DT_insertPath("a/t/050/r") == SUCCESS);
+  assert(DT_insertPath("a/t/050/s/u") == SUCCESS);
+  assert(DT_stat("a/t", &stat) == SUCCESS);
+
+  assert(DT_clone("a/t", "a/cc") == SUCCESS);
+  assert(DT_containsPath("a/cc/050/s/u") == TRUE);
+  assert(DT_containsPath("a/cc/050/x") == FALSE);
+  assert(DT_containsPath("a/cc/100") == FALSE);
+  assert(DT_stat("a/cc", &copied) == SUCCESS);
+  assert(copied.numDirs == stat.numDirs);
+  assert(copied.numChildren == 100);
+  assert(copied.listingBytes == stat.listingBytes + stat.numDirs);
+  assert(DT_stat("a/cc/050/s", &copied) == SUCCESS);
+  assert(copied.numDirs == 2);
+  assert(copied.listingBytes == strlen("a/cc/050/s\na/cc/050/s/u\n"));
+  result = DT_list("a/cc", 0, 3, &i);
+  assert(i == stat.numDirs);
+  assert(!strcmp(result, "a/cc\na/cc/000\na/cc/001\n"));
+  free(result);
+
+  /* the two diverge, either way */
+  assert(DT_insertPath("a/cc/050/new") == SUCCESS);
+  assert(DT_containsPath("a/t/050/new") == FALSE);
+  assert(DT_insertPath("a/t/001/q") == SUCCESS);
+  assert(DT_containsPath("a/cc/001/q") == FALSE);
+  assert(DT_rmPath("a/t/050/s") == SUCCESS);
+  assert(DT_containsPath("a/cc/050/s/u") == TRUE);
+  assert(DT_rmPath("a/cc/000") == SUCCESS);
+  assert(DT_containsPath("a/t/000") == TRUE);
+
+  /* a copy of part of a copy, and handles into one */
+  assert(DT_clone("a/cc/050", "a/d") == SUCCESS);
+  assert(DT_containsPath("a/d/new") == TRUE);
+  assert(DT_containsPath("a/d/s/u") == TRUE);
+  assert(DT_openDir("a/d/s", &dir) == SUCCESS);
+  assert(DT_containsAt(dir, "u") == TRUE);
+  assert(DT_insertAt(dir, "u/v") == SUCCESS);
+  assert(DT_containsPath("a/cc/050/s/u/v") == FALSE);
+  DT_closeDir(dir);
+
+  /* the copies outlive their sources, moved or removed */
+  assert(DT_insertPath("a/m") == SUCCESS);
+  assert(DT_move("a/t", "a/m/t") == SUCCESS);
+  assert(DT_containsPath("a/cc/099") == TRUE);
+  assert(DT_rmPath("a/m") == SUCCESS);
+  assert(DT_containsPath("a/cc/099") == TRUE);
+  assert(DT_rmPath("a/cc") == SUCCESS);
+  assert(DT_containsPath("a/d/s/u/v") == TRUE);
+  assert(DT_stat("a/d", &copied) == SUCCESS);
+  assert(copied.numDirs == 6);
+
+  result = named("u");
+  assert(!strcmp(result, "\na/d/s/u\n"));
+  free(result);
+  result = globbed("a/d/**");
+  assert(!strcmp(result, "a/d\na/d/new\na/d/r\na/d/s\na/d/s/u\n"
+                 "a/d/s/u/v\n"));
+  free(result);
+
+  assert(DT_clone("a/x", "a/y") == NO_SUCH_PATH);
+  assert(DT_clone("a/d", "a/x/y") == NO_SUCH_PATH);
+  assert(DT_clone("a/d", "a/d/s/d") == CONFLICTING_PATH);
+  assert(DT_clone("a", "a/b") == CONFLICTING_PATH);
+  assert(DT_clone("a/d", "b") == CONFLICTING_PATH);
+  assert(DT_clone("a/d/r", "a/d/s") == ALREADY_IN_TREE);
+  assert(DT_rmPath("a/d") == SUCCESS);
+
+  /* part of a copy may be found at its source, under another path,
+     and a copy of it put inside that source holds it as it was */
+  assert(DT_insertPath("a/p/c/d") == SUCCESS);
+  assert(DT_clone("a/p", "a/q") == SUCCESS);
+  assert(DT_clone("a/q/c", "a/p/c/x") == SUCCESS);
+  assert(DT_clone("a/q/c", "a/p/c/x/y") == SUCCESS);
+  assert(DT_containsPath("a/p/c/x/d") == TRUE);
+  assert(DT_containsPath("a/p/c/x/y/d") == TRUE);
+  assert(DT_containsPath("a/p/c/x/x") == FALSE);
+  assert(DT_containsPath("a/q/c/x") == FALSE);
+  assert(DT_stat("a/p", &copied) == SUCCESS);
+  assert(copied.numDirs == 7);
+  result = DT_list("a/p", 0, 10, &i);
+  assert(i == 7);
+  assert(!strcmp(result, "a/p\na/p/c\na/p/c/d\na/p/c/x\na/p/c/x/d\n"
+                 "a/p/c/x/y\na/p/c/x/y/d\n"));
+  free(result);
+  assert(DT_rmPath("a/p") == SUCCESS);
+  assert(DT_rmPath("a/q") == SUCCESS);
+}
+
+/* Checks that a snapshot answers every query as the tree did when it
+   was taken, however the tree changes after, and whatever becomes of
+   other references to it. The DT must contain a but not a/s or
+   a/cs. */
+static void testSnapshot(void) {
+  struct DT_Stat stat;
+  DT_Snap_T snap;
+  DT_Snap_T later;
+  char* before;
+  char* result;
+  size_t total;
+
+  assert(DT_insertPath("a/s/x") == SUCCESS);
+  assert(DT_insertPath("a/s/y/z") == SUCCESS);
+  assert(DT_clone("a/s", "a/cs") == SUCCESS);
+  before = DT_toString();
+  assert(DT_snapshot(&snap) == SUCCESS);
+  result = DT_toStringIn(snap);
+  assert(!strcmp(result, before));
+  free(result);
+
+  /* the tree changes under and around the snapshot */
+  assert(DT_insertPath("a/s/y/w") == SUCCESS);
+  assert(DT_rmPath("a/s/x") == SUCCESS);
+  assert(DT_move("a/s/y", "a/s/v") == SUCCESS);
+  assert(DT_insertPath("a/cs/y/z/q") == SUCCESS);
+  assert(DT_containsIn(snap, "a/s/x") == TRUE);
+  assert(DT_containsIn(snap, "a/s/y/z") == TRUE);
+  assert(DT_containsIn(snap, "a/s/y/w") == FALSE);
+  assert(DT_containsIn(snap, "a/s/v") == FALSE);
+  assert(DT_containsIn(snap, "a/cs/y/z") == TRUE);
+  assert(DT_containsIn(snap, "a/cs/y/z/q") == FALSE);
+  assert(DT_containsIn(snap, "b") == FALSE);
+  assert(DT_statIn(snap, "a/s", &stat) == SUCCESS);
+  assert(stat.numDirs == 4);
+  assert(stat.numChildren == 2);
+  assert(stat.listingBytes == strlen("a/s\na/s/x\na/s/y\na/s/y/z\n"));
+  assert(DT_statIn(snap, "a/s/v", &stat) == NO_SUCH_PATH);
+  result = DT_listIn(snap, "a/cs", 1, 2, &total);
+  assert(total == 4);
+  assert(!strcmp(result, "a/cs/x\na/cs/y\n"));
+  free(result);
+  assert(DT_listIn(snap, "a/s/v", 0, 1, NULL) == NULL);
+
+  /* each reference is released on its own, and a later snapshot
+     sees the tree as it is now */
+  DT_retainSnapshot(snap);
+  DT_releaseSnapshot(snap);
+  assert(DT_snapshot(&later) == SUCCESS);
+  assert(DT_containsIn(later, "a/s/v/w") == TRUE);
+  assert(DT_containsIn(later, "a/s/x") == FALSE);
+  assert(DT_rmPath("a/s") == SUCCESS);
+  assert(DT_rmPath("a/cs") == SUCCESS);
+  assert(DT_containsIn(later, "a/s/v/w") == TRUE);
+  result = DT_toStringIn(snap);
+  assert(!strcmp(result, before));
+  free(result);
+  DT_releaseSnapshot(snap);
+  DT_releaseSnapshot(later);
+  free(before);
+}
+
+/* Checks that DT_abort undoes every kind of change of a transaction,
+   latest first, that DT_commit keeps them, and that nested ones are
+   kept or undone with the enclosing one. The DT must contain a but
+   not a/p, a/r, a/s, a/u, a/v or a/w. */
+static void testTransaction(void) {
+  DT_Snap_T snap;
+  char* before;
+  char* result;
+
+  assert(DT_insertPath("a/u/x/y") == SUCCESS);
+  assert(DT_insertPath("a/u/z") == SUCCESS);
+  before = DT_toString();
+
+  assert(DT_begin() == SUCCESS);
+  assert(DT_insertPath("a/v/1") == SUCCESS);
+  assert(DT_rmPath("a/u/x") == SUCCESS);
+  assert(DT_move("a/u", "a/v/u") == SUCCESS);
+  assert(DT_clone("a/v", "a/w") == SUCCESS);
+  assert(DT_rmPath("a/w/u/z") == SUCCESS);
+  assert(DT_containsPath("a/w/1") == TRUE);
+  assert(DT_containsPath("a/u/x/y") == FALSE);
+  assert(DT_snapshot(&snap) == SUCCESS);
+  assert(DT_abort() == SUCCESS);
+  result = DT_toString();
+  assert(!strcmp(result, before));
+  free(result);
+  assert(DT_containsPath("a/u/x/y") == TRUE);
+  assert(DT_containsPath("a/v") == FALSE);
+  assert(DT_containsIn(snap, "a/w/u") == TRUE);
+  assert(DT_containsIn(snap, "a/w/u/z") == FALSE);
+  DT_releaseSnapshot(snap);
+
+  /* a nested transaction undone on its own, then one kept with the
+     enclosing one */
+  assert(DT_begin() == SUCCESS);
+  assert(DT_insertPath("a/v") == SUCCESS);
+  assert(DT_begin() == SUCCESS);
+  assert(DT_rmPath("a/u") == SUCCESS);
+  assert(DT_abort() == SUCCESS);
+  assert(DT_containsPath("a/u/z") == TRUE);
+  assert(DT_begin() == SUCCESS);
+  assert(DT_move("a/u/z", "a/v/z") == SUCCESS);
+  assert(DT_commit() == SUCCESS);
+  assert(DT_commit() == SUCCESS);
+  assert(DT_containsPath("a/v/z") == TRUE);
+  assert(DT_containsPath("a/u/z") == FALSE);
+  assert(DT_commit() == INITIALIZATION_ERROR);
+  assert(DT_abort() == INITIALIZATION_ERROR);
+
+  /* the root itself */
+  assert(DT_begin() == SUCCESS);
+  assert(DT_rmPath("a") == SUCCESS);
+  assert(DT_insertPath("b/c") == SUCCESS);
+  assert(DT_abort() == SUCCESS);
+  assert(DT_containsPath("b") == FALSE);
+  assert(DT_containsPath("a/v/z") == TRUE);
+
+  /* a copy removed in a transaction is left out of what later happens
+     to its old parent, but still expanded when its source goes */
+  assert(DT_insertPath("a/s/x") == SUCCESS);
+  assert(DT_insertPath("a/p") == SUCCESS);
+  assert(DT_clone("a/s", "a/p/q") == SUCCESS);
+  assert(DT_begin() == SUCCESS);
+  assert(DT_rmPath("a/p/q") == SUCCESS);
+  assert(DT_move("a/p", "a/r") == SUCCESS);
+  assert(DT_rmPath("a/s") == SUCCESS);
+  assert(DT_abort() == SUCCESS);
+  assert(DT_containsPath("a/p/q/x") == TRUE);
+  assert(DT_containsPath("a/s/x") == TRUE);
+  assert(DT_containsPath("a/r") == FALSE);
+  assert(DT_rmPath("a/s") == SUCCESS);
+  assert(DT_rmPath("a/p") == SUCCESS);
+
+  assert(DT_rmPath("a/u") == SUCCESS);
+  assert(DT_rmPath("a/v") == SUCCESS);
+  free(before);
+}
+
+/* Checks that an image that DT_save saved, whether read into a
+   snapshot from the file or mapped into memory, or loaded back into
+   the tree, answers every query as the tree did, and that a file
+   that is not an image is refused. The DT must contain a but not a/i
+   or a/ci. */
+static void testImage(void) {
+  struct DT_Stat stat;
+  struct DT_Stat saved;
+  DT_Snap_T snap;
+  FILE* file;
+  char* before;
+  char* result;
+  size_t total;
+  int fd;
+
+  /* a copy is saved as what it stands for */
+  assert(DT_insertPath("a/i/x/y") == SUCCESS);
+  assert(DT_insertPath("a/i/z") == SUCCESS);
+  assert(DT_clone("a/i", "a/ci") == SUCCESS);
+  assert(DT_insertPath("a/ci/w") == SUCCESS);
+  before = DT_toString();
+  assert(DT_stat("a", &stat) == SUCCESS);
+  file = tmpfile();
+  assert(file != NULL);
+  fd = fileno(file);
+  assert(DT_save(fd) == SUCCESS);
+
+  assert(lseek(fd, 0, SEEK_SET) == 0);
+  assert(DT_loadSnapshot(fd, &snap) == SUCCESS);
+  result = DT_toStringIn(snap);
+  assert(!strcmp(result, before));
+  free(result);
+  assert(DT_containsIn(snap, "a/ci/x/y") == TRUE);
+  assert(DT_containsIn(snap, "a/ci/q") == FALSE);
+  assert(DT_containsIn(snap, "a//i") == FALSE);
+  assert(DT_containsIn(snap, "b") == FALSE);
+  assert(DT_statIn(snap, "a", &saved) == SUCCESS);
+  assert(saved.numDirs == stat.numDirs);
+  assert(saved.numChildren == stat.numChildren);
+  assert(saved.listingBytes == stat.listingBytes);
+  assert(DT_statIn(snap, "a/i", &saved) == SUCCESS);
+  assert(saved.numDirs == 4);
+  assert(saved.numChildren == 2);
+  assert(saved.listingBytes == strlen("a/i\na/i/x\na/i/x/y\na/i/z\n"));
+  assert(DT_statIn(snap, "a/i/q", &saved) == NO_SUCH_PATH);
+  result = DT_listIn(snap, "a/ci", 1, 2, &total);
+  assert(total == 5);
+  assert(!strcmp(result, "a/ci/w\na/ci/x\n"));
+  free(result);
+  assert(DT_listIn(snap, "a/ci/q", 0, 1, NULL) == NULL);
+  DT_releaseSnapshot(snap);
+
+  /* loading is for an empty tree only, and can be undone */
+  assert(lseek(fd, 0, SEEK_SET) == 0);
+  assert(DT_load(fd) == CONFLICTING_PATH);
+  assert(DT_begin() == SUCCESS);
+  assert(DT_rmPath("a") == SUCCESS);
+  assert(DT_load(fd) == SUCCESS);
+  result = DT_toString();
+  assert(!strcmp(result, before));
+  free(result);
+  assert(DT_containsPath("a/ci/x/y") == TRUE);
+  assert(DT_abort() == SUCCESS);
+  assert(DT_containsPath("a/ci/x/y") == TRUE);
+  fclose(file);
+
+  /* an image after an odd number of bytes cannot be mapped, so it is
+     read in, and a truncated one is refused */
+  file = tmpfile();
+  assert(file != NULL);
+  fd = fileno(file);
+  assert(write(fd, "x", 1) == 1);
+  assert(DT_save(fd) == SUCCESS);
+  assert(lseek(fd, 1, SEEK_SET) == 1);
+  assert(DT_loadSnapshot(fd, &snap) == SUCCESS);
+  result = DT_toStringIn(snap);
+  assert(!strcmp(result, before));
+  free(result);
+  DT_releaseSnapshot(snap);
+  assert(ftruncate(fd, 40) == 0);
+  assert(lseek(fd, 1, SEEK_SET) == 1);
+  assert(DT_loadSnapshot(fd, &snap) == IO_ERROR);
+  assert(lseek(fd, 0, SEEK_SET) == 0);
+  assert(DT_loadSnapshot(fd, &snap) == IO_ERROR);
+  fclose(file);
+
+  assert(DT_rmPath("a/i") == SUCCESS);
+  assert(DT_rmPath("a/ci") == SUCCESS);
+  free(before);
+}
+
+/* Checks that the listing of DT_toString rebuilds the tree, and that
+   a listing out of order, or with a line out of place, is refused and
+   leaves the tree empty. The DT must contain a/bb/c. */
+static void testFromString(void) {
+  char* before;
+  char* result;
+
+  assert(DT_insertPath("a/x/z") == SUCCESS);
+  assert(DT_insertPath("a/x-y/w") == SUCCESS);
+  assert(DT_insertPath("a/bb/d/e") == SUCCESS);
+  before = DT_toString();
+  assert(DT_fromString(before) == CONFLICTING_PATH);
+
+  assert(DT_begin() == SUCCESS);
+  assert(DT_rmPath("a") == SUCCESS);
+  assert(DT_fromString(before) == SUCCESS);
+  result = DT_toString();
+  assert(!strcmp(result, before));
+  free(result);
+  assert(DT_containsPath("a/x-y/w") == TRUE);
+  assert(DT_rmPath("a") == SUCCESS);
+
+  /* the last newline can be left off, and an empty listing is an
+     empty tree */
+  assert(DT_fromStringN(before, strlen(before) - 1) == SUCCESS);
+  result = DT_toString();
+  assert(!strcmp(result, before));
+  free(result);
+  assert(DT_rmPath("a") == SUCCESS);
+  assert(DT_fromString("") == SUCCESS);
+  assert(DT_containsPath("a") == FALSE);
+
+  assert(DT_fromString("a\na/c\na/b\n") == PARENT_CHILD_ERROR);
+  assert(DT_fromString("a\na/x-y\na/x\n") == PARENT_CHILD_ERROR);
+  assert(DT_fromString("a\na/b\na/c\na/b/d\n") == PARENT_CHILD_ERROR);
+  assert(DT_fromString("a\na/b/c\n") == PARENT_CHILD_ERROR);
+  assert(DT_fromString("a\na/\n") == PARENT_CHILD_ERROR);
+  assert(DT_fromString("a/b\n") == PARENT_CHILD_ERROR);
+  assert(DT_fromString("\n") == PARENT_CHILD_ERROR);
+  assert(DT_fromString("a\na/b\na/b\n") == ALREADY_IN_TREE);
+  assert(DT_fromString("a\na/b\nb\n") == CONFLICTING_PATH);
+  assert(DT_fromString("a\na/b\nab/c\n") == CONFLICTING_PATH);
+  assert(DT_containsPath("a") == FALSE);
+  assert(DT_abort() == SUCCESS);
+
+  result = DT_toString();
+  assert(!strcmp(result, before));
+  free(result);
+  assert(DT_rmPath("a/x") == SUCCESS);
+  assert(DT_rmPath("a/x-y") == SUCCESS);
+  assert(DT_rmPath("a/bb/d") == SUCCESS);
+  free(before);
+}
+
+/* Makes the directory fsDir on disk with the subdirectories x, x/y, b
+   and a-b, a file f and a symbolic link ln to x, for DT_importDir to
+   import, or, if make is FALSE, removes them all again. */
+static void makeImportDir(const char* fsDir, boolean make) {
+  const char* dirs[5];
+  char path[128];
+  FILE* file;
+  size_t i;
+
+  dirs[0] = "";
+  dirs[1] = "/x";
+  dirs[2] = "/x/y";
+  dirs[3] = "/b";
+  dirs[4] = "/a-b";
+  if(make) {
+    for(i = 0; i < 5; i++) {
+      sprintf(path, "%s%s", fsDir, dirs[i]);
+      assert(mkdir(path, 0700) == 0);
+    }
+    sprintf(path, "%s/f", fsDir);
+    file = fopen(path, "w");
+    assert(file != NULL);
+    fclose(file);
+    sprintf(path, "%s/ln", fsDir);
+    assert(symlink("x", path) == 0);
+    return;
+  }
+  sprintf(path, "%s/f", fsDir);
+  assert(remove(path) == 0);
+  sprintf(path, "%s/ln", fsDir);
+  assert(remove(path) == 0);
+  for(i = 5; i > 0; i--) {
+    sprintf(path, "%s%s", fsDir, dirs[i - 1]);
+    assert(rmdir(path) == 0);
+  }
+}
+
+/* Checks that DT_importDir adds the directories of fsDir, which
+   makeImportDir made, and none of its other entries, that it fails
+   as a whole, and that a transaction's abort undoes it. The DT must
+   contain a but not a/imp or a/imp2. */
+static void testImport(const char* fsDir) {
+  struct DT_ImportStats stats;
+  char path[128];
+  char* result;
+  size_t total;
+
+  assert(DT_importDir(fsDir, "a/imp", 4, &stats) == SUCCESS);
+  assert(stats.numDirs == 5);
+  assert(stats.numSkipped == 2);
+  result = DT_list("a/imp", 0, 10, &total);
+  assert(total == 5);
+  assert(!strcmp(result,
+                 "a/imp\na/imp/a-b\na/imp/b\na/imp/x\na/imp/x/y\n"));
+  free(result);
+  assert(DT_importDir(fsDir, "a/imp", 4, NULL) == ALREADY_IN_TREE);
+
+  assert(DT_begin() == SUCCESS);
+  assert(DT_importDir(fsDir, "a/imp2/in", 0, NULL) == SUCCESS);
+  assert(DT_containsPath("a/imp2/in/x/y") == TRUE);
+  assert(DT_abort() == SUCCESS);
+  assert(DT_containsPath("a/imp2") == FALSE);
+
+  sprintf(path, "%s/none", fsDir);
+  assert(DT_importDir(path, "a/imp2", 2, NULL) == IO_ERROR);
+  sprintf(path, "%s/f", fsDir);
+  assert(DT_importDir(path, "a/imp2", 2, NULL) == IO_ERROR);
+  assert(DT_containsPath("a/imp2") == FALSE);
+  assert(DT_rmPath("a/imp") == SUCCESS);
+}
+
+/* Stores error in the int at extra. Used as a DT_exportDir
+   callback. */
+static void storeError(const char* fsPath, int error, void* extra) {
+  assert(fsPath != NULL);
+  *(int*) extra = error;
+}
+
+/* Checks that DT_exportDir makes the directories of a hierarchy,
+   unexpanded copies included, below a directory on disk, that it can
+   make them again over themselves, and that it reports the ones it
+   cannot make. fsDir must be a directory that makeImportDir made. The
+   DT must contain a but not a/exp, a/exp2, a/exp3 or a/back. */
+static void testExport(const char* fsDir) {
+  struct DT_ExportStats stats;
+  char out[128];
+  char path[128];
+  int error = 0;
+
+  assert(DT_insertPath("a/exp/x/y") == SUCCESS);
+  assert(DT_insertPath("a/exp/b") == SUCCESS);
+  assert(DT_clone("a/exp", "a/exp2") == SUCCESS);
+  sprintf(out, "%s/out", fsDir);
+  assert(DT_exportDir("a/exp2", out, 4, storeError, &error, &stats)
+         == SUCCESS);
+  assert(stats.numDirs == 4);
+  assert(stats.numFailed == 0);
+  assert(DT_exportDir("a/exp2", out, 1, NULL, NULL, &stats) == SUCCESS);
+  assert(stats.numDirs == 4);
+  assert(DT_importDir(out, "a/back", 2, NULL) == SUCCESS);
+  assert(DT_containsPath("a/back/x/y") == TRUE);
+  assert(DT_containsPath("a/back/b") == TRUE);
+  assert(DT_exportDir("a/none", out, 1, NULL, NULL, NULL)
+         == NO_SUCH_PATH);
+
+  /* a failure stops only the directories below it */
+  sprintf(path, "%s/f/out", fsDir);
+  assert(DT_exportDir("a/exp", path, 2, storeError, &error, &stats)
+         == IO_ERROR);
+  assert(error == ENOTDIR);
+  assert(stats.numDirs == 0);
+  assert(stats.numFailed == 1);
+  assert(DT_insertPath("a/exp3/../z") == SUCCESS);
+  assert(DT_insertPath("a/exp3/w") == SUCCESS);
+  sprintf(path, "%s/out3", fsDir);
+  error = 0;
+  assert(DT_exportDir("a/exp3", path, 2, storeError, &error, &stats)
+         == IO_ERROR);
+  assert(error == EINVAL);
+  assert(stats.numDirs == 2);
+  assert(stats.numFailed == 1);
+
+  sprintf(path, "%s/out3/w", fsDir);
+  assert(rmdir(path) == 0);
+  sprintf(path, "%s/out3", fsDir);
+  assert(rmdir(path) == 0);
+  sprintf(path, "%s/out/x/y", fsDir);
+  assert(rmdir(path) == 0);
+  sprintf(path, "%s/out/x", fsDir);
+  assert(rmdir(path) == 0);
+  sprintf(path, "%s/out/b", fsDir);
+  assert(rmdir(path) == 0);
+  assert(rmdir(out) == 0);
+  assert(DT_rmPath("a/exp") == SUCCESS);
+  assert(DT_rmPath("a/exp2") == SUCCESS);
+  assert(DT_rmPath("a/exp3") == SUCCESS);
+  assert(DT_rmPath("a/back") == SUCCESS);
+}
+
+/* Returns the length of the file that fd refers to once it is not
+   length, or length if it stays that for tries hundredths of a
+   second. */
+static off_t waitForLength(int fd, off_t length, int tries) {
+  struct timespec pause;
+  struct stat st;
+  int i;
+
+  pause.tv_sec = 0;
+  pause.tv_nsec = 10000000;
+  for(i = 0; i < tries; i++) {
+    assert(fstat(fd, &st) == 0);
+    if(st.st_size != length)
+      return st.st_size;
+    (void) nanosleep(&pause, NULL);
+  }
+  return length;
+}
+
+/* Checks that the changes made with a journal are there again when
+   the tree is started from it, but for those of aborted transactions
+   and those that failed, that a torn record is dropped, and that a
+   checkpoint and the records after it make the tree whether or not
+   the journal has been compacted since, and that a change is
+   synchronized once its window passes, with none made after it,
+   unless its transaction is open. Starts and destroys the DT
+   with options, which must not be initialized, and imports fsDir,
+   which makeImportDir made. */
+static void testJournal(const struct DT_Options* base,
+                        const char* fsDir) {
+  struct DT_Options options;
+  struct stat st;
+  DT_Dir_T dir;
+  FILE* journal;
+  FILE* image;
+  FILE* later;
+  char* before;
+  char* result;
+  off_t length;
+
+  journal = tmpfile();
+  image = tmpfile();
+  later = tmpfile();
+  assert(journal != NULL && image != NULL && later != NULL);
+  options = *base;
+  options.journalFd = fileno(journal);
+  options.journalWindow = 1000000;
+
+  assert(DT_initWithOptions(&options) == SUCCESS);
+  assert(DT_insertPath("a/b/c") == SUCCESS);
+  assert(DT_insertPath("a/d") == SUCCESS);
+  assert(DT_insertPath("a/d") == ALREADY_IN_TREE);
+  assert(DT_clone("a/b", "a/e") == SUCCESS);
+  assert(DT_move("a/d", "a/b/d") == SUCCESS);
+  assert(DT_openDir("a/b", &dir) == SUCCESS);
+  assert(DT_insertAt(dir, "x/y") == SUCCESS);
+  assert(DT_rmAt(dir, "c") == SUCCESS);
+  DT_closeDir(dir);
+  assert(DT_rmPath("a/e/c") == SUCCESS);
+  assert(DT_begin() == SUCCESS);
+  assert(DT_insertPath("a/t") == SUCCESS);
+  assert(DT_abort() == SUCCESS);
+  assert(DT_begin() == SUCCESS);
+  assert(DT_insertPath("a/u") == SUCCESS);
+  assert(DT_importDir(fsDir, "a/u/imp", 2, NULL) == SUCCESS);
+  assert(DT_sync() == SUCCESS);
+  assert(DT_commit() == SUCCESS);
+  assert(DT_load(0) == CONFLICTING_PATH);
+  before = DT_toString();
+  assert(DT_sync() == SUCCESS);
+  assert(DT_destroy() == SUCCESS);
+
+  /* a record torn by a crash is dropped */
+  assert(lseek(fileno(journal), 0, SEEK_END) > 0);
+  assert(write(fileno(journal), "torn", 4) == 4);
+  assert(DT_initWithOptions(&options) == SUCCESS);
+  result = DT_toString();
+  assert(!strcmp(result, before));
+  free(result);
+  assert(DT_containsPath("a/t") == FALSE);
+
+  /* a checkpoint holds the records before it, so compaction can drop
+     them, and a later checkpoint skips them */
+  assert(DT_compact() == CONFLICTING_PATH);
+  assert(DT_checkpoint(fileno(image)) == SUCCESS);
+  assert(DT_compact() == SUCCESS);
+  assert(DT_insertPath("a/v") == SUCCESS);
+  assert(DT_compact() == CONFLICTING_PATH);
+  assert(DT_checkpoint(fileno(later)) == SUCCESS);
+  assert(DT_insertPath("a/w") == SUCCESS);
+  free(before);
+  before = DT_toString();
+  assert(DT_destroy() == SUCCESS);
+
+  assert(lseek(fileno(image), 0, SEEK_SET) == 0);
+  options.imageFd = fileno(image);
+  assert(DT_initWithOptions(&options) == SUCCESS);
+  result = DT_toString();
+  assert(!strcmp(result, before));
+  free(result);
+  assert(DT_destroy() == SUCCESS);
+  assert(lseek(fileno(later), 0, SEEK_SET) == 0);
+  options.imageFd = fileno(later);
+  assert(DT_initWithOptions(&options) == SUCCESS);
+  result = DT_toString();
+  assert(!strcmp(result, before));
+  free(result);
+  assert(DT_destroy() == SUCCESS);
+
+  /* the journal no longer carries on from an empty tree */
+  options.imageFd = -1;
+  assert(DT_initWithOptions(&options) == IO_ERROR);
+  assert(DT_insertPath("a") == INITIALIZATION_ERROR);
+
+  /* the journal's thread writes a change once its window is up */
+  assert(ftruncate(fileno(journal), 0) == 0);
+  options.journalWindow = 10000;
+  assert(DT_initWithOptions(&options) == SUCCESS);
+  assert(fstat(fileno(journal), &st) == 0);
+  assert(DT_insertPath("a/q") == SUCCESS);
+  length = waitForLength(fileno(journal), st.st_size, 100);
+  assert(length > st.st_size);
+  assert(DT_begin() == SUCCESS);
+  assert(DT_insertPath("a/r") == SUCCESS);
+  assert(waitForLength(fileno(journal), length, 10) == length);
+  assert(DT_abort() == SUCCESS);
+  assert(DT_destroy() == SUCCESS);
+  assert(DT_initWithOptions(&options) == SUCCESS);
+  assert(DT_containsPath("a/q") == TRUE);
+  assert(DT_containsPath("a/r") == FALSE);
+  assert(DT_destroy() == SUCCESS);
+
+  fclose(journal);
+  fclose(image);
+  fclose(later);
+  free(before);
+}
+
+/* Runs the tests above with each kind of child index, and with and
+   without a path filter and an index of names.
+   Returns 0. */
+int main(void) {
+  struct DT_Options options;
+  enum DT_ChildIndex indexes[4];
+  size_t filterCounters[4];
+  boolean indexNames[4];
+  DT_Dir_T dir;
+  DT_Snap_T snap;
+  DT_Snap_T later;
+  char fsDir[64];
+  char* result;
+  size_t total;
+  size_t i;
+
+  /* Before the data structure is initialized, every operation fails
+     as the corresponding one of dt_client.c does. */
+  assert(DT_list("a", 0, 1, &total) == NULL);
+  assert(DT_listDir("a", appendName, NULL) == INITIALIZATION_ERROR);
+  assert(DT_insertPathN("a", 1) == INITIALIZATION_ERROR);
+  assert(DT_containsPathN("a", 1) == FALSE);
+  assert(DT_openDir("a", &dir) == INITIALIZATION_ERROR);
+  assert(DT_containsMany(NULL, 0, NULL) == INITIALIZATION_ERROR);
+  assert(DT_scanRange(NULL, NULL, appendName, NULL)
+         == INITIALIZATION_ERROR);
+  assert(DT_glob("**", appendName, NULL) == INITIALIZATION_ERROR);
+  assert(DT_findByName("a", appendName, NULL) == INITIALIZATION_ERROR);
+  assert(DT_move("a/b", "a/c") == INITIALIZATION_ERROR);
+  assert(DT_clone("a/b", "a/c") == INITIALIZATION_ERROR);
+  assert(DT_snapshot(&snap) == INITIALIZATION_ERROR);
+  assert(DT_begin() == INITIALIZATION_ERROR);
+  assert(DT_commit() == INITIALIZATION_ERROR);
+  assert(DT_save(1) == INITIALIZATION_ERROR);
+  assert(DT_load(0) == INITIALIZATION_ERROR);
+  assert(DT_sync() == INITIALIZATION_ERROR);
+  assert(DT_checkpoint(1) == INITIALIZATION_ERROR);
+  assert(DT_compact() == INITIALIZATION_ERROR);
+  assert(DT_fromString("a\n") == INITIALIZATION_ERROR);
+  assert(DT_importDir(".", "a", 1, NULL) == INITIALIZATION_ERROR);
+  assert(DT_exportDir("a", ".", 1, NULL, NULL, NULL)
+         == INITIALIZATION_ERROR);
+
+  sprintf(fsDir, "/tmp/dtImport.%ld", (long) getpid());
+  makeImportDir(fsDir, TRUE);
+
+  indexes[0] = DT_INDEX_HASH;
+  filterCounters[0] = 0;
+  indexNames[0] = FALSE;
+  indexes[1] = DT_INDEX_BTREE;
+  filterCounters[1] = 0;
+  indexNames[1] = FALSE;
+  indexes[2] = DT_INDEX_HASH;
+  filterCounters[2] = 4096;
+  indexNames[2] = FALSE;
+  indexes[3] = DT_INDEX_BTREE;
+  filterCounters[3] = 4096;
+  indexNames[3] = TRUE;
+  for(i = 0; i < 4; i++) {
+    DT_defaultOptions(&options);
+    options.childIndex = indexes[i];
+    options.filterCounters = filterCounters[i];
+    options.indexNames = indexNames[i];
+    assert(DT_initWithOptions(&options) == SUCCESS);
+    assert(DT_initWithOptions(&options) == INITIALIZATION_ERROR);
+    assert(DT_insertPath("a/bb/c") == SUCCESS);
+
+    testWideDirectory();
+    testSlices();
+    testCache();
+    testFilter(filterCounters[i] > 0);
+    testDirs();
+    testMany();
+    testScan();
+    testGlob();
+    testNames();
+    testMove();
+    testClone();
+    testSnapshot();
+    testTransaction();
+    testImage();
+    testFromString();
+    testImport(fsDir);
+    testExport(fsDir);
+
+    /* snapshots outlive the tree, clones and all, even past the next
+       one, and one of an empty tree is empty */
+    assert(DT_clone("a/bb", "a/cc") == SUCCESS);
+    assert(DT_snapshot(&snap) == SUCCESS);
+    assert(DT_snapshot(&later) == SUCCESS);
+    assert(DT_openDir("a", &dir) == SUCCESS);
+    assert(DT_begin() == SUCCESS);
+    assert(DT_rmPath("a/bb") == SUCCESS);
+    assert(DT_destroy() == SUCCESS);
+    assert(DT_containsIn(snap, "a/bb/c") == TRUE);
+    DT_releaseSnapshot(snap);
+    assert(DT_insertAt(dir, "b") == INITIALIZATION_ERROR);
+    assert(DT_init() == SUCCESS);
+    assert(DT_snapshot(&snap) == SUCCESS);
+    result = DT_toStringIn(snap);
+    assert(!strcmp(result, ""));
+    free(result);
+    DT_releaseSnapshot(snap);
+    assert(DT_containsIn(later, "a/cc/c") == TRUE);
+    DT_releaseSnapshot(later);
+    assert(DT_insertPath("a") == SUCCESS);
+    assert(DT_insertAt(dir, "b") == NO_SUCH_PATH);
+    DT_closeDir(dir);
+    assert(DT_destroy() == SUCCESS);
+
+    testJournal(&options, fsDir);
+  }
+  makeImportDir(fsDir, FALSE);
+
+  return 0;
+}
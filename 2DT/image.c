@@ -0,0 +1,849 @@
+/*--------------------------------------------------------------------*/
+/* image.c                                                            */
+/*--------------------------------------------------------------------*/
+
+#include "image.h"
+#include "childset.h"
+#include "path.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The first bytes of every image, the last of which is the version of
+   the format. */
+
+static const char acMAGIC[8] = { 'D', 'T', 'I', 'M', 'A', 'G', 'E', 2 };
+
+/* A value whose bytes come out in another order on a machine of
+   another byte order. */
+
+static const size_t BYTE_ORDER_MARK = 0x01020304;
+
+/*--------------------------------------------------------------------*/
+
+/* The header at the start of an image. */
+
+struct ImageHeader
+{
+   /* acMAGIC. */
+   char acMagic[8];
+
+   /* BYTE_ORDER_MARK and sizeof(size_t) as the writer had them. */
+   size_t uByteOrder;
+   size_t uWordSize;
+
+   /* The number of nodes, and the length of the table of names. */
+   size_t uNodes;
+   size_t uNamesLength;
+
+   /* The writer's stamp. */
+   size_t uStamp;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* An Image is a view of the tables of an image in memory. */
+
+struct Image
+{
+   /* The memory that holds the image, from a mapping of uMapLength
+      bytes if iMapped is 1 (TRUE), and from malloc otherwise, and the
+      image's place in it. */
+   void *pvMemory;
+   size_t uMapLength;
+   int iMapped;
+   const char *pcBytes;
+   size_t uLength;
+
+   /* The tables. */
+   const struct ImageNode *pNodes;
+   size_t uNodes;
+   const size_t *puChildren;
+   size_t uChildren;
+   const char *pcNames;
+   size_t uNamesLength;
+
+   /* The stamp from the header. */
+   size_t uStamp;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* An ImageWriter is an image being built in memory. */
+
+struct ImageWriter
+{
+   /* The records of the uAdded nodes added so far, of the uNodes that
+      there are room for. */
+   struct ImageNode *pNodes;
+   size_t uNodes;
+   size_t uAdded;
+
+   /* The table of children, which has room for them all, and the
+      number of its positions that the added nodes have taken. */
+   size_t *puChildren;
+   size_t uSlots;
+
+   /* The table of names so far, in a buffer of uNamesSize bytes. */
+   char *pcNames;
+   size_t uNamesLength;
+   size_t uNamesSize;
+
+   /* The record of the first node to have each name, keyed by the
+      name, so that later ones share its entry in the table. */
+   ChildSet_T oNamed;
+
+   /* The stamp to write in the header. */
+   size_t uStamp;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Compare the uLength1 bytes at pcName1 with the uLength2 bytes at
+   pcName2 as strcmp would, as a ChildSet_T orders its keys.  Return
+   <0, 0, or >0 as the first comes before, is, or comes after the
+   second. */
+
+static int Image_compareNames(const char *pcName1, size_t uLength1,
+                              const char *pcName2, size_t uLength2)
+{
+   int iCompare;
+
+   iCompare = memcmp(pcName1, pcName2,
+                     uLength1 < uLength2 ? uLength1 : uLength2);
+   if (iCompare != 0)
+      return iCompare;
+   if (uLength1 == uLength2)
+      return 0;
+   return uLength1 < uLength2 ? -1 : 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+ImageWriter_T ImageWriter_new(size_t uNodes)
+{
+   ImageWriter_T oWriter;
+
+   oWriter = (ImageWriter_T)malloc(sizeof(struct ImageWriter));
+   if (oWriter == NULL)
+      return NULL;
+
+   /* one more of each, so that there is something to allocate even
+      for an empty tree */
+   oWriter->pNodes = (struct ImageNode*)
+      malloc(sizeof(struct ImageNode) * (uNodes + 1));
+   oWriter->puChildren = (size_t*)malloc(sizeof(size_t) * (uNodes + 1));
+   oWriter->oNamed = ChildSet_new(CHILDSET_HASH);
+   if (oWriter->pNodes == NULL || oWriter->puChildren == NULL ||
+       oWriter->oNamed == NULL)
+   {
+      free(oWriter->pNodes);
+      free(oWriter->puChildren);
+      if (oWriter->oNamed != NULL)
+         ChildSet_free(oWriter->oNamed);
+      free(oWriter);
+      return NULL;
+   }
+
+   oWriter->uNodes = uNodes;
+   oWriter->uAdded = 0;
+   oWriter->uSlots = 0;
+   oWriter->pcNames = NULL;
+   oWriter->uNamesLength = 0;
+   oWriter->uNamesSize = 0;
+   oWriter->uStamp = 0;
+   return oWriter;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ImageWriter_free(ImageWriter_T oWriter)
+{
+   assert(oWriter != NULL);
+
+   ChildSet_free(oWriter->oNamed);
+   free(oWriter->pcNames);
+   free(oWriter->puChildren);
+   free(oWriter->pNodes);
+   free(oWriter);
+}
+
+/*--------------------------------------------------------------------*/
+
+void ImageWriter_setStamp(ImageWriter_T oWriter, size_t uStamp)
+{
+   assert(oWriter != NULL);
+
+   oWriter->uStamp = uStamp;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the table of names of oWriter room for uLength more bytes, at
+   least doubling it if it must grow.  Return 1 (TRUE), or 0 (FALSE)
+   if insufficient memory is available. */
+
+static int ImageWriter_reserveNames(ImageWriter_T oWriter,
+                                    size_t uLength)
+{
+   char *pcGrown;
+   size_t uNewSize;
+
+   assert(oWriter != NULL);
+
+   if (oWriter->uNamesLength + uLength <= oWriter->uNamesSize)
+      return 1;
+   uNewSize = 2 * oWriter->uNamesSize;
+   if (uNewSize < oWriter->uNamesLength + uLength)
+      uNewSize = oWriter->uNamesLength + uLength;
+   pcGrown = (char*)realloc(oWriter->pcNames, uNewSize);
+   if (pcGrown == NULL)
+      return 0;
+   oWriter->pcNames = pcGrown;
+   oWriter->uNamesSize = uNewSize;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ImageWriter_add(ImageWriter_T oWriter, size_t uParent,
+                    const char *pcName, size_t uNameLength,
+                    size_t uChildren, size_t *puIndex)
+{
+   struct ImageNode *pNode;
+   const struct ImageNode *pNamed;
+
+   assert(oWriter != NULL);
+   assert(pcName != NULL);
+   assert(puIndex != NULL);
+   assert(oWriter->uAdded < oWriter->uNodes);
+   assert(oWriter->uAdded == 0 || uParent < oWriter->uAdded);
+
+   pNode = &oWriter->pNodes[oWriter->uAdded];
+
+   pNamed = (const struct ImageNode*)
+      ChildSet_find(oWriter->oNamed, pcName, uNameLength);
+   if (pNamed != NULL)
+      pNode->uName = pNamed->uName;
+   else
+   {
+      if (!ImageWriter_reserveNames(oWriter, uNameLength) ||
+          !ChildSet_add(oWriter->oNamed, pcName, uNameLength, pNode, 0))
+         return 0;
+      pNode->uName = oWriter->uNamesLength;
+      memcpy(oWriter->pcNames + oWriter->uNamesLength, pcName,
+             uNameLength);
+      oWriter->uNamesLength += uNameLength;
+   }
+   pNode->uNameLength = uNameLength;
+
+   if (oWriter->uAdded == 0)
+   {
+      pNode->uParent = 0;
+      pNode->uPathLength = uNameLength;
+   }
+   else
+   {
+      pNode->uParent = uParent;
+      pNode->uPathLength =
+         oWriter->pNodes[uParent].uPathLength + 1 + uNameLength;
+   }
+
+   pNode->uFirstChild = oWriter->uSlots;
+   pNode->uChildren = uChildren;
+   oWriter->uSlots += uChildren;
+   assert(oWriter->uSlots < oWriter->uNodes || uChildren == 0);
+
+   *puIndex = oWriter->uAdded;
+   oWriter->uAdded++;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the uLength bytes at pvBytes to the file descriptor iFd.
+   Return 1 (TRUE), or 0 (FALSE) if there is an error. */
+
+static int Image_writeAll(int iFd, const void *pvBytes, size_t uLength)
+{
+   const char *pcBytes = (const char*)pvBytes;
+   ssize_t iWritten;
+
+   while (uLength > 0)
+   {
+      iWritten = write(iFd, pcBytes, uLength);
+      if (iWritten < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         return 0;
+      }
+      pcBytes += iWritten;
+      uLength -= (size_t)iWritten;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ImageWriter_write(ImageWriter_T oWriter, int iFd)
+{
+   struct ImageHeader header;
+   struct ImageNode *pNodes;
+   struct ImageNode *pParent;
+   size_t u;
+
+   assert(oWriter != NULL);
+   assert(oWriter->uAdded == oWriter->uNodes);
+
+   pNodes = oWriter->pNodes;
+
+   /* fill in the table of children, in the order that the children
+      were added, counting each parent's so far in its uSize */
+   for (u = 0; u < oWriter->uNodes; u++)
+      pNodes[u].uSize = 0;
+   for (u = 1; u < oWriter->uNodes; u++)
+   {
+      pParent = &pNodes[pNodes[u].uParent];
+      oWriter->puChildren[pParent->uFirstChild + pParent->uSize] = u;
+      pParent->uSize++;
+   }
+
+   /* then the sizes, from the leaves up, since every node comes
+      after its parent */
+   for (u = 0; u < oWriter->uNodes; u++)
+   {
+      pNodes[u].uSize = 1;
+      pNodes[u].uBytes = pNodes[u].uPathLength + 1;
+   }
+   for (u = oWriter->uNodes; u > 1; u--)
+   {
+      pParent = &pNodes[pNodes[u - 1].uParent];
+      pParent->uSize += pNodes[u - 1].uSize;
+      pParent->uBytes += pNodes[u - 1].uBytes;
+   }
+
+   memset(&header, 0, sizeof(header));
+   memcpy(header.acMagic, acMAGIC, sizeof(acMAGIC));
+   header.uByteOrder = BYTE_ORDER_MARK;
+   header.uWordSize = sizeof(size_t);
+   header.uNodes = oWriter->uNodes;
+   header.uNamesLength = oWriter->uNamesLength;
+   header.uStamp = oWriter->uStamp;
+
+   return Image_writeAll(iFd, &header, sizeof(header)) &&
+      Image_writeAll(iFd, pNodes,
+                     sizeof(struct ImageNode) * oWriter->uNodes) &&
+      Image_writeAll(iFd, oWriter->puChildren,
+                     sizeof(size_t) * oWriter->uSlots) &&
+      Image_writeAll(iFd, oWriter->pcNames, oWriter->uNamesLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read the file descriptor iFd from its current offset to its end
+   into memory from malloc, and point oImage at it.  Return
+   IMAGE_OK, or why it failed. */
+
+static enum Image_Status Image_readAll(Image_T oImage, int iFd)
+{
+   char *pcBytes = NULL;
+   char *pcGrown;
+   size_t uLength = 0;
+   size_t uSize = 0;
+   ssize_t iRead;
+
+   assert(oImage != NULL);
+
+   for (;;)
+   {
+      if (uLength == uSize)
+      {
+         uSize = uSize == 0 ? 4096 : 2 * uSize;
+         pcGrown = (char*)realloc(pcBytes, uSize);
+         if (pcGrown == NULL)
+         {
+            free(pcBytes);
+            return IMAGE_MEMORY;
+         }
+         pcBytes = pcGrown;
+      }
+      iRead = read(iFd, pcBytes + uLength, uSize - uLength);
+      if (iRead == 0)
+         break;
+      if (iRead < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         free(pcBytes);
+         return IMAGE_IO;
+      }
+      uLength += (size_t)iRead;
+   }
+
+   oImage->pvMemory = pcBytes;
+   oImage->iMapped = 0;
+   oImage->pcBytes = pcBytes;
+   oImage->uLength = uLength;
+   return IMAGE_OK;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Point oImage at the file that the file descriptor iFd refers to,
+   from its current offset to its end, by mapping it into memory, and
+   move the offset to the end.  Return 1 (TRUE), or 0 (FALSE) if the
+   file cannot be mapped or its offset is not aligned for the
+   tables. */
+
+static int Image_mapAll(Image_T oImage, int iFd)
+{
+   struct stat fileStat;
+   off_t iOffset;
+   void *pvMap;
+
+   assert(oImage != NULL);
+
+   iOffset = lseek(iFd, 0, SEEK_CUR);
+   if (iOffset < 0 || (size_t)iOffset % sizeof(size_t) != 0 ||
+       fstat(iFd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode) ||
+       fileStat.st_size <= iOffset)
+      return 0;
+
+   pvMap = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE,
+                iFd, 0);
+   if (pvMap == MAP_FAILED)
+      return 0;
+   (void)lseek(iFd, 0, SEEK_END);
+
+   oImage->pvMemory = pvMap;
+   oImage->uMapLength = (size_t)fileStat.st_size;
+   oImage->iMapped = 1;
+   oImage->pcBytes = (const char*)pvMap + iOffset;
+   oImage->uLength = (size_t)(fileStat.st_size - iOffset);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Point the tables of oImage into its bytes, checking that the header
+   is of this machine's kind and that the tables fill the image
+   exactly.  Return 1 (TRUE), or 0 (FALSE) if they do not. */
+
+static int Image_parse(Image_T oImage)
+{
+   struct ImageHeader header;
+   size_t uLeft;
+
+   assert(oImage != NULL);
+
+   if (oImage->uLength < sizeof(header))
+      return 0;
+   memcpy(&header, oImage->pcBytes, sizeof(header));
+   if (memcmp(header.acMagic, acMAGIC, sizeof(acMAGIC)) != 0 ||
+       header.uByteOrder != BYTE_ORDER_MARK ||
+       header.uWordSize != sizeof(size_t))
+      return 0;
+
+   /* each table in turn must fit in what is left, without the sizes
+      overflowing */
+   uLeft = oImage->uLength - sizeof(header);
+   if (header.uNodes > uLeft / sizeof(struct ImageNode))
+      return 0;
+   uLeft -= header.uNodes * sizeof(struct ImageNode);
+   oImage->uNodes = header.uNodes;
+   oImage->uChildren = header.uNodes > 0 ? header.uNodes - 1 : 0;
+   if (oImage->uChildren > uLeft / sizeof(size_t))
+      return 0;
+   uLeft -= oImage->uChildren * sizeof(size_t);
+   if (header.uNamesLength != uLeft)
+      return 0;
+
+   oImage->pNodes = (const struct ImageNode*)
+      (oImage->pcBytes + sizeof(header));
+   oImage->puChildren = (const size_t*)(oImage->pNodes + oImage->uNodes);
+   oImage->pcNames = (const char*)(oImage->puChildren + oImage->uChildren);
+   oImage->uNamesLength = header.uNamesLength;
+   oImage->uStamp = header.uStamp;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+Image_T Image_map(int iFd, enum Image_Status *peStatus)
+{
+   Image_T oImage;
+   enum Image_Status eStatus;
+
+   assert(peStatus != NULL);
+
+   oImage = (Image_T)malloc(sizeof(struct Image));
+   if (oImage == NULL)
+   {
+      *peStatus = IMAGE_MEMORY;
+      return NULL;
+   }
+
+   if (!Image_mapAll(oImage, iFd))
+   {
+      eStatus = Image_readAll(oImage, iFd);
+      if (eStatus != IMAGE_OK)
+      {
+         free(oImage);
+         *peStatus = eStatus;
+         return NULL;
+      }
+   }
+
+   if (!Image_parse(oImage))
+   {
+      Image_free(oImage);
+      *peStatus = IMAGE_FORMAT;
+      return NULL;
+   }
+
+   *peStatus = IMAGE_OK;
+   return oImage;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Image_free(Image_T oImage)
+{
+   assert(oImage != NULL);
+
+   if (oImage->iMapped)
+      (void)munmap(oImage->pvMemory, oImage->uMapLength);
+   else
+      free(oImage->pvMemory);
+   free(oImage);
+}
+
+/*--------------------------------------------------------------------*/
+
+int Image_check(Image_T oImage)
+{
+   const struct ImageNode *pNode;
+   const struct ImageNode *pChild;
+   const struct ImageNode *pPrev;
+   const char *pcName;
+   const char *pcPrevName = NULL;
+   size_t uNext;
+   size_t uBytes;
+   size_t u;
+   size_t v;
+
+   assert(oImage != NULL);
+
+   if (oImage->uNodes == 0)
+      return oImage->uNamesLength == 0;
+   if (oImage->pNodes[0].uSize != oImage->uNodes)
+      return 0;
+
+   for (u = 0; u < oImage->uNodes; u++)
+   {
+      pNode = &oImage->pNodes[u];
+
+      pcName = Image_getName(oImage, pNode);
+      if (pcName == NULL || pNode->uNameLength == 0 ||
+          Path_findSeparator(pcName, pNode->uNameLength) != NULL)
+         return 0;
+      if (u == 0 ? pNode->uParent != 0 ||
+                   pNode->uPathLength != pNode->uNameLength
+                 : pNode->uParent >= u ||
+                   pNode->uPathLength !=
+                   oImage->pNodes[pNode->uParent].uPathLength + 1 +
+                   pNode->uNameLength)
+         return 0;
+      if (pNode->uFirstChild > oImage->uChildren ||
+          pNode->uChildren > oImage->uChildren - pNode->uFirstChild ||
+          pNode->uSize == 0 || pNode->uSize > oImage->uNodes - u)
+         return 0;
+
+      /* the children come in order of name, each hierarchy right
+         after the one before, and they make up the rest of this
+         node's */
+      uNext = u + 1;
+      uBytes = pNode->uPathLength + 1;
+      pPrev = NULL;
+      for (v = 0; v < pNode->uChildren; v++)
+      {
+         if (uNext >= u + pNode->uSize ||
+             oImage->puChildren[pNode->uFirstChild + v] != uNext)
+            return 0;
+         pChild = &oImage->pNodes[uNext];
+         pcName = Image_getName(oImage, pChild);
+         if (pcName == NULL || pChild->uParent != u ||
+             pChild->uSize > pNode->uSize ||
+             (pPrev != NULL &&
+              Image_compareNames(pcPrevName, pPrev->uNameLength,
+                                 pcName, pChild->uNameLength) >= 0))
+            return 0;
+         uNext += pChild->uSize;
+         uBytes += pChild->uBytes;
+         if (uNext > u + pNode->uSize || uBytes < pChild->uBytes)
+            return 0;
+         pPrev = pChild;
+         pcPrevName = pcName;
+      }
+      if (uNext != u + pNode->uSize || uBytes != pNode->uBytes)
+         return 0;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Image_getLength(Image_T oImage)
+{
+   assert(oImage != NULL);
+
+   return oImage->uNodes;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Image_getStamp(Image_T oImage)
+{
+   assert(oImage != NULL);
+
+   return oImage->uStamp;
+}
+
+/*--------------------------------------------------------------------*/
+
+const struct ImageNode *Image_getNode(Image_T oImage, size_t uIndex)
+{
+   assert(oImage != NULL);
+
+   if (uIndex >= oImage->uNodes)
+      return NULL;
+   return &oImage->pNodes[uIndex];
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *Image_getName(Image_T oImage,
+                          const struct ImageNode *pNode)
+{
+   assert(oImage != NULL);
+   assert(pNode != NULL);
+
+   if (pNode->uName > oImage->uNamesLength ||
+       pNode->uNameLength > oImage->uNamesLength - pNode->uName)
+      return NULL;
+   return oImage->pcNames + pNode->uName;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if the node whose record is pNode in oImage has a
+   child whose name is the uLength bytes at pcName, assigning the
+   child's index to *puIndex, or 0 (FALSE) if not. */
+
+static int Image_findChild(Image_T oImage, const struct ImageNode *pNode,
+                           const char *pcName, size_t uLength,
+                           size_t *puIndex)
+{
+   const struct ImageNode *pChild;
+   const char *pcChildName;
+   size_t uLow;
+   size_t uHigh;
+   size_t uMid;
+   int iCompare;
+
+   assert(oImage != NULL);
+   assert(pNode != NULL);
+   assert(puIndex != NULL);
+
+   if (pNode->uFirstChild > oImage->uChildren ||
+       pNode->uChildren > oImage->uChildren - pNode->uFirstChild)
+      return 0;
+
+   uLow = 0;
+   uHigh = pNode->uChildren;
+   while (uLow < uHigh)
+   {
+      uMid = uLow + (uHigh - uLow) / 2;
+      pChild = Image_getNode(oImage,
+                             oImage->puChildren[pNode->uFirstChild + uMid]);
+      if (pChild == NULL)
+         return 0;
+      pcChildName = Image_getName(oImage, pChild);
+      if (pcChildName == NULL)
+         return 0;
+      iCompare = Image_compareNames(pcName, uLength, pcChildName,
+                                    pChild->uNameLength);
+      if (iCompare == 0)
+      {
+         *puIndex = oImage->puChildren[pNode->uFirstChild + uMid];
+         return 1;
+      }
+      if (iCompare < 0)
+         uHigh = uMid;
+      else
+         uLow = uMid + 1;
+   }
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Image_find(Image_T oImage, const char *pcPath, size_t uLength,
+               size_t *puIndex)
+{
+   const struct ImageNode *pNode;
+   const char *pcName;
+   const char *pcComponent;
+   size_t uComponentLength;
+   size_t uOffset;
+   size_t uIndex = 0;
+
+   assert(oImage != NULL);
+   assert(pcPath != NULL);
+   assert(puIndex != NULL);
+
+   pNode = Image_getNode(oImage, 0);
+   if (pNode == NULL)
+      return 0;
+   pcName = Image_getName(oImage, pNode);
+   if (pcName == NULL ||
+       !Path_hasPrefix(pcPath, uLength, pcName, pNode->uNameLength))
+      return 0;
+
+   uOffset = pNode->uNameLength + 1;
+   while (Path_nextComponent(pcPath, uLength, &uOffset, &pcComponent,
+                             &uComponentLength))
+   {
+      if (!Image_findChild(oImage, pNode, pcComponent, uComponentLength,
+                           &uIndex))
+         return 0;
+      pNode = &oImage->pNodes[uIndex];
+   }
+
+   *puIndex = uIndex;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the path of the node at index uIndex of oImage, whose record
+   says that it is uLength bytes long, to the uLength bytes at pcPath,
+   following its parents up to the root.  Return 1 (TRUE), or
+   0 (FALSE) if the records are corrupt. */
+
+static int Image_writePath(Image_T oImage, size_t uIndex, char *pcPath,
+                           size_t uLength)
+{
+   const struct ImageNode *pNode;
+   const char *pcName;
+
+   assert(oImage != NULL);
+   assert(pcPath != NULL);
+
+   for (;;)
+   {
+      pNode = Image_getNode(oImage, uIndex);
+      if (pNode == NULL)
+         return 0;
+      pcName = Image_getName(oImage, pNode);
+      if (pcName == NULL || pNode->uPathLength != uLength ||
+          pNode->uNameLength > uLength)
+         return 0;
+      memcpy(pcPath + uLength - pNode->uNameLength, pcName,
+             pNode->uNameLength);
+      uLength -= pNode->uNameLength;
+      if (uIndex == 0)
+         return uLength == 0;
+      if (uLength == 0 || pNode->uParent >= uIndex)
+         return 0;
+      pcPath[--uLength] = '/';
+      uIndex = pNode->uParent;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+char *Image_list(Image_T oImage, size_t uIndex, size_t uOffset,
+                 size_t uLimit)
+{
+   const struct ImageNode *pNode;
+   const struct ImageNode *pParent;
+   const char *pcName;
+   char *pcResult;
+   char *pcLine;
+   char *pcPrev = NULL;
+   size_t uPrevLength = 0;
+   size_t uFirst;
+   size_t uEnd;
+   size_t uTotal = 1;
+   size_t u;
+
+   assert(oImage != NULL);
+
+   pNode = Image_getNode(oImage, uIndex);
+   if (pNode == NULL || pNode->uSize > oImage->uNodes - uIndex)
+      return NULL;
+
+   /* the page is a run of the table, since it is in pre-order */
+   if (uOffset > pNode->uSize)
+      uOffset = pNode->uSize;
+   if (uLimit > pNode->uSize - uOffset)
+      uLimit = pNode->uSize - uOffset;
+   uFirst = uIndex + uOffset;
+   uEnd = uFirst + uLimit;
+
+   for (u = uFirst; u < uEnd; u++)
+      uTotal += oImage->pNodes[u].uPathLength + 1;
+   pcResult = (char*)malloc(uTotal);
+   if (pcResult == NULL)
+      return NULL;
+
+   /* each path after the first is its parent's, which is the one
+      before it or begins it, and the node's own name */
+   pcLine = pcResult;
+   for (u = uFirst; u < uEnd; u++)
+   {
+      pNode = &oImage->pNodes[u];
+      if (u == uFirst)
+      {
+         if (!Image_writePath(oImage, u, pcLine, pNode->uPathLength))
+         {
+            free(pcResult);
+            return NULL;
+         }
+      }
+      else
+      {
+         pParent = Image_getNode(oImage, pNode->uParent);
+         pcName = Image_getName(oImage, pNode);
+         if (pParent == NULL || pcName == NULL ||
+             pParent->uPathLength > uPrevLength ||
+             (pParent->uPathLength < uPrevLength &&
+              pcPrev[pParent->uPathLength] != '/') ||
+             pNode->uPathLength !=
+             pParent->uPathLength + 1 + pNode->uNameLength)
+         {
+            free(pcResult);
+            return NULL;
+         }
+         memcpy(pcLine, pcPrev, pParent->uPathLength);
+         pcLine[pParent->uPathLength] = '/';
+         memcpy(pcLine + pParent->uPathLength + 1, pcName,
+                pNode->uNameLength);
+      }
+      pcPrev = pcLine;
+      uPrevLength = pNode->uPathLength;
+      pcLine += pNode->uPathLength;
+      *pcLine++ = '\n';
+   }
+   *pcLine = '\0';
+   return pcResult;
+}
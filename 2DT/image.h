@@ -0,0 +1,176 @@
+/*--------------------------------------------------------------------*/
+/* image.h                                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef IMAGE_INCLUDED
+#define IMAGE_INCLUDED
+
+#include <stddef.h>
+
+/* An image is a tree of named nodes saved in a binary format that can
+   be read in place, straight from a mapping of the file, without
+   being parsed.  It holds a header, then a table of the nodes in
+   pre-order, so that the hierarchy rooted at any node is the nodes
+   from it on for as many as it holds, then a table of the indices of
+   each node's children, in sorted order, contiguous for each node,
+   then a table of the nodes' names, each of which is stored once
+   however many nodes have it.  The header also carries a stamp, a
+   number that the writer chooses to tell images apart.  All of them are in the machine's own
+   byte order and word size, which the header records, so an image
+   can only be read on the kind of machine that wrote it. */
+
+typedef struct Image *Image_T;
+
+/* An ImageWriter_T object gathers the nodes of a tree, in pre-order,
+   to write them as an image. */
+
+typedef struct ImageWriter *ImageWriter_T;
+
+/* The record of a node in an image.  The root is at index 0. */
+
+struct ImageNode
+{
+   /* The index of the node's parent, or 0 for the root itself. */
+   size_t uParent;
+
+   /* The offset of the node's name in the table of names, and its
+      length. */
+   size_t uName;
+   size_t uNameLength;
+
+   /* The length of the node's path: its ancestors' names and its own,
+      each but the root's after a slash. */
+   size_t uPathLength;
+
+   /* The position of the index of the node's first child in the table
+      of children, and the number of its children. */
+   size_t uFirstChild;
+   size_t uChildren;
+
+   /* The number of nodes in the hierarchy rooted at the node, and the
+      total length of their paths, counting one more byte for each. */
+   size_t uSize;
+   size_t uBytes;
+};
+
+/* The ways in which reading an image can fail. */
+
+enum Image_Status { IMAGE_OK, IMAGE_MEMORY, IMAGE_IO, IMAGE_FORMAT };
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new ImageWriter_T object for a tree of uNodes nodes, or
+   NULL if insufficient memory is available. */
+
+ImageWriter_T ImageWriter_new(size_t uNodes);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oWriter. */
+
+void ImageWriter_free(ImageWriter_T oWriter);
+
+/*--------------------------------------------------------------------*/
+
+/* Add to oWriter the next node in pre-order, whose name is the
+   uNameLength bytes at pcName, with uChildren children, and whose
+   parent is the node at index uParent (which is ignored for the
+   root).  The name must stay valid and unchanged until oWriter is
+   freed.  Assign the node's index to *puIndex.  Return 1 (TRUE), or
+   0 (FALSE) if insufficient memory is available. */
+
+int ImageWriter_add(ImageWriter_T oWriter, size_t uParent,
+                    const char *pcName, size_t uNameLength,
+                    size_t uChildren, size_t *puIndex);
+
+/*--------------------------------------------------------------------*/
+
+/* Set the stamp that oWriter writes in the header of the image to
+   uStamp, rather than 0. */
+
+void ImageWriter_setStamp(ImageWriter_T oWriter, size_t uStamp);
+
+/*--------------------------------------------------------------------*/
+
+/* Write the image of the nodes of oWriter, all of which must have
+   been added, to the file descriptor iFd.  Return 1 (TRUE), or
+   0 (FALSE) if there is an error writing it. */
+
+int ImageWriter_write(ImageWriter_T oWriter, int iFd);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new Image_T object for the image in the file that the
+   file descriptor iFd refers to, from its current offset to its end,
+   mapping it into memory if possible and reading it in otherwise.
+   Only the header and the sizes of the tables are checked.  Return
+   NULL, and assign why to *peStatus, if the file cannot be read, is
+   not an image of this machine's kind, or insufficient memory is
+   available. */
+
+Image_T Image_map(int iFd, enum Image_Status *peStatus);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oImage, unmapping its file. */
+
+void Image_free(Image_T oImage);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if every record of oImage is consistent with the
+   others, as for a tree that ImageWriter_write wrote, so that the
+   functions below never fail on it, or 0 (FALSE) if not.  This costs
+   time proportional to the size of the image. */
+
+int Image_check(Image_T oImage);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of nodes in oImage. */
+
+size_t Image_getLength(Image_T oImage);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the stamp of oImage. */
+
+size_t Image_getStamp(Image_T oImage);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the record of the node at index uIndex in oImage, or NULL
+   if there is no such node. */
+
+const struct ImageNode *Image_getNode(Image_T oImage, size_t uIndex);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the name of the node whose record is pNode in oImage, or
+   NULL if the record is corrupt.  The name is not NUL-terminated. */
+
+const char *Image_getName(Image_T oImage,
+                          const struct ImageNode *pNode);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if oImage holds the node whose path is the
+   uLength bytes at pcPath, assigning its index to *puIndex, or
+   0 (FALSE) if not.  Each component costs a binary search among the
+   children of the node before it. */
+
+int Image_find(Image_T oImage, const char *pcPath, size_t uLength,
+               size_t *puIndex);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new string of the paths, each followed by a newline, of
+   at most uLimit nodes of the hierarchy rooted at the node at index
+   uIndex in oImage, in pre-order, starting from the one at position
+   uOffset in that order, or NULL if insufficient memory is available
+   or the image is corrupt.  The caller owns the string. */
+
+char *Image_list(Image_T oImage, size_t uIndex, size_t uOffset,
+                 size_t uLimit);
+
+#endif
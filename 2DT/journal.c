@@ -0,0 +1,781 @@
+/*--------------------------------------------------------------------*/
+/* journal.c                                                          */
+/*--------------------------------------------------------------------*/
+
+/* for clock_gettime, fsync, ftruncate and the thread interface */
+#define _POSIX_C_SOURCE 200112L
+
+#include "journal.h"
+#include "bloom.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The first bytes of every journal, the last of which is the version
+   of the format. */
+
+static const char acMAGIC[8] = { 'D', 'T', 'J', 'O', 'U', 'R', 'N', 1 };
+
+/* A value whose bytes come out in another order on a machine of
+   another byte order. */
+
+static const size_t BYTE_ORDER_MARK = 0x01020304;
+
+/*--------------------------------------------------------------------*/
+
+/* The header at the start of a journal. */
+
+struct JournalHeader
+{
+   /* acMAGIC. */
+   char acMagic[8];
+
+   /* BYTE_ORDER_MARK and sizeof(size_t) as the writer had them. */
+   size_t uByteOrder;
+   size_t uWordSize;
+};
+
+/* The header of a record, which its first and second strings follow,
+   each with a '\0' after it. */
+
+struct JournalRecordHeader
+{
+   size_t uSequence;
+   size_t uKind;
+   size_t uFirstLength;
+   size_t uSecondLength;
+
+   /* The Bloom_hash of the header, with this 0, and the strings. */
+   size_t uCheck;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A Journal is a journal file and the records waiting to go in it,
+   with, if it has a window, the thread that writes them out once the
+   window has passed.  The thread and the caller share everything from
+   uWritten to tFirst, under sLock. */
+
+struct Journal
+{
+   /* The file, and the number of microseconds that a record waits to
+      be synchronized. */
+   int iFd;
+   size_t uWindow;
+
+   /* The length of the file, as far as the journal has written it,
+      which is also the position of the first record in the buffer. */
+   size_t uWritten;
+
+   /* The records not yet written, in a buffer of uPendingSize
+      bytes. */
+   char *pcPending;
+   size_t uPendingLength;
+   size_t uPendingSize;
+
+   /* The position before which the records may be written once they
+      are due, which Journal_syncIfDue moves up. */
+   size_t uReady;
+
+   /* 1 (TRUE) if some of the records before uReady are not yet
+      synchronized, the oldest of which was made ready at tFirst. */
+   int iWaiting;
+   struct timespec tFirst;
+
+   /* 1 (TRUE) if the journal has a window, and so the thread, which
+      waits on sWake for records to be made ready or for iStop to be
+      set. */
+   int iFlusher;
+   pthread_t sFlusher;
+   pthread_mutex_t sLock;
+   pthread_cond_t sWake;
+   int iStop;
+
+   /* The sequence number of the latest record. */
+   size_t uSequence;
+
+   /* The records that were in the file when it was opened, from
+      uReplayOffset on, for Journal_next, or NULL once they have all
+      been read. */
+   char *pcReplay;
+   size_t uReplayLength;
+   size_t uReplayOffset;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Write the uLength bytes at pvBytes to the file descriptor iFd.
+   Return 1 (TRUE), or 0 (FALSE) if there is an error. */
+
+static int Journal_writeAll(int iFd, const void *pvBytes, size_t uLength)
+{
+   const char *pcBytes = (const char*)pvBytes;
+   ssize_t iWritten;
+
+   while (uLength > 0)
+   {
+      iWritten = write(iFd, pcBytes, uLength);
+      if (iWritten < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         return 0;
+      }
+      pcBytes += iWritten;
+      uLength -= (size_t)iWritten;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read the whole of the file that the file descriptor iFd refers to
+   into a new buffer from malloc, assigning it to *ppcBytes and its
+   length to *puLength.  Return JOURNAL_OK, or why it failed. */
+
+static enum Journal_Status Journal_readAll(int iFd, char **ppcBytes,
+                                           size_t *puLength)
+{
+   char *pcBytes = NULL;
+   char *pcGrown;
+   size_t uLength = 0;
+   size_t uSize = 0;
+   ssize_t iRead;
+
+   assert(ppcBytes != NULL);
+   assert(puLength != NULL);
+
+   if (lseek(iFd, 0, SEEK_SET) != 0)
+      return JOURNAL_IO;
+   for (;;)
+   {
+      if (uLength == uSize)
+      {
+         uSize = uSize == 0 ? 4096 : 2 * uSize;
+         pcGrown = (char*)realloc(pcBytes, uSize);
+         if (pcGrown == NULL)
+         {
+            free(pcBytes);
+            return JOURNAL_MEMORY;
+         }
+         pcBytes = pcGrown;
+      }
+      iRead = read(iFd, pcBytes + uLength, uSize - uLength);
+      if (iRead == 0)
+         break;
+      if (iRead < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         free(pcBytes);
+         return JOURNAL_IO;
+      }
+      uLength += (size_t)iRead;
+   }
+
+   *ppcBytes = pcBytes;
+   *puLength = uLength;
+   return JOURNAL_OK;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Assign to *pHeader the header of a journal of this machine's
+   kind. */
+
+static void Journal_makeHeader(struct JournalHeader *pHeader)
+{
+   assert(pHeader != NULL);
+
+   memset(pHeader, 0, sizeof(*pHeader));
+   memcpy(pHeader->acMagic, acMAGIC, sizeof(acMAGIC));
+   pHeader->uByteOrder = BYTE_ORDER_MARK;
+   pHeader->uWordSize = sizeof(size_t);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the checksum of the record whose header is *pHeader and
+   whose strings, with a '\0' after each, are the bytes at
+   pcStrings. */
+
+static size_t Journal_check(const struct JournalRecordHeader *pHeader,
+                            const char *pcStrings)
+{
+   struct JournalRecordHeader header;
+
+   assert(pHeader != NULL);
+   assert(pcStrings != NULL);
+
+   header = *pHeader;
+   header.uCheck = 0;
+   return Bloom_hashMore(Bloom_hash((const char*)&header, sizeof(header)),
+                         pcStrings,
+                         header.uFirstLength + header.uSecondLength + 2);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the length of the record at offset uOffset of the uLength
+   bytes at pcBytes, which follows the record numbered uSequence
+   (or any record if uSequence is 0), or 0 if there is no whole,
+   intact record there that does. */
+
+static size_t Journal_parseRecord(const char *pcBytes, size_t uLength,
+                                  size_t uOffset, size_t uSequence)
+{
+   struct JournalRecordHeader header;
+   const char *pcStrings;
+   size_t uLeft;
+
+   assert(pcBytes != NULL);
+   assert(uOffset <= uLength);
+
+   uLeft = uLength - uOffset;
+   if (uLeft < sizeof(header))
+      return 0;
+   memcpy(&header, pcBytes + uOffset, sizeof(header));
+   uLeft -= sizeof(header);
+   if (header.uFirstLength >= uLeft ||
+       header.uSecondLength >= uLeft - header.uFirstLength - 1)
+      return 0;
+   pcStrings = pcBytes + uOffset + sizeof(header);
+   if (pcStrings[header.uFirstLength] != '\0' ||
+       pcStrings[header.uFirstLength + 1 + header.uSecondLength] != '\0' ||
+       (uSequence != 0 && header.uSequence != uSequence + 1) ||
+       header.uSequence == 0 ||
+       Journal_check(&header, pcStrings) != header.uCheck)
+      return 0;
+   return sizeof(header) + header.uFirstLength + header.uSecondLength + 2;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read the file of oJournal, keeping its whole records for
+   Journal_next and cutting off anything after them, or writing a
+   header if the file is empty or holds only part of one.  Return
+   JOURNAL_OK, or why it failed. */
+
+static enum Journal_Status Journal_load(Journal_T oJournal)
+{
+   struct JournalHeader header;
+   struct JournalRecordHeader record;
+   enum Journal_Status eStatus;
+   char *pcBytes;
+   size_t uLength;
+   size_t uOffset;
+   size_t uRecord;
+
+   assert(oJournal != NULL);
+
+   eStatus = Journal_readAll(oJournal->iFd, &pcBytes, &uLength);
+   if (eStatus != JOURNAL_OK)
+      return eStatus;
+
+   Journal_makeHeader(&header);
+   if (uLength < sizeof(header))
+   {
+      /* a crash while the journal was being started */
+      if (memcmp(pcBytes, &header, uLength) != 0)
+      {
+         free(pcBytes);
+         return JOURNAL_IO;
+      }
+      free(pcBytes);
+      if (ftruncate(oJournal->iFd, 0) != 0 ||
+          lseek(oJournal->iFd, 0, SEEK_SET) != 0 ||
+          !Journal_writeAll(oJournal->iFd, &header, sizeof(header)) ||
+          fsync(oJournal->iFd) != 0)
+         return JOURNAL_IO;
+      oJournal->uWritten = sizeof(header);
+      return JOURNAL_OK;
+   }
+   if (memcmp(pcBytes, &header, sizeof(header)) != 0)
+   {
+      free(pcBytes);
+      return JOURNAL_IO;
+   }
+
+   uOffset = sizeof(header);
+   for (;;)
+   {
+      uRecord = Journal_parseRecord(pcBytes, uLength, uOffset,
+                                    oJournal->uSequence);
+      if (uRecord == 0)
+         break;
+      memcpy(&record, pcBytes + uOffset, sizeof(record));
+      oJournal->uSequence = record.uSequence;
+      uOffset += uRecord;
+   }
+
+   /* a record torn by a crash, which was never synchronized, and so
+      never reported as written */
+   if (uOffset < uLength &&
+       (ftruncate(oJournal->iFd, (off_t)uOffset) != 0 ||
+        fsync(oJournal->iFd) != 0))
+   {
+      free(pcBytes);
+      return JOURNAL_IO;
+   }
+
+   oJournal->uWritten = uOffset;
+   oJournal->pcReplay = pcBytes;
+   oJournal->uReplayLength = uOffset;
+   oJournal->uReplayOffset = sizeof(header);
+   return JOURNAL_OK;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Lock oJournal against its thread, if it has one. */
+
+static void Journal_lock(Journal_T oJournal)
+{
+   assert(oJournal != NULL);
+
+   if (oJournal->iFlusher)
+      (void)pthread_mutex_lock(&oJournal->sLock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Unlock oJournal, which Journal_lock locked. */
+
+static void Journal_unlock(Journal_T oJournal)
+{
+   assert(oJournal != NULL);
+
+   if (oJournal->iFlusher)
+      (void)pthread_mutex_unlock(&oJournal->sLock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the position in oJournal after its latest record, with
+   oJournal locked. */
+
+static size_t Journal_getEndLocked(Journal_T oJournal)
+{
+   assert(oJournal != NULL);
+
+   return oJournal->uWritten + oJournal->uPendingLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the records of oJournal before position uEnd that are still
+   in its buffer, and synchronize the file with the disk, with
+   oJournal locked, as Journal_sync does. */
+
+static int Journal_write(Journal_T oJournal, size_t uEnd)
+{
+   size_t uLength;
+
+   assert(oJournal != NULL);
+   assert(uEnd >= oJournal->uWritten);
+   assert(uEnd <= Journal_getEndLocked(oJournal));
+
+   uLength = uEnd - oJournal->uWritten;
+   if (uLength == 0)
+      return 1;
+
+   /* a write that fails part of the way is cut off again, so that the
+      next attempt does not leave a torn record before it */
+   if (lseek(oJournal->iFd, (off_t)oJournal->uWritten, SEEK_SET) < 0 ||
+       !Journal_writeAll(oJournal->iFd, oJournal->pcPending, uLength) ||
+       fsync(oJournal->iFd) != 0)
+   {
+      (void)ftruncate(oJournal->iFd, (off_t)oJournal->uWritten);
+      return 0;
+   }
+
+   oJournal->uWritten += uLength;
+   oJournal->uPendingLength -= uLength;
+   memmove(oJournal->pcPending, oJournal->pcPending + uLength,
+           oJournal->uPendingLength);
+   if (oJournal->uReady < oJournal->uWritten)
+      oJournal->uReady = oJournal->uWritten;
+   if (oJournal->uReady == oJournal->uWritten)
+      oJournal->iWaiting = 0;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The thread of the Journal pvJournal: writes out and synchronizes
+   the records made ready once the oldest of them has waited the
+   window, until the journal is freed.  Return NULL. */
+
+static void *Journal_flush(void *pvJournal)
+{
+   Journal_T oJournal = (Journal_T)pvJournal;
+   struct timespec tDue;
+   struct timespec tNow;
+
+   assert(oJournal != NULL);
+
+   (void)pthread_mutex_lock(&oJournal->sLock);
+   while (!oJournal->iStop)
+   {
+      if (!oJournal->iWaiting)
+      {
+         (void)pthread_cond_wait(&oJournal->sWake, &oJournal->sLock);
+         continue;
+      }
+      tDue.tv_sec = oJournal->tFirst.tv_sec +
+         (time_t)(oJournal->uWindow / 1000000);
+      tDue.tv_nsec = oJournal->tFirst.tv_nsec +
+         (long)(oJournal->uWindow % 1000000) * 1000;
+      if (tDue.tv_nsec >= 1000000000)
+      {
+         tDue.tv_sec++;
+         tDue.tv_nsec -= 1000000000;
+      }
+      (void)clock_gettime(CLOCK_MONOTONIC, &tNow);
+      if (tNow.tv_sec < tDue.tv_sec ||
+          (tNow.tv_sec == tDue.tv_sec && tNow.tv_nsec < tDue.tv_nsec))
+      {
+         (void)pthread_cond_timedwait(&oJournal->sWake, &oJournal->sLock,
+                                      &tDue);
+         continue;
+      }
+
+      /* a failure leaves the records for another attempt a window
+         later, or for Journal_sync to report */
+      if (!Journal_write(oJournal, oJournal->uReady))
+         oJournal->tFirst = tNow;
+   }
+   (void)pthread_mutex_unlock(&oJournal->sLock);
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Start the thread of oJournal, whose condition waits by the
+   monotonic clock, as tFirst is taken.  Return 1 (TRUE), or
+   0 (FALSE) if it cannot be started. */
+
+static int Journal_startFlusher(Journal_T oJournal)
+{
+   pthread_condattr_t sAttr;
+   int iOk;
+
+   assert(oJournal != NULL);
+
+   if (pthread_mutex_init(&oJournal->sLock, NULL) != 0)
+      return 0;
+   iOk = pthread_condattr_init(&sAttr) == 0;
+   if (iOk)
+   {
+      iOk = pthread_condattr_setclock(&sAttr, CLOCK_MONOTONIC) == 0 &&
+         pthread_cond_init(&oJournal->sWake, &sAttr) == 0;
+      (void)pthread_condattr_destroy(&sAttr);
+   }
+   if (!iOk)
+   {
+      (void)pthread_mutex_destroy(&oJournal->sLock);
+      return 0;
+   }
+   if (pthread_create(&oJournal->sFlusher, NULL, Journal_flush,
+                      oJournal) != 0)
+   {
+      (void)pthread_cond_destroy(&oJournal->sWake);
+      (void)pthread_mutex_destroy(&oJournal->sLock);
+      return 0;
+   }
+   oJournal->iFlusher = 1;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+Journal_T Journal_open(int iFd, size_t uWindow,
+                       enum Journal_Status *peStatus)
+{
+   Journal_T oJournal;
+   enum Journal_Status eStatus;
+
+   assert(peStatus != NULL);
+
+   oJournal = (Journal_T)malloc(sizeof(struct Journal));
+   if (oJournal == NULL)
+   {
+      *peStatus = JOURNAL_MEMORY;
+      return NULL;
+   }
+   oJournal->iFd = iFd;
+   oJournal->uWindow = uWindow;
+   oJournal->uWritten = 0;
+   oJournal->pcPending = NULL;
+   oJournal->uPendingLength = 0;
+   oJournal->uPendingSize = 0;
+   oJournal->uReady = 0;
+   oJournal->iWaiting = 0;
+   oJournal->iFlusher = 0;
+   oJournal->iStop = 0;
+   oJournal->uSequence = 0;
+   oJournal->pcReplay = NULL;
+   oJournal->uReplayLength = 0;
+   oJournal->uReplayOffset = 0;
+
+   eStatus = Journal_load(oJournal);
+   if (eStatus == JOURNAL_OK)
+   {
+      oJournal->uReady = oJournal->uWritten;
+      if (uWindow > 0 && !Journal_startFlusher(oJournal))
+      {
+         free(oJournal->pcReplay);
+         eStatus = JOURNAL_MEMORY;
+      }
+   }
+   if (eStatus != JOURNAL_OK)
+   {
+      free(oJournal);
+      *peStatus = eStatus;
+      return NULL;
+   }
+
+   *peStatus = JOURNAL_OK;
+   return oJournal;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Journal_free(Journal_T oJournal)
+{
+   assert(oJournal != NULL);
+
+   if (oJournal->iFlusher)
+   {
+      (void)pthread_mutex_lock(&oJournal->sLock);
+      oJournal->iStop = 1;
+      (void)pthread_cond_signal(&oJournal->sWake);
+      (void)pthread_mutex_unlock(&oJournal->sLock);
+      (void)pthread_join(oJournal->sFlusher, NULL);
+      (void)pthread_cond_destroy(&oJournal->sWake);
+      (void)pthread_mutex_destroy(&oJournal->sLock);
+   }
+   free(oJournal->pcReplay);
+   free(oJournal->pcPending);
+   free(oJournal);
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_next(Journal_T oJournal, struct Journal_Record *pRecord)
+{
+   struct JournalRecordHeader header;
+   const char *pcStrings;
+
+   assert(oJournal != NULL);
+   assert(pRecord != NULL);
+
+   if (oJournal->pcReplay == NULL)
+      return 0;
+   if (oJournal->uReplayOffset == oJournal->uReplayLength)
+   {
+      free(oJournal->pcReplay);
+      oJournal->pcReplay = NULL;
+      return 0;
+   }
+
+   /* Journal_load checked every record */
+   memcpy(&header, oJournal->pcReplay + oJournal->uReplayOffset,
+          sizeof(header));
+   pcStrings = oJournal->pcReplay + oJournal->uReplayOffset +
+      sizeof(header);
+   pRecord->uSequence = header.uSequence;
+   pRecord->iKind = (int)header.uKind;
+   pRecord->pcFirst = pcStrings;
+   pRecord->uFirstLength = header.uFirstLength;
+   pRecord->pcSecond = pcStrings + header.uFirstLength + 1;
+   pRecord->uSecondLength = header.uSecondLength;
+   oJournal->uReplayOffset += sizeof(header) + header.uFirstLength +
+      header.uSecondLength + 2;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Journal_getSequence(Journal_T oJournal)
+{
+   assert(oJournal != NULL);
+
+   return oJournal->uSequence;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Journal_setSequence(Journal_T oJournal, size_t uSequence)
+{
+   assert(oJournal != NULL);
+   assert(uSequence >= oJournal->uSequence);
+
+   oJournal->uSequence = uSequence;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_append(Journal_T oJournal, int iKind,
+                   const char *pcFirst, size_t uFirstLength,
+                   const char *pcSecond, size_t uSecondLength)
+{
+   struct JournalRecordHeader header;
+   char *pcRecord;
+   char *pcGrown;
+   size_t uLength;
+   size_t uNewSize;
+
+   assert(oJournal != NULL);
+   assert(pcFirst != NULL);
+   assert(pcSecond != NULL);
+
+   Journal_lock(oJournal);
+   uLength = sizeof(header) + uFirstLength + uSecondLength + 2;
+   if (oJournal->uPendingLength + uLength > oJournal->uPendingSize)
+   {
+      uNewSize = 2 * oJournal->uPendingSize;
+      if (uNewSize < oJournal->uPendingLength + uLength)
+         uNewSize = oJournal->uPendingLength + uLength;
+      pcGrown = (char*)realloc(oJournal->pcPending, uNewSize);
+      if (pcGrown == NULL)
+      {
+         Journal_unlock(oJournal);
+         return 0;
+      }
+      oJournal->pcPending = pcGrown;
+      oJournal->uPendingSize = uNewSize;
+   }
+
+   pcRecord = oJournal->pcPending + oJournal->uPendingLength;
+   memset(&header, 0, sizeof(header));
+   header.uSequence = oJournal->uSequence + 1;
+   header.uKind = (size_t)iKind;
+   header.uFirstLength = uFirstLength;
+   header.uSecondLength = uSecondLength;
+   memcpy(pcRecord + sizeof(header), pcFirst, uFirstLength);
+   pcRecord[sizeof(header) + uFirstLength] = '\0';
+   memcpy(pcRecord + sizeof(header) + uFirstLength + 1, pcSecond,
+          uSecondLength);
+   pcRecord[uLength - 1] = '\0';
+   header.uCheck = Journal_check(&header, pcRecord + sizeof(header));
+   memcpy(pcRecord, &header, sizeof(header));
+
+   oJournal->uPendingLength += uLength;
+   oJournal->uSequence++;
+   Journal_unlock(oJournal);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Journal_getEnd(Journal_T oJournal)
+{
+   size_t uEnd;
+
+   assert(oJournal != NULL);
+
+   Journal_lock(oJournal);
+   uEnd = oJournal->uWritten + oJournal->uPendingLength;
+   Journal_unlock(oJournal);
+   return uEnd;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Journal_rollback(Journal_T oJournal, size_t uMark)
+{
+   struct JournalRecordHeader header;
+   size_t uOffset;
+
+   assert(oJournal != NULL);
+   assert(uMark <= Journal_getEnd(oJournal));
+
+   Journal_lock(oJournal);
+   assert(uMark >= oJournal->uReady);
+
+   /* each record taken back takes its sequence number with it */
+   for (uOffset = uMark - oJournal->uWritten;
+        uOffset < oJournal->uPendingLength;
+        uOffset += sizeof(header) + header.uFirstLength +
+           header.uSecondLength + 2)
+   {
+      memcpy(&header, oJournal->pcPending + uOffset, sizeof(header));
+      oJournal->uSequence--;
+   }
+   oJournal->uPendingLength = uMark - oJournal->uWritten;
+   if (oJournal->uPendingLength == 0)
+      oJournal->iWaiting = 0;
+   Journal_unlock(oJournal);
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_sync(Journal_T oJournal, size_t uEnd)
+{
+   int iOk;
+
+   assert(oJournal != NULL);
+
+   Journal_lock(oJournal);
+   iOk = Journal_write(oJournal, uEnd);
+   Journal_unlock(oJournal);
+   return iOk;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_syncIfDue(Journal_T oJournal)
+{
+   int iOk = 1;
+
+   assert(oJournal != NULL);
+
+   /* the thread writes the records once the window has passed */
+   Journal_lock(oJournal);
+   if (!oJournal->iFlusher)
+      iOk = Journal_write(oJournal, Journal_getEndLocked(oJournal));
+   else if (Journal_getEndLocked(oJournal) > oJournal->uReady)
+   {
+      if (!oJournal->iWaiting)
+      {
+         oJournal->iWaiting = 1;
+         (void)clock_gettime(CLOCK_MONOTONIC, &oJournal->tFirst);
+         (void)pthread_cond_signal(&oJournal->sWake);
+      }
+      oJournal->uReady = Journal_getEndLocked(oJournal);
+   }
+   Journal_unlock(oJournal);
+   return iOk;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_truncate(Journal_T oJournal)
+{
+   int iOk = 0;
+
+   assert(oJournal != NULL);
+
+   Journal_lock(oJournal);
+   assert(oJournal->uPendingLength == 0);
+
+   /* cutting the file back to its header drops every record at once,
+      so a crash leaves either all of them or none */
+   if (ftruncate(oJournal->iFd, (off_t)sizeof(struct JournalHeader))
+       == 0 && fsync(oJournal->iFd) == 0)
+   {
+      oJournal->uWritten = sizeof(struct JournalHeader);
+      oJournal->uReady = oJournal->uWritten;
+      iOk = 1;
+   }
+   Journal_unlock(oJournal);
+   return iOk;
+}
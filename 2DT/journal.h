@@ -0,0 +1,145 @@
+/*--------------------------------------------------------------------*/
+/* journal.h                                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef JOURNAL_INCLUDED
+#define JOURNAL_INCLUDED
+
+#include <stddef.h>
+
+/* A Journal_T object is an append-only log of records in a file, for
+   replaying them after a crash.  Each record has a kind, two strings,
+   and a sequence number one more than the record's before it.
+   Records are appended to a buffer in memory, where the latest ones
+   can still be taken back, and are written out and synchronized with
+   the disk in groups: all of those waiting at once, when the oldest
+   has waited long enough, so that one synchronization serves many
+   records.  A journal with a window has a thread of its own that
+   does so when the window passes, whether or not more records come;
+   its functions are to be called by one thread at a time.  Each
+   record carries a checksum, so that one torn by a crash while it
+   was being written is found, and dropped, when the file is opened
+   again.  Records are in the machine's own byte order and word
+   size. */
+
+typedef struct Journal *Journal_T;
+
+/* A record, as Journal_next returns it.  Its strings are each
+   followed by a '\0', and stay valid until the next call. */
+
+struct Journal_Record
+{
+   size_t uSequence;
+   int iKind;
+   const char *pcFirst;
+   size_t uFirstLength;
+   const char *pcSecond;
+   size_t uSecondLength;
+};
+
+/* The ways in which opening or writing a journal can fail. */
+
+enum Journal_Status { JOURNAL_OK, JOURNAL_MEMORY, JOURNAL_IO };
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new Journal_T object for the journal in the file that the
+   file descriptor iFd refers to, which must be open for reading and
+   writing, starting a new journal if the file is empty.  The records
+   already in it can be read back with Journal_next; any after the
+   last whole one are cut off.  Records that Journal_syncIfDue makes
+   ready are synchronized once the oldest of them has waited uWindow
+   microseconds, by the journal's thread, or at once if uWindow is 0.
+   Return NULL, and assign why to *peStatus, if the file cannot be
+   read or written, is not a journal of this machine's kind, or
+   insufficient memory is available or the thread cannot be
+   started. */
+
+Journal_T Journal_open(int iFd, size_t uWindow,
+                       enum Journal_Status *peStatus);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oJournal, without writing the records in its buffer, once its
+   thread, if it has one, has stopped. */
+
+void Journal_free(Journal_T oJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Assign to *pRecord the next of the records that were in the file
+   when oJournal was opened, oldest first, and return 1 (TRUE), or
+   return 0 (FALSE) if there are no more. */
+
+int Journal_next(Journal_T oJournal, struct Journal_Record *pRecord);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the sequence number of the latest record of oJournal, or the
+   one that Journal_setSequence set, or 0 if there is neither. */
+
+size_t Journal_getSequence(Journal_T oJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Number the next record of oJournal uSequence + 1, where uSequence
+   is not less than the latest record's number. */
+
+void Journal_setSequence(Journal_T oJournal, size_t uSequence);
+
+/*--------------------------------------------------------------------*/
+
+/* Append to the buffer of oJournal a record of kind iKind whose
+   strings are the uFirstLength bytes at pcFirst and the
+   uSecondLength bytes at pcSecond.  Return 1 (TRUE), or 0 (FALSE) if
+   insufficient memory is available. */
+
+int Journal_append(Journal_T oJournal, int iKind,
+                   const char *pcFirst, size_t uFirstLength,
+                   const char *pcSecond, size_t uSecondLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the position in oJournal after its latest record, which
+   Journal_rollback and Journal_sync take. */
+
+size_t Journal_getEnd(Journal_T oJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Take back the records of oJournal after position uMark, none of
+   which may have been made ready or written yet. */
+
+void Journal_rollback(Journal_T oJournal, size_t uMark);
+
+/*--------------------------------------------------------------------*/
+
+/* Write the records of oJournal before position uEnd that are still
+   in its buffer, and synchronize the file with the disk.  Return
+   1 (TRUE), or 0 (FALSE) if there is an error, in which case the
+   records not written stay in the buffer for the next attempt. */
+
+int Journal_sync(Journal_T oJournal, size_t uEnd);
+
+/*--------------------------------------------------------------------*/
+
+/* Make all the records of oJournal ready to be written, so that they
+   can no longer be taken back, and write and synchronize them, as
+   Journal_sync does, once the oldest of those made ready and not yet
+   synchronized has waited as long as the window of oJournal: at once
+   if the window is 0, and otherwise when its thread finds them due.
+   Return 1 (TRUE), or 0 (FALSE) if there is an error in writing them
+   at once; an error of the thread leaves the records in the buffer
+   for another attempt, a window later, or for Journal_sync. */
+
+int Journal_syncIfDue(Journal_T oJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Empty the file of oJournal, all of whose records must have been
+   synchronized, keeping its sequence number.  Return 1 (TRUE), or
+   0 (FALSE) if there is an error. */
+
+int Journal_truncate(Journal_T oJournal);
+
+#endif
@@ -8,6 +8,7 @@
 
 #include <stddef.h>
 #include "a4def.h"
+#include "childset.h"
 
 /*
    a Node_T is an object that contains a path payload and references to
@@ -15,6 +16,20 @@
 */
 typedef struct node* Node_T;
 
+/*
+   a Node_ChildIter is a position among a node's children, for use
+   with Node_firstChild and Node_nextChild.
+*/
+typedef ChildSet_Cursor Node_ChildIter;
+
+/*
+   Sets the kind of index that the children of nodes created from now
+   on are promoted to once there are many of them: CHILDSET_HASH for
+   the fastest lookup by name, or CHILDSET_BTREE to also keep them
+   in order at all times. The default is CHILDSET_HASH.
+*/
+void Node_setChildKind(enum ChildSet_Kind kind);
+
 
 /*
    Given a parent node and a directory string dir, returns a new
@@ -31,11 +46,66 @@ typedef struct node* Node_T;
 
 Node_T Node_create(const char* dir, Node_T parent);
 
+/*
+   Like Node_create, but with the directory string given as the len
+   characters at dir, which need not be NUL-terminated.
+*/
+Node_T Node_createN(const char* dir, size_t len, Node_T parent);
+
+/*
+   Like Node_createN, but the new node is a copy of the hierarchy
+   rooted at source, as far as the parent's path allows: its
+   descendants have the names of source's. None of them is created
+   yet, though. Until Node_expand is called on it, the copy has no
+   children of its own and stands for those of source instead, at no
+   cost but that of the node itself. Its subtree size and byte total
+   are those of the whole copy all the same.
+
+   Changes to source's hierarchy must not show through: before any
+   directory's children change, Node_unshare must be called on it,
+   and before any hierarchy is destroyed, Node_unshareHierarchy, to
+   expand the copies that depend on it.
+*/
+Node_T Node_createCopy(Node_T source, const char* dir, size_t len,
+                       Node_T parent);
+
+/*
+   Returns the node whose hierarchy n stands for, if n is a copy that
+   has not been expanded yet, and NULL otherwise. That node is never
+   such a copy itself.
+*/
+Node_T Node_getSource(Node_T n);
+
+/*
+   Gives n, if it is an unexpanded copy, children of its own: one
+   unexpanded copy of each child of its source, which n then no longer
+   depends on. Returns SUCCESS, or MEMORY_ERROR, leaving n as it was,
+   if there is an allocation error.
+*/
+int Node_expand(Node_T n);
+
+/*
+   Expands, top down, every copy whose source is n or an ancestor of
+   n, so that n's children can change without any copy seeing it.
+   Returns SUCCESS, or MEMORY_ERROR if there is an allocation error,
+   in which case some of the copies may have been expanded, which
+   changes nothing that they stand for.
+*/
+int Node_unshare(Node_T n);
+
+/*
+   Like Node_unshare, but expands every copy whose source is in the
+   hierarchy rooted at n, as far down as needed for none to depend
+   on any node in it, so that the hierarchy can be destroyed.
+*/
+int Node_unshareHierarchy(Node_T n);
+
 /*
   Destroys the entire hierarchy of nodes rooted at n,
   including n itself.
 
-  Returns the number of nodes destroyed.
+  Returns the number of nodes destroyed, counting all those that an
+  unexpanded copy stands for.
 */
 size_t Node_destroy(Node_T n);
 
@@ -53,7 +123,25 @@ int Node_compare(Node_T node1, Node_T node2);
 const char* Node_getPath(Node_T n);
 
 /*
-  Returns the number of child directories n has.
+   Returns the length of n's path, without the cost of strlen.
+*/
+size_t Node_getPathLength(Node_T n);
+
+/*
+   Returns n's name: the last component of its path. It stays valid,
+   at the same address, for as long as n exists and is not renamed
+   by Node_move.
+*/
+const char* Node_getName(Node_T n);
+
+/*
+   Returns the length of n's name.
+*/
+size_t Node_getNameLength(Node_T n);
+
+/*
+  Returns the number of child directories n has of its own, which is
+  0 for an unexpanded copy (see Node_createCopy).
 */
 size_t Node_getNumChildren(Node_T n);
 
@@ -68,12 +156,76 @@ size_t Node_getNumChildren(Node_T n);
 */
 int Node_hasChild(Node_T n, const char* path, size_t* childID);
 
+/*
+   Returns the child of n whose name (the last component of its path)
+   is the len characters at name, which need not be NUL-terminated,
+   or NULL if n has no such child.
+
+   Unlike Node_hasChild, this neither allocates nor ranks the
+   children, so it stays O(1) expected for very wide directories.
+*/
+Node_T Node_findChild(Node_T n, const char* name, size_t len);
+
 /*
    Returns the child node of n with identifier childID, if one exists,
    otherwise returns NULL.
 */
 Node_T Node_getChild(Node_T n, size_t childID);
 
+/*
+   Returns n's first child in sorted order, storing in *iter the
+   position from which Node_nextChild continues, or returns NULL if
+   n has no children.
+
+   Iterating this way costs O(1) per child however the children are
+   stored, whereas Node_getChild costs O(log n) per call once they
+   are in a B-tree. The position is invalidated when a child is added
+   to or removed from n.
+*/
+Node_T Node_firstChild(Node_T n, Node_ChildIter* iter);
+
+/*
+   Returns the child of n after the one at position *iter, advancing
+   *iter, or returns NULL if there is none.
+*/
+Node_T Node_nextChild(Node_T n, Node_ChildIter* iter);
+
+/*
+   Returns the number of nodes in the hierarchy rooted at n, including
+   n itself. This is kept up to date as descendants are linked and
+   unlinked, so it costs O(1).
+*/
+size_t Node_getSubtreeSize(Node_T n);
+
+/*
+   Returns the total length of the paths of the nodes in the hierarchy
+   rooted at n, counting one more byte for each (as for the newline
+   that ends it in a listing). Like the subtree size, this is kept up
+   to date incrementally, so it costs O(1).
+*/
+size_t Node_getSubtreeBytes(Node_T n);
+
+/*
+   Returns the child of n whose hierarchy holds the node at position
+   *offset in the pre-order listing of n's descendants (not counting
+   n itself), storing in *iter the child's position for use with
+   Node_nextChild and in *offset the node's position within the
+   child's own hierarchy. Returns NULL if n has fewer than
+   *offset + 1 descendants.
+
+   This costs O(log n) once n's children are in a B-tree.
+*/
+Node_T Node_seekChild(Node_T n, size_t* offset, Node_ChildIter* iter);
+
+/*
+   Returns the first child of n, in sorted order, whose name is not
+   less than the len characters at name, storing in *iter its
+   position for use with Node_nextChild, or returns NULL if there is
+   none. This costs O(log n) however the children are stored.
+*/
+Node_T Node_seekChildName(Node_T n, const char* name, size_t len,
+                          Node_ChildIter* iter);
+
 /*
    Returns the parent node of n, if it exists, otherwise returns NULL
 */
@@ -87,17 +239,38 @@ Node_T Node_getParent(Node_T n);
   * child's path is not parent's path + / + directory,
     or the parent cannot link to the child,
     in which cases: returns PARENT_CHILD_ERROR
+
+  parent must have been unshared (see Node_unshare) and must not be
+  an unexpanded copy.
  */
 int Node_linkChild(Node_T parent, Node_T child);
 
 /*
-  Unlinks node parent from its child node child. child is unchanged.
+  Unlinks node parent from its child node child. child is left with
+  no parent, as the root of a hierarchy of its own, so that nothing
+  done to its old parent's hierarchy while it is detached reaches it.
 
   Returns PARENT_CHILD_ERROR if child is not a child of parent,
-  and SUCCESS otherwise.
+  and SUCCESS otherwise. parent must have been unshared.
  */
 int Node_unlinkChild(Node_T parent, Node_T child);
 
+/*
+  Moves the hierarchy rooted at n from below its parent to below
+  newParent, renaming n to the len characters at name, and returns
+  SUCCESS. n must not be the root, newParent must not be in n's
+  hierarchy, name must be a single component, and newParent must not
+  have a child of that name already. Both parents must have been
+  unshared, and newParent must not be an unexpanded copy.
+
+  Every node of the hierarchy keeps its children as they are, so the
+  only cost per node is a copy of its new path.
+
+  Returns MEMORY_ERROR, leaving everything unchanged, if unable to
+  allocate the new paths or to link n to newParent.
+*/
+int Node_move(Node_T n, Node_T newParent, const char* name, size_t len);
+
 /*
   Creates a new node such that the new node's path is dir appended to
   n's path, separated by a slash, and that the new node has no
@@ -9,6 +9,8 @@
 #include <stdio.h>
 
 #include "dynarray.h"
+#include "childset.h"
+#include "path.h"
 #include "node.h"
 #include "checkerDT.h"
 
@@ -19,61 +21,136 @@ struct node {
    /* the full path of this directory */
    char* path;
 
+   /* the length of path */
+   size_t pathLen;
+
+   /* this directory's own name: the last component of path. It is
+      kept apart from path, in the same block as the node unless the
+      directory has been renamed, so that it stays put (as the key
+      that the parent's children are indexed by must) when a move
+      replaces path. */
+   char* name;
+
+   /* the length of name */
+   size_t nameLen;
+
    /* the parent directory of this directory
       NULL for the root of the directory tree */
    Node_T parent;
 
-   /* the subdirectories of this directory
-      stored in sorted order by pathname */
-   DynArray_T children;
+   /* the subdirectories of this directory, keyed by name
+      and ranked in sorted order by pathname */
+   ChildSet_T children;
+
+   /* the total length of the paths in the hierarchy rooted here,
+      counting one more byte for each to end it */
+   size_t subtreeBytes;
+
+   /* for a copy that has not been expanded yet: the directory whose
+      hierarchy this one's stands for, in place of children of its
+      own. NULL otherwise */
+   Node_T source;
+
+   /* the first of the unexpanded copies whose source is this
+      directory, and, for such a copy, its neighbors among them */
+   Node_T firstCopy;
+   Node_T prevCopy;
+   Node_T nextCopy;
 };
 
+/* the kind of index that new nodes promote their children to */
+static enum ChildSet_Kind childKind = CHILDSET_HASH;
+
+/* the number of unexpanded copies, so that when there are none,
+   checking whether a directory is shared costs nothing */
+static size_t numCopies;
+
+/* see node.h for specification */
+void Node_setChildKind(enum ChildSet_Kind kind) {
+   childKind = kind;
+}
+
 
 /*
-  returns a path with contents
-  n->path/dir
-  or NULL if there is an allocation error.
+  returns a path with contents prefix/dir, where prefix is the
+  prefixLen characters at prefix, or just dir if prefix is NULL, and
+  dir is the len characters at dir, or NULL if there is an allocation
+  error.
 
   Allocates memory for the returned string,
   which is then owned by the caller!
 */
-static char* Node_buildPath(Node_T n, const char* dir) {
+static char* Node_joinPath(const char* prefix, size_t prefixLen,
+                           const char* dir, size_t len) {
    char* path;
+   size_t dirOffset = 0;
 
    assert(dir != NULL);
 
-   if(n == NULL)
-      path = malloc(strlen(dir)+1);
-   else
-      path = malloc(strlen(n->path) + 1 + strlen(dir) + 1);
+   if(prefix != NULL)
+      dirOffset = prefixLen + 1;
 
+   path = malloc(dirOffset + len + 1);
    if(path == NULL)
       return NULL;
-   *path = '\0';
 
-   if(n != NULL) {
-      strcpy(path, n->path);
-      strcat(path, "/");
+   if(prefix != NULL) {
+      memcpy(path, prefix, prefixLen);
+      path[prefixLen] = '/';
    }
-   strcat(path, dir);
+   memcpy(path + dirOffset, dir, len);
+   path[dirOffset + len] = '\0';
 
    return path;
 }
 
+/*
+  returns a path with contents
+  n->path/dir, where dir is the len characters at dir,
+  or NULL if there is an allocation error.
+
+  Allocates memory for the returned string,
+  which is then owned by the caller!
+*/
+static char* Node_buildPath(Node_T n, const char* dir, size_t len) {
+   assert(dir != NULL);
+
+   if(n == NULL)
+      return Node_joinPath(NULL, 0, dir, len);
+   return Node_joinPath(n->path, n->pathLen, dir, len);
+}
+
+/*
+  Returns the name stored in the same block as n, which n->name
+  points to unless n has been renamed.
+*/
+static char* Node_inlineName(Node_T n) {
+   assert(n != NULL);
+
+   return (char*) (n + 1);
+}
+
 /* see node.h for specification */
 Node_T Node_create(const char* dir, Node_T parent){
+   assert(dir != NULL);
+
+   return Node_createN(dir, strlen(dir), parent);
+}
+
+/* see node.h for specification */
+Node_T Node_createN(const char* dir, size_t len, Node_T parent){
    Node_T new;
 
    assert(parent == NULL || CheckerDT_Node_isValid(parent));
    assert(dir != NULL);
 
-   new = malloc(sizeof(struct node));
+   new = malloc(sizeof(struct node) + len + 1);
    if(new == NULL) {
       assert(parent == NULL || CheckerDT_Node_isValid(parent));
       return NULL;
    }
 
-   new->path = Node_buildPath(parent, dir);
+   new->path = Node_buildPath(parent, dir, len);
 
    if(new->path == NULL) {
       free(new);
@@ -81,8 +158,21 @@ Node_T Node_create(const char* dir, Node_T parent){
       return NULL;
    }
 
+   new->pathLen = len;
+   if(parent != NULL)
+      new->pathLen += Node_getPathLength(parent) + 1;
+   new->name = Node_inlineName(new);
+   memcpy(new->name, dir, len);
+   new->name[len] = '\0';
+   new->nameLen = len;
+   new->subtreeBytes = new->pathLen + 1;
+
    new->parent = parent;
-   new->children = DynArray_new(0);
+   new->source = NULL;
+   new->firstCopy = NULL;
+   new->prevCopy = NULL;
+   new->nextCopy = NULL;
+   new->children = ChildSet_new(childKind);
    if(new->children == NULL) {
       free(new->path);
       free(new);
@@ -96,24 +186,123 @@ Node_T Node_create(const char* dir, Node_T parent){
 }
 
 /* see node.h for specification */
-size_t Node_destroy(Node_T n) {
-   size_t i;
-   size_t count = 0;
+Node_T Node_createCopy(Node_T source, const char* dir, size_t len,
+                       Node_T parent) {
+   Node_T new;
+   size_t size;
+
+   assert(source != NULL);
+   assert(dir != NULL);
+
+   new = Node_createN(dir, len, parent);
+   if(new == NULL)
+      return NULL;
+
+   /* a copy of a copy stands for the same hierarchy as the first,
+      and a copy of a leaf is just a leaf */
+   if(source->source != NULL)
+      source = source->source;
+   if(ChildSet_getLength(source->children) == 0)
+      return new;
+
+   size = Node_getSubtreeSize(source);
+   new->subtreeBytes = source->subtreeBytes - size * source->pathLen
+      + size * new->pathLen;
+   new->source = source;
+   new->nextCopy = source->firstCopy;
+   if(source->firstCopy != NULL)
+      source->firstCopy->prevCopy = new;
+   source->firstCopy = new;
+   numCopies++;
+   return new;
+}
+
+/*
+  Takes the unexpanded copy n off its source's list of copies, so that
+  n is a copy no more.
+*/
+static void Node_leaveSource(Node_T n) {
+   assert(n != NULL);
+   assert(n->source != NULL);
+
+   if(n->prevCopy != NULL)
+      n->prevCopy->nextCopy = n->nextCopy;
+   else
+      n->source->firstCopy = n->nextCopy;
+   if(n->nextCopy != NULL)
+      n->nextCopy->prevCopy = n->prevCopy;
+   n->source = NULL;
+   n->prevCopy = NULL;
+   n->nextCopy = NULL;
+   numCopies--;
+}
+
+/*
+  Returns TRUE if an unexpanded copy stands for a hierarchy that
+  holds n's children: one whose source is n or an ancestor of n.
+*/
+static boolean Node_isShared(Node_T n) {
+   assert(n != NULL);
+
+   if(numCopies == 0)
+      return FALSE;
+   for( ; n != NULL; n = n->parent)
+      if(n->firstCopy != NULL)
+         return TRUE;
+   return FALSE;
+}
+
+/*
+  Takes every unexpanded copy in the hierarchy rooted at n off its
+  source's list, and returns the number of directories in the
+  hierarchy, counting all those that each copy stands for.
+*/
+static size_t Node_release(Node_T n) {
+   Node_ChildIter iter;
    Node_T c;
+   size_t count = 1;
 
    assert(n != NULL);
 
-   for(i = 0; i < DynArray_getLength(n->children); i++)
-   {
-      c = DynArray_get(n->children, i);
-      count += Node_destroy(c);
+   if(n->source != NULL) {
+      count = Node_getSubtreeSize(n);
+      Node_leaveSource(n);
+      return count;
    }
-   DynArray_free(n->children);
+   for(c = Node_firstChild(n, &iter); c != NULL;
+       c = Node_nextChild(n, &iter))
+      count += Node_release(c);
+   return count;
+}
+
+/*
+  Frees the hierarchy rooted at n, which Node_release has been called
+  on. The second parameter is unused, so that this can be a
+  ChildSet_map callback.
+*/
+static void Node_free(Node_T n, void* unused) {
+   assert(n != NULL);
+   /* a copy of n elsewhere would be left standing for freed nodes */
+   assert(n->firstCopy == NULL);
+
+   (void) unused;
+   ChildSet_map(n->children, (void (*)(void*, void*)) Node_free, NULL);
+   ChildSet_free(n->children);
 
+   if(n->name != Node_inlineName(n))
+      free(n->name);
    free(n->path);
    free(n);
-   count++;
+}
+
+/* see node.h for specification */
+size_t Node_destroy(Node_T n) {
+   size_t count;
 
+   assert(n != NULL);
+
+   count = Node_release(n);
+   Node_free(n, NULL);
    return count;
 }
 
@@ -136,6 +325,27 @@ const char* Node_getPath(Node_T n) {
    return n->path;
 }
 
+/* see node.h for specification */
+size_t Node_getPathLength(Node_T n) {
+   assert(n != NULL);
+
+   return n->pathLen;
+}
+
+/* see node.h for specification */
+const char* Node_getName(Node_T n) {
+   assert(n != NULL);
+
+   return n->name;
+}
+
+/* see node.h for specification */
+size_t Node_getNameLength(Node_T n) {
+   assert(n != NULL);
+
+   return n->nameLen;
+}
+
 /* see node.h for specification */
 int Node_compare(Node_T node1, Node_T node2) {
    assert(node1 != NULL);
@@ -144,29 +354,43 @@ int Node_compare(Node_T node1, Node_T node2) {
    return strcmp(node1->path, node2->path);
 }
 
+/* see node.h for specification */
+Node_T Node_getSource(Node_T n) {
+   assert(n != NULL);
+
+   return n->source;
+}
+
 /* see node.h for specification */
 size_t Node_getNumChildren(Node_T n) {
    assert(n != NULL);
 
-   return DynArray_getLength(n->children);
+   return ChildSet_getLength(n->children);
 }
 
 /* see node.h for specification */
 int Node_hasChild(Node_T n, const char* path, size_t* childID) {
    size_t index;
-   int result;
-   Node_T checker;
+   size_t len;
+   int result = 0;
 
    assert(n != NULL);
    assert(path != NULL);
 
-   checker = Node_create(path, NULL);
-   if(checker == NULL) {
-      return -1;
+   /* every child's path is n's path + / + its name, so only a path
+      with that prefix can be found, and it ranks among the children
+      by the rest of the path alone */
+   len = Node_getPathLength(n);
+   if(!strncmp(path, n->path, len) && path[len] == '/') {
+      path += len + 1;
+      result = ChildSet_bsearch(n->children, path, strlen(path),
+                                &index);
    }
-   result = DynArray_bsearch(n->children, checker, &index,
-                    (int (*)(const void*, const void*)) Node_compare);
-   (void) Node_destroy(checker);
+   else if(strncmp(path, n->path, len) < 0 ||
+           (!strncmp(path, n->path, len) && path[len] < '/'))
+      index = 0;
+   else
+      index = ChildSet_getLength(n->children);
 
    if(childID != NULL)
       *childID = index;
@@ -174,18 +398,77 @@ int Node_hasChild(Node_T n, const char* path, size_t* childID) {
    return result;
 }
 
+/* see node.h for specification */
+Node_T Node_findChild(Node_T n, const char* name, size_t len) {
+   assert(n != NULL);
+   assert(name != NULL);
+
+   return ChildSet_find(n->children, name, len);
+}
+
 /* see node.h for specification */
 Node_T Node_getChild(Node_T n, size_t childID) {
    assert(n != NULL);
 
-   if(DynArray_getLength(n->children) > childID) {
-      return DynArray_get(n->children, childID);
+   if(ChildSet_getLength(n->children) > childID) {
+      return ChildSet_get(n->children, childID);
    }
    else {
       return NULL;
    }
 }
 
+/* see node.h for specification */
+Node_T Node_firstChild(Node_T n, Node_ChildIter* iter) {
+   assert(n != NULL);
+   assert(iter != NULL);
+
+   return ChildSet_first(n->children, iter);
+}
+
+/* see node.h for specification */
+Node_T Node_nextChild(Node_T n, Node_ChildIter* iter) {
+   assert(n != NULL);
+   assert(iter != NULL);
+
+   return ChildSet_next(n->children, iter);
+}
+
+/* see node.h for specification */
+size_t Node_getSubtreeSize(Node_T n) {
+   assert(n != NULL);
+
+   if(n->source != NULL)
+      return Node_getSubtreeSize(n->source);
+   return 1 + ChildSet_getWeight(n->children);
+}
+
+/* see node.h for specification */
+size_t Node_getSubtreeBytes(Node_T n) {
+   assert(n != NULL);
+
+   return n->subtreeBytes;
+}
+
+/* see node.h for specification */
+Node_T Node_seekChild(Node_T n, size_t* offset, Node_ChildIter* iter) {
+   assert(n != NULL);
+   assert(offset != NULL);
+   assert(iter != NULL);
+
+   return ChildSet_seekWeight(n->children, offset, iter);
+}
+
+/* see node.h for specification */
+Node_T Node_seekChildName(Node_T n, const char* name, size_t len,
+                          Node_ChildIter* iter) {
+   assert(n != NULL);
+   assert(name != NULL);
+   assert(iter != NULL);
+
+   return ChildSet_seek(n->children, name, len, iter);
+}
+
 /* see node.h for specification */
 Node_T Node_getParent(Node_T n) {
    assert(n != NULL);
@@ -193,57 +476,70 @@ Node_T Node_getParent(Node_T n) {
    return n->parent;
 }
 
+/*
+  Updates the aggregates of n and of its ancestors after a hierarchy
+  whose paths total bytes bytes was linked below n (if grow is TRUE)
+  or unlinked from below it (if grow is FALSE): each one's byte total,
+  and the subtree size that its parent records for it. Stops after the
+  first node not (yet) linked into its parent.
+*/
+static void Node_updateSpine(Node_T n, size_t bytes, boolean grow) {
+   assert(n != NULL);
+
+   for(;;) {
+      if(grow)
+         n->subtreeBytes += bytes;
+      else
+         n->subtreeBytes -= bytes;
+
+      if(n->parent == NULL ||
+         ChildSet_find(n->parent->children, n->name, n->nameLen) != n)
+         break;
+      (void) ChildSet_setWeight(n->parent->children, n->name,
+                                n->nameLen, Node_getSubtreeSize(n));
+      n = n->parent;
+   }
+}
+
 /* see node.h for specification */
 int Node_linkChild(Node_T parent, Node_T child) {
    size_t i;
-   int result;
+   size_t len;
    char* rest;
 
    assert(parent != NULL);
    assert(child != NULL);
+   assert(parent->source == NULL && !Node_isShared(parent));
    assert(CheckerDT_Node_isValid(parent));
    assert(CheckerDT_Node_isValid(child));
 
-   result = Node_hasChild(parent, child->path, NULL);
-   if(result == 1) {
-      assert(CheckerDT_Node_isValid(parent));
-      assert(CheckerDT_Node_isValid(child));
-      return ALREADY_IN_TREE;
-   }
-   if(result == -1) {
-      assert(CheckerDT_Node_isValid(parent));
-      assert(CheckerDT_Node_isValid(child));
-      return PARENT_CHILD_ERROR;
-   }
-
-   i = strlen(parent->path);
-   if(strncmp(child->path, parent->path, i)) {
+   i = Node_getPathLength(parent);
+   len = Node_getPathLength(child);
+   if(len == i || !Path_hasPrefix(child->path, len, parent->path, i)) {
       assert(CheckerDT_Node_isValid(parent));
       assert(CheckerDT_Node_isValid(child));
       return PARENT_CHILD_ERROR;
    }
-   rest = child->path + i;
-   if(strlen(child->path) >= i && rest[0] != '/') {
-      assert(CheckerDT_Node_isValid(parent));
-      assert(CheckerDT_Node_isValid(child));
-      return PARENT_CHILD_ERROR;
-   }
-   rest++;
-   if(strstr(rest, "/") != NULL) {
+   rest = child->path + i + 1;
+   if(Path_findSeparator(rest, len - i - 1) != NULL) {
       assert(CheckerDT_Node_isValid(parent));
       assert(CheckerDT_Node_isValid(child));
       return PARENT_CHILD_ERROR;
    }
    child->parent = parent;
+   assert(child->nameLen == len - i - 1);
+   assert(!memcmp(child->name, rest, child->nameLen));
 
-   if(DynArray_bsearch(parent->children, child, &i,
-         (int (*)(const void*, const void*)) Node_compare) == 1) {
+   if(ChildSet_find(parent->children, child->name,
+                    child->nameLen) != NULL) {
       assert(CheckerDT_Node_isValid(parent));
       assert(CheckerDT_Node_isValid(child));
       return ALREADY_IN_TREE;
    }
 
-   if(DynArray_addAt(parent->children, i, child) == TRUE) {
+   if(ChildSet_add(parent->children, child->name, child->nameLen,
+                   child, Node_getSubtreeSize(child)) == TRUE) {
+      Node_updateSpine(parent, child->subtreeBytes, TRUE);
       assert(CheckerDT_Node_isValid(parent));
       assert(CheckerDT_Node_isValid(child));
       return SUCCESS;
@@ -257,27 +553,250 @@ int Node_linkChild(Node_T parent, Node_T child) {
 
 /* see node.h for specification */
 int  Node_unlinkChild(Node_T parent, Node_T child) {
-   size_t i;
-
    assert(parent != NULL);
    assert(child != NULL);
+   assert(!Node_isShared(parent));
    assert(CheckerDT_Node_isValid(parent));
    assert(CheckerDT_Node_isValid(child));
 
-   if(DynArray_bsearch(parent->children, child, &i,
-         (int (*)(const void*, const void*)) Node_compare) == 0) {
+   if(ChildSet_find(parent->children, child->name,
+                    child->nameLen) != child) {
       assert(CheckerDT_Node_isValid(parent));
       assert(CheckerDT_Node_isValid(child));
       return PARENT_CHILD_ERROR;
    }
 
-   (void) DynArray_removeAt(parent->children, i);
+   (void) ChildSet_remove(parent->children, child->name,
+                          child->nameLen);
+   Node_updateSpine(parent, child->subtreeBytes, FALSE);
+   child->parent = NULL;
 
    assert(CheckerDT_Node_isValid(parent));
    assert(CheckerDT_Node_isValid(child));
    return SUCCESS;
 }
 
+/*
+  Adds to paths the new path of each descendant of n, in pre-order,
+  given n's new path, the len characters at path.
+
+  Returns FALSE if there is an allocation error, TRUE otherwise.
+*/
+static boolean Node_addMovedPaths(Node_T n, const char* path, size_t len,
+                                  DynArray_T paths) {
+   Node_ChildIter iter;
+   Node_T c;
+   char* childPath;
+
+   assert(n != NULL);
+   assert(path != NULL);
+   assert(paths != NULL);
+
+   for(c = Node_firstChild(n, &iter); c != NULL;
+       c = Node_nextChild(n, &iter)) {
+      childPath = Node_joinPath(path, len, c->name, c->nameLen);
+      if(childPath == NULL)
+         return FALSE;
+      if(!DynArray_add(paths, childPath)) {
+         free(childPath);
+         return FALSE;
+      }
+      if(!Node_addMovedPaths(c, childPath, len + 1 + c->nameLen, paths))
+         return FALSE;
+   }
+   return TRUE;
+}
+
+/*
+  Gives n and its descendants, in pre-order, the paths in paths from
+  index *next on, freeing their old ones, and adjusts each one's byte
+  total to match, given that n's path grows by grow - shrink bytes,
+  as do those of all its descendants.
+*/
+static void Node_setMovedPaths(Node_T n, DynArray_T paths, size_t* next,
+                               size_t grow, size_t shrink) {
+   Node_ChildIter iter;
+   Node_T c;
+   size_t size;
+
+   assert(n != NULL);
+   assert(paths != NULL);
+   assert(next != NULL);
+
+   free(n->path);
+   n->path = DynArray_get(paths, (*next)++);
+   n->pathLen = n->pathLen + grow - shrink;
+   size = Node_getSubtreeSize(n);
+   n->subtreeBytes = n->subtreeBytes + size * grow - size * shrink;
+
+   for(c = Node_firstChild(n, &iter); c != NULL;
+       c = Node_nextChild(n, &iter))
+      Node_setMovedPaths(c, paths, next, grow, shrink);
+}
+
+/* see node.h for specification */
+int Node_move(Node_T n, Node_T newParent, const char* name,
+              size_t len) {
+   DynArray_T paths;
+   char* newName;
+   char* path;
+   size_t pathLen;
+   size_t next = 0;
+   size_t i;
+
+   assert(n != NULL);
+   assert(n->parent != NULL);
+   assert(newParent != NULL);
+   assert(name != NULL);
+   assert(Path_findSeparator(name, len) == NULL);
+   assert(!Node_isShared(n->parent));
+   assert(newParent->source == NULL && !Node_isShared(newParent));
+   assert(CheckerDT_Node_isValid(n));
+   assert(CheckerDT_Node_isValid(newParent));
+
+   newName = n->name;
+   if(len != n->nameLen || memcmp(name, n->name, len)) {
+      newName = malloc(len + 1);
+      if(newName == NULL)
+         return MEMORY_ERROR;
+      memcpy(newName, name, len);
+      newName[len] = '\0';
+   }
+
+   /* build every new path before changing anything, so that running
+      out of memory leaves the hierarchy as it was */
+   pathLen = newParent->pathLen + 1 + len;
+   paths = DynArray_new(0);
+   path = NULL;
+   if(paths != NULL)
+      path = Node_joinPath(newParent->path, newParent->pathLen,
+                           name, len);
+   if(path == NULL || !DynArray_add(paths, path) ||
+      !Node_addMovedPaths(n, path, pathLen, paths) ||
+      !ChildSet_add(newParent->children, newName, len, n,
+                    Node_getSubtreeSize(n))) {
+      if(paths != NULL) {
+         for(i = 0; i < DynArray_getLength(paths); i++)
+            free(DynArray_get(paths, i));
+         if(DynArray_getLength(paths) == 0)
+            free(path);
+         DynArray_free(paths);
+      }
+      if(newName != n->name)
+         free(newName);
+      return MEMORY_ERROR;
+   }
+
+   /* n is now a child of both parents, so unlink it from the old
+      one under its old name before renaming it */
+   (void) ChildSet_remove(n->parent->children, n->name, n->nameLen);
+   Node_updateSpine(n->parent, n->subtreeBytes, FALSE);
+
+   if(newName != n->name) {
+      if(n->name != Node_inlineName(n))
+         free(n->name);
+      n->name = newName;
+      n->nameLen = len;
+   }
+   if(pathLen >= n->pathLen)
+      Node_setMovedPaths(n, paths, &next, pathLen - n->pathLen, 0);
+   else
+      Node_setMovedPaths(n, paths, &next, 0, n->pathLen - pathLen);
+   DynArray_free(paths);
+
+   n->parent = newParent;
+   Node_updateSpine(newParent, n->subtreeBytes, TRUE);
+
+   assert(CheckerDT_Node_isValid(n));
+   assert(CheckerDT_Node_isValid(newParent));
+   return SUCCESS;
+}
+
+/*
+  Destroys the hierarchy rooted at n. The second parameter is unused,
+  so that this can be a ChildSet_map callback.
+*/
+static void Node_destroyChild(Node_T n, void* unused) {
+   (void) unused;
+   (void) Node_destroy(n);
+}
+
+/* see node.h for specification */
+int Node_expand(Node_T n) {
+   ChildSet_T children;
+   Node_ChildIter iter;
+   Node_T c;
+   Node_T copy;
+
+   assert(n != NULL);
+
+   if(n->source == NULL)
+      return SUCCESS;
+
+   /* build the new children apart, so that running out of memory
+      leaves n a copy as it was */
+   children = ChildSet_new(childKind);
+   if(children == NULL)
+      return MEMORY_ERROR;
+   for(c = Node_firstChild(n->source, &iter); c != NULL;
+       c = Node_nextChild(n->source, &iter)) {
+      copy = Node_createCopy(c, c->name, c->nameLen, n);
+      if(copy == NULL ||
+         !ChildSet_add(children, copy->name, copy->nameLen, copy,
+                       Node_getSubtreeSize(copy))) {
+         if(copy != NULL)
+            (void) Node_destroy(copy);
+         ChildSet_map(children,
+                      (void (*)(void*, void*)) Node_destroyChild, NULL);
+         ChildSet_free(children);
+         return MEMORY_ERROR;
+      }
+   }
+
+   /* the byte total stays as it is: the children stand for just the
+      paths that n did */
+   ChildSet_free(n->children);
+   n->children = children;
+   Node_leaveSource(n);
+   return SUCCESS;
+}
+
+/* see node.h for specification */
+int Node_unshare(Node_T n) {
+   assert(n != NULL);
+
+   if(!Node_isShared(n))
+      return SUCCESS;
+
+   /* from the root down, since expanding a copy of an ancestor makes
+      new copies of its children */
+   if(n->parent != NULL && Node_unshare(n->parent) != SUCCESS)
+      return MEMORY_ERROR;
+   while(n->firstCopy != NULL)
+      if(Node_expand(n->firstCopy) != SUCCESS)
+         return MEMORY_ERROR;
+   return SUCCESS;
+}
+
+/* see node.h for specification */
+int Node_unshareHierarchy(Node_T n) {
+   Node_ChildIter iter;
+   Node_T c;
+
+   assert(n != NULL);
+
+   if(numCopies == 0)
+      return SUCCESS;
+
+   while(n->firstCopy != NULL)
+      if(Node_expand(n->firstCopy) != SUCCESS)
+         return MEMORY_ERROR;
+   for(c = Node_firstChild(n, &iter); c != NULL;
+       c = Node_nextChild(n, &iter))
+      if(Node_unshareHierarchy(c) != SUCCESS)
+         return MEMORY_ERROR;
+   return SUCCESS;
+}
 
 /* see node.h for specification */
 int Node_addChild(Node_T parent, const char* dir) {
@@ -0,0 +1,151 @@
+/*--------------------------------------------------------------------*/
+/* path.c                                                             */
+/*--------------------------------------------------------------------*/
+
+#include "path.h"
+#include <assert.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+const char *Path_findSeparator(const char *pcPath, size_t uLength)
+{
+   assert(pcPath != NULL || uLength == 0);
+
+   /* The C library's memchr already compares a vector register's
+      worth of bytes at a time on every platform we build for. */
+   return (const char*)memchr(pcPath, '/', uLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+int Path_hasPrefix(const char *pcPath, size_t uLength,
+                   const char *pcPrefix, size_t uPrefixLength)
+{
+   assert(pcPath != NULL || uLength == 0);
+   assert(pcPrefix != NULL || uPrefixLength == 0);
+
+   if (uPrefixLength > uLength)
+      return 0;
+   if (memcmp(pcPath, pcPrefix, uPrefixLength) != 0)
+      return 0;
+   return uPrefixLength == uLength || pcPath[uPrefixLength] == '/';
+}
+
+/*--------------------------------------------------------------------*/
+
+int Path_nextComponent(const char *pcPath, size_t uLength,
+                       size_t *puOffset, const char **ppcComponent,
+                       size_t *puComponentLength)
+{
+   const char *pcSeparator;
+
+   assert(pcPath != NULL || uLength == 0);
+   assert(puOffset != NULL);
+   assert(ppcComponent != NULL);
+   assert(puComponentLength != NULL);
+
+   if (*puOffset > uLength)
+      return 0;
+
+   *ppcComponent = pcPath + *puOffset;
+   pcSeparator = Path_findSeparator(*ppcComponent, uLength - *puOffset);
+   if (pcSeparator == NULL)
+      *puComponentLength = uLength - *puOffset;
+   else
+      *puComponentLength = (size_t)(pcSeparator - *ppcComponent);
+   *puOffset += *puComponentLength + 1;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Path_compare(const char *pcPath1, size_t uLength1,
+                 const char *pcPath2, size_t uLength2)
+{
+   size_t u;
+   unsigned char uc1;
+   unsigned char uc2;
+
+   assert(pcPath1 != NULL || uLength1 == 0);
+   assert(pcPath2 != NULL || uLength2 == 0);
+
+   /* Comparing by component is comparing byte by byte with '/'
+      ranked below every other byte, since it ends the shorter of
+      two components that agree up to there. */
+   for (u = 0; u < uLength1 && u < uLength2; u++)
+   {
+      uc1 = (unsigned char)pcPath1[u];
+      uc2 = (unsigned char)pcPath2[u];
+      if (uc1 == uc2)
+         continue;
+      if (uc1 == '/')
+         return -1;
+      if (uc2 == '/')
+         return 1;
+      return uc1 < uc2 ? -1 : 1;
+   }
+   if (uLength1 < uLength2)
+      return -1;
+   return uLength1 > uLength2;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Path_literalLength(const char *pcPattern, size_t uLength)
+{
+   size_t u;
+
+   assert(pcPattern != NULL || uLength == 0);
+
+   for (u = 0; u < uLength; u++)
+      if (pcPattern[u] == '*' || pcPattern[u] == '?')
+         break;
+   return u;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Path_match(const char *pcPattern, size_t uPatternLength,
+               const char *pcName, size_t uNameLength)
+{
+   size_t uPattern = 0;
+   size_t uName = 0;
+   size_t uStarPattern = 0;
+   size_t uStarName = 0;
+   int iStar = 0;
+
+   assert(pcPattern != NULL || uPatternLength == 0);
+   assert(pcName != NULL || uNameLength == 0);
+
+   /* Match greedily, and on a mismatch let the latest '*' absorb one
+      more byte and try again from there.  Earlier '*'s never need to
+      absorb more, so this takes O(uPatternLength * uNameLength) time
+      at worst, without recursion. */
+   while (uName < uNameLength)
+   {
+      if (uPattern < uPatternLength && pcPattern[uPattern] == '*')
+      {
+         iStar = 1;
+         uStarPattern = ++uPattern;
+         uStarName = uName;
+      }
+      else if (uPattern < uPatternLength &&
+               (pcPattern[uPattern] == '?' ||
+                pcPattern[uPattern] == pcName[uName]))
+      {
+         uPattern++;
+         uName++;
+      }
+      else if (iStar)
+      {
+         uPattern = uStarPattern;
+         uName = ++uStarName;
+      }
+      else
+         return 0;
+   }
+   while (uPattern < uPatternLength && pcPattern[uPattern] == '*')
+      uPattern++;
+   return uPattern == uPatternLength;
+}
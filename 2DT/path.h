@@ -0,0 +1,79 @@
+/*--------------------------------------------------------------------*/
+/* path.h                                                             */
+/*--------------------------------------------------------------------*/
+
+#ifndef PATH_INCLUDED
+#define PATH_INCLUDED
+
+#include <stddef.h>
+
+/* The Path module scans slash-separated paths in place.  A path is
+   given as a pointer and a length, so it need not be NUL-terminated
+   and is never copied; components are reported the same way, as
+   pointers into the path itself. */
+
+/*--------------------------------------------------------------------*/
+
+/* Return a pointer to the first '/' in the uLength bytes at pcPath,
+   or NULL if there is none. */
+
+const char *Path_findSeparator(const char *pcPath, size_t uLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) iff the uLength bytes at pcPath are the
+   uPrefixLength bytes at pcPrefix, either alone or followed by a '/'
+   and more components, and 0 (FALSE) otherwise. */
+
+int Path_hasPrefix(const char *pcPath, size_t uLength,
+                   const char *pcPrefix, size_t uPrefixLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Scan the component of the uLength bytes at pcPath that starts at
+   offset *puOffset, and that ends at the next '/' or at the end of
+   the path.  If there is such a component, assign its address to
+   *ppcComponent and its length (possibly 0) to *puComponentLength,
+   advance *puOffset past it and the '/' after it, and return 1
+   (TRUE).  Otherwise, when *puOffset is past the end of the path,
+   return 0 (FALSE).
+
+   Starting from offset 0, successive calls yield every component of
+   the path in order: "a/b" yields "a" and "b", and "a/" yields "a"
+   and "". */
+
+int Path_nextComponent(const char *pcPath, size_t uLength,
+                       size_t *puOffset, const char **ppcComponent,
+                       size_t *puComponentLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Compare the uLength1 bytes at pcPath1 with the uLength2 bytes at
+   pcPath2 component by component, each component as strcmp would.
+   Return <0, 0, or >0 as pcPath1 comes before, is, or comes after
+   pcPath2.  A path comes before the paths below it, which come
+   before its later siblings: "a" < "a/b" < "a-b". */
+
+int Path_compare(const char *pcPath1, size_t uLength1,
+                 const char *pcPath2, size_t uLength2);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes at the start of the uLength bytes at
+   pcPattern, a component of a glob pattern, that come before its
+   first wildcard ('*' or '?'), which is all of them if it has
+   none. */
+
+size_t Path_literalLength(const char *pcPattern, size_t uLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) iff the uNameLength bytes at pcName match the
+   uPatternLength bytes at pcPattern, a component of a glob pattern,
+   and 0 (FALSE) otherwise.  In the pattern, '*' matches any run of
+   bytes and '?' any one byte; every other byte matches itself. */
+
+int Path_match(const char *pcPattern, size_t uPatternLength,
+               const char *pcName, size_t uNameLength);
+
+#endif